@@ -4,15 +4,28 @@
 %ifndef KERNEL_SECTORS
 %define KERNEL_SECTORS 32
 %endif
+%ifndef KERNEL_LBA
+%define KERNEL_LBA 1                  ; right after this sector (a VBR passes its own)
+%endif
 
-%define KERNEL_LOAD_SEG  0x1000       ; 0x1000:0000 -> 0x00010000
-%define KERNEL_LOAD_OFF  0x0000
-%define KERNEL_LOAD_ADDR 0x00010000
+; The kernel is linked at 1 MiB (kernel/kernel.ld); a compressed image is
+; loaded higher and its stub (kernel/stub.c) unpacks the kernel there. Each
+; BIOS read lands in a bounce buffer below 1 MiB and is copied up with
+; 32-bit addressing from unreal mode. Hard disks with EDD use INT 13h
+; AH=42h; floppies and BIOSes without it use AH=02h, a whole track (or
+; what is left of it) per call.
+%define BOUNCE_SEG       0x1000       ; 0x1000:0000 -> 0x00010000
+%define BOUNCE_SECTORS   127          ; largest transfer every EDD BIOS accepts
+%ifndef KERNEL_LOAD_ADDR
+%define KERNEL_LOAD_ADDR 0x00100000   ; build.sh passes the stub's address for a compressed image
+%endif
 
 %define SPT 18                        ; sectors per track (1.44MB floppy)
 %define HEADS 2                       ; heads
 
 %define FB_BOOTINFO_SEG 0x7000        ; physical 0x00070000
+%define BOOTINFO_TSC_ADDR 0x7E00       ; bootinfo_tsc_t (kernel/bootprof.h), below the kernel
+%define BOOTINFO_TSC_MAGIC 0xB007C10C
 %define VBE_MODE 0x118                ; 1024x768x16bpp (common)
 
 ; Define ENABLE_VBE to enable graphics mode set and bootinfo handoff
@@ -26,6 +39,11 @@ start:
     mov ss, ax
     mov sp, 0x7C00
 
+    ; TSC at entry, for `bootprof`; written out with the post-load stamp
+    rdtsc
+    mov [tsc_block+8], eax
+    mov [tsc_block+12], edx
+
     ; Ensure VGA text mode 80x25
     mov ax, 0x0003
     int 0x10
@@ -37,128 +55,164 @@ start:
     mov al, 'S'
     call print_char
 
-    ; Set destination pointer ES:BX = 0x1000:0000
-    mov ax, KERNEL_LOAD_SEG
-    mov es, ax
-    xor bx, bx
+    ; A20 on and the flat GDT loaded once; go_unreal uses it before each copy
+    in al, 0x92
+    or al, 00000010b
+    out 0x92, al
+    lgdt [gdt_descriptor]
 
-    ; Initialize CHS to C=0, H=0, S=2 (skip boot sector)
-    xor dx, dx             ; DH=head=0, DL ignored here
-    xor cx, cx             ; CH=cyl=0
-    mov si, KERNEL_SECTORS ; SI = remaining sectors
-    mov byte [sector], 2
-    mov byte [head], 0
-    mov byte [cyl], 0
+    ; EDD on hard disks only
+    mov dl, [boot_drive]
+    test dl, 0x80
+    jz load_loop
+    mov ah, 0x41
+    mov bx, 0x55AA
+    int 0x13
+    jc load_loop
+    cmp bx, 0xAA55
+    jne load_loop
+    test cl, 1                ; packet (AH=42h) access supported
+    jz load_loop
+    inc byte [use_edd]
 
 load_loop:
-    cmp si, 0
-    je load_done
-
-    ; Prepare CHS
-    mov dl, [boot_drive]   ; drive
-    mov ah, 0x02           ; read sectors
-    mov al, 1              ; read 1 sector per call (simple, small)
-    mov ch, [cyl]          ; cylinder
-    mov dh, [head]         ; head
-    mov cl, [sector]       ; sector (1..SPT)
-
-    ; BIOS read: INT 13h, retry on error
-    push si                ; preserve remaining count
-    mov bp, 3              ; retry count
-.read_retry:
-    int 0x13
-    jnc .read_ok
+    mov cx, [remaining]
+    test cx, cx
+    jz load_done
+    cmp cx, BOUNCE_SECTORS
+    jbe .n_ok
+    mov cx, BOUNCE_SECTORS
+.n_ok:
+    mov bp, 3                 ; tries
+.retry:
+    push cx
+    call read_chunk
+    pop cx
+    jnc .copy
     dec bp
     jz disk_error
-    mov ah, 0x00           ; reset disk
+    xor ax, ax                ; reset disk
     mov dl, [boot_drive]
     int 0x13
-    jmp .read_retry
-.read_ok:
-    pop si
-
-    ; Advance destination ES:BX by 512 bytes
-    add bx, 512
-    jnc .no_carry
-    mov ax, es
-    add ax, 0x20            ; 512 bytes = 32 paragraphs
-    mov es, ax
-.no_carry:
-
-    ; Decrement remaining
-    dec si
-
-    ; Advance CHS: S++ ; if S>SPT: S=1,H++; if H==HEADS: H=0,C++
-    inc byte [sector]
-    mov al, [sector]
-    cmp al, SPT+1
-    jb load_loop
-    mov byte [sector], 1
-    inc byte [head]
-    mov al, [head]
-    cmp al, HEADS
-    jb load_loop
-    mov byte [head], 0
-    inc byte [cyl]
+    jmp .retry
+
+.copy:
+    ; [dap_count] sectors from the bounce buffer to [dest]
+    call go_unreal
+    movzx ecx, word [dap_count]
+    shl ecx, 7                ; dwords
+    mov esi, BOUNCE_SEG * 16
+    mov edi, [dest]
+    cld
+    a32 rep movsd
+    mov [dest], edi
+    movzx eax, word [dap_count]
+    add [dap_lba], eax
+    sub [remaining], ax
     jmp load_loop
 
+; Read up to CX sectors at [dap_lba] into the bounce buffer; CF on error,
+; [dap_count] = sectors read
+read_chunk:
+    mov [dap_count], cx
+    mov dl, [boot_drive]
+    cmp byte [use_edd], 0
+    je .chs
+    mov si, dap
+    mov ah, 0x42
+    int 0x13
+    ret
+.chs:
+    ; LBA -> CHS, stopping at the end of the track
+    mov ax, [dap_lba]         ; a floppy's LBA fits in 16 bits
+    xor dx, dx
+    mov bx, SPT
+    div bx                    ; AX = track, DX = sector - 1
+    sub bx, dx                ; sectors left on the track
+    cmp cx, bx
+    jbe .fits
+    mov [dap_count], bx
+.fits:
+    mov cl, dl
+    inc cl                    ; sector (1..SPT)
+    shr ax, 1                 ; HEADS = 2: cylinder, head in CF
+    mov ch, al
+    mov dh, 0
+    adc dh, 0
+    mov dl, [boot_drive]
+    push es
+    push word BOUNCE_SEG
+    pop es
+    xor bx, bx
+    mov ah, 0x02
+    mov al, [dap_count]
+    int 0x13
+    pop es
+    ret
+
+; DS and ES get base 0 and 4 GiB limits that survive the return to real
+; mode. BIOS calls may reload them, so this runs before every copy.
+go_unreal:
+    cli
+    mov eax, cr0
+    or al, 1
+    mov cr0, eax
+    jmp $+2
+    mov bx, 0x10
+    mov ds, bx
+    mov es, bx
+    and al, 0xFE
+    mov cr0, eax
+    xor bx, bx
+    mov ds, bx
+    mov es, bx
+    sti
+    ret
+
 load_done:
+    ; Boot timing: bootinfo_tsc_t with the kernel-loaded TSC to 0000:7E00,
+    ; copied backwards so the magic is written last (ds = es = 0)
+    rdtsc
+    mov [tsc_block+16], eax
+    mov [tsc_block+20], edx
+    mov si, tsc_block+20
+    mov di, BOOTINFO_TSC_ADDR+20
+    mov cx, 6
+    std
+    rep movsd
+    cld
+
 %ifdef ENABLE_VBE
-    ; Try to set a VBE LFB mode and write boot framebuffer info at 0x70000
-    push ds
-    push es
+    ; Try to set a VBE LFB mode. The BIOS writes the mode info block to
+    ; 0x7000:0100, where fb_init reads the geometry; the header only says
+    ; it is there
     mov ax, 0x4F02
     mov bx, VBE_MODE | 0x4000  ; request LFB
     int 0x10
     cmp ax, 0x004F
     jne .vbe_done
-
-    ; Query mode info into 0x7000:0100
-    mov ax, FB_BOOTINFO_SEG
-    mov es, ax
+    push es
+    push word FB_BOOTINFO_SEG
+    pop es
     mov di, 0x0100
     mov ax, 0x4F01
     mov cx, VBE_MODE
     int 0x10
     cmp ax, 0x004F
-    jne .vbe_done
-
-    ; Write bootinfo header at 0x7000:0000
-    ; magic 0xB007F00D
-    mov ax, FB_BOOTINFO_SEG
-    mov es, ax
+    jne .vbe_fail
     mov dword [es:0], 0xB007F00D
     mov word  [es:4], 1       ; present
-    mov word  [es:6], 0       ; reserved
-    ; width, height, pitch, bpp from mode info at es:0100
-    mov ax, [es:0x0100 + 0x12]
-    mov [es:8], ax
-    mov ax, [es:0x0100 + 0x14]
-    mov [es:10], ax
-    mov ax, [es:0x0100 + 0x10]
-    mov [es:12], ax
-    mov al, [es:0x0100 + 0x19]
-    mov [es:14], al
-    mov byte [es:15], 0
-    mov eax, [es:0x0100 + 0x28]
-    mov [es:16], eax
-
-.vbe_done:
+.vbe_fail:
     pop es
-    pop ds
+.vbe_done:
 %endif
 
     ; Debug: print 'L' after load
     mov al, 'L'
     call print_char
 
-    ; Enable A20 via fast gate
-    in al, 0x92
-    or al, 00000010b
-    out 0x92, al
-
-    ; Load GDT and enter protected mode
-    lgdt [gdt_descriptor]
+    ; Enter protected mode (A20 and the GDT were set up before loading)
+    cli
     mov eax, cr0
     or eax, 1
     mov cr0, eax
@@ -209,9 +263,14 @@ gdt_descriptor:
 
 ; ---- Data ----
 boot_drive: db 0
-sector: db 0
-head:   db 0
-cyl:    db 0
+use_edd:    db 0
+remaining:  dw KERNEL_SECTORS
+dest:       dd KERNEL_LOAD_ADDR
+dap:        db 0x10, 0        ; EDD disk address packet
+dap_count:  dw 0
+            dw 0, BOUNCE_SEG  ; buffer offset, segment
+dap_lba:    dd KERNEL_LBA, 0
+tsc_block:  dd BOOTINFO_TSC_MAGIC, 0, 0, 0, 0, 0   ; magic, reserved, entry, loaded
 
 ; Boot signature
 TIMES 510 - ($ - $$) db 0
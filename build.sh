@@ -24,6 +24,23 @@ KERNEL_WINDOW_C="$KDIR/window.c"
 KERNEL_FB_C="$KDIR/fb.c"
 KERNEL_GUI_C="$KDIR/gui.c"
 KERNEL_SERIAL_C="$KDIR/serial.c"
+KERNEL_IDT_C="$KDIR/idt.c"
+KERNEL_WQ_C="$KDIR/workqueue.c"
+KERNEL_IDT_ASM="$KDIR/idt.asm"
+KERNEL_KLOG_C="$KDIR/klog.c"
+KERNEL_TSC_C="$KDIR/tsc.c"
+KERNEL_FONT_C="$KDIR/font.c"
+KERNEL_FONTDATA_C="$KDIR/font8x16.c"
+KERNEL_SURFACE_C="$KDIR/surface.c"
+KERNEL_WM_C="$KDIR/wm.c"
+KERNEL_CPU_C="$KDIR/cpu.c"
+KERNEL_DOM_C="$KDIR/dom.c"
+KERNEL_SCRIPT_C="$KDIR/script.c"
+KERNEL_CSS_C="$KDIR/css.c"
+KERNEL_SHELL_C="$KDIR/shell.c"
+KERNEL_BENCH_C="$KDIR/bench.c"
+KERNEL_HISTORY_C="$KDIR/history.c"
+KERNEL_BOOTPROF_C="$KDIR/bootprof.c"
 KERNEL_ENTRY_ASM="$KDIR/kernel_entry.asm"
 LINKER_SCRIPT="$KDIR/kernel.ld"
 KOBJ_C="$BUILD/kernel.o"
@@ -39,6 +56,23 @@ KOBJ_WINDOW="$BUILD/window.o"
 KOBJ_FB="$BUILD/fb.o"
 KOBJ_GUI="$BUILD/gui.o"
 KOBJ_SERIAL="$BUILD/serial.o"
+KOBJ_IDT="$BUILD/idt.o"
+KOBJ_WQ="$BUILD/workqueue.o"
+KOBJ_IDT_ASM="$BUILD/idt_stubs.o"
+KOBJ_KLOG="$BUILD/klog.o"
+KOBJ_TSC="$BUILD/tsc.o"
+KOBJ_FONT="$BUILD/font.o"
+KOBJ_FONTDATA="$BUILD/font8x16.o"
+KOBJ_SURFACE="$BUILD/surface.o"
+KOBJ_WM="$BUILD/wm.o"
+KOBJ_CPU="$BUILD/cpu.o"
+KOBJ_DOM="$BUILD/dom.o"
+KOBJ_SCRIPT="$BUILD/script.o"
+KOBJ_CSS="$BUILD/css.o"
+KOBJ_SHELL="$BUILD/shell.o"
+KOBJ_BENCH="$BUILD/bench.o"
+KOBJ_HISTORY="$BUILD/history.o"
+KOBJ_BOOTPROF="$BUILD/bootprof.o"
 KOBJ_ENTRY="$BUILD/kernel_entry.o"
 KELF="$BUILD/kernel.elf"
 KBIN="$BUILD/kernel.bin"
@@ -63,6 +97,12 @@ else
   MAKE_HDD_IMAGE=1
 fi
 
+# HEADLESS=1: run /init/rc at boot with the console mirrored to COM1 (for
+# qemu -nographic); INIT_RC=<file> replaces the default /init/rc
+if [[ "${HEADLESS:-0}" == "1" ]]; then
+  CDEFS="$CDEFS -DHEADLESS_BOOT=1"
+fi
+
 CFLAGS_COMMON="-m32 -ffreestanding -fno-pic -fno-builtin -fno-stack-protector -nostdlib $CDEFS"
 
 # Assemble bootloader later, after we know kernel sectors
@@ -83,6 +123,25 @@ echo "Compiling VFS/RAMFS/initrd..."
 gcc $CFLAGS_COMMON -c "$KERNEL_VFS_C" -o "$KOBJ_VFS"
 gcc $CFLAGS_COMMON -c "$KERNEL_RAMFS_C" -o "$KOBJ_RAMFS"
 gcc $CFLAGS_COMMON -c "$KERNEL_INITRD_C" -o "$KOBJ_INITRD"
+KOBJ_EXTRA=""
+if [[ -n "${INIT_RC:-}" ]]; then
+  # Strong initrd_blob overriding the weak default: one "file:" line each,
+  # with backslashes doubled and newlines written as \n
+  echo "Embedding $INIT_RC as /init/rc..."
+  {
+    printf 'file:/etc/motd=Welcome to foxos\nfile:/init/hello.txt=Hello initrd\nfile:/init/rc='
+    sed -e 's/\\/\\\\/g' "$INIT_RC" | awk 'BEGIN { ORS = "\\n" } { print }'
+    printf '\n'
+  } > "$BUILD/initrd_blob.txt"
+  {
+    echo 'const unsigned char initrd_blob[] = {'
+    od -An -v -tx1 "$BUILD/initrd_blob.txt" | sed 's/ *\([0-9a-f][0-9a-f]\)/0x\1,/g'
+    echo '};'
+    echo "const unsigned int initrd_size = $(stat -c%s "$BUILD/initrd_blob.txt");"
+  } > "$BUILD/initrd_blob.c"
+  gcc $CFLAGS_COMMON -c "$BUILD/initrd_blob.c" -o "$BUILD/initrd_blob.o"
+  KOBJ_EXTRA="$BUILD/initrd_blob.o"
+fi
 
 echo "Compiling ATA driver..."
 gcc $CFLAGS_COMMON -c "$KERNEL_ATA_C" -o "$KOBJ_ATA"
@@ -99,53 +158,115 @@ gcc $CFLAGS_COMMON -c "$KERNEL_FB_C" -o "$KOBJ_FB"
 echo "Compiling gui..."
 gcc $CFLAGS_COMMON -c "$KERNEL_GUI_C" -o "$KOBJ_GUI"
 
+echo "Compiling font + glyph cache..."
+gcc $CFLAGS_COMMON -c "$KERNEL_FONT_C" -o "$KOBJ_FONT"
+gcc $CFLAGS_COMMON -c "$KERNEL_FONTDATA_C" -o "$KOBJ_FONTDATA"
+gcc $CFLAGS_COMMON -c "$KERNEL_SURFACE_C" -o "$KOBJ_SURFACE"
+gcc $CFLAGS_COMMON -c "$KERNEL_WM_C" -o "$KOBJ_WM"
+gcc $CFLAGS_COMMON -c "$KERNEL_CPU_C" -o "$KOBJ_CPU"
+gcc $CFLAGS_COMMON -c "$KERNEL_DOM_C" -o "$KOBJ_DOM"
+gcc $CFLAGS_COMMON -c "$KERNEL_SCRIPT_C" -o "$KOBJ_SCRIPT"
+gcc $CFLAGS_COMMON -c "$KERNEL_CSS_C" -o "$KOBJ_CSS"
+gcc $CFLAGS_COMMON -c "$KERNEL_SHELL_C" -o "$KOBJ_SHELL"
+gcc $CFLAGS_COMMON -c "$KERNEL_BENCH_C" -o "$KOBJ_BENCH"
+gcc $CFLAGS_COMMON -c "$KERNEL_HISTORY_C" -o "$KOBJ_HISTORY"
+gcc $CFLAGS_COMMON -c "$KERNEL_BOOTPROF_C" -o "$KOBJ_BOOTPROF"
+
 echo "Compiling serial..."
 gcc $CFLAGS_COMMON -c "$KERNEL_SERIAL_C" -o "$KOBJ_SERIAL"
 
+echo "Compiling klog..."
+gcc $CFLAGS_COMMON -c "$KERNEL_KLOG_C" -o "$KOBJ_KLOG"
+
+echo "Compiling TSC calibration..."
+gcc $CFLAGS_COMMON -c "$KERNEL_TSC_C" -o "$KOBJ_TSC"
+
+echo "Compiling interrupts/work queues..."
+gcc $CFLAGS_COMMON -c "$KERNEL_IDT_C" -o "$KOBJ_IDT"
+gcc $CFLAGS_COMMON -c "$KERNEL_WQ_C" -o "$KOBJ_WQ"
+
 echo "Assembling kernel entry..."
 nasm -f elf32 "$KERNEL_ENTRY_ASM" -o "$KOBJ_ENTRY"
+nasm -f elf32 "$KERNEL_IDT_ASM" -o "$KOBJ_IDT_ASM"
 
 echo "Linking kernel (ELF via $LINKER_SCRIPT)..."
 ld -m elf_i386 -T "$LINKER_SCRIPT" -nostdlib -o "$KELF" \
-  "$KOBJ_ENTRY" "$KOBJ_C" "$KOBJ_KBD" "$KOBJ_CONS" "$KOBJ_MEM" "$KOBJ_VFS" "$KOBJ_RAMFS" "$KOBJ_INITRD" "$KOBJ_ATA" "$KOBJ_RENDER" "$KOBJ_WINDOW" "$KOBJ_FB" "$KOBJ_GUI" "$KOBJ_SERIAL"
+  "$KOBJ_ENTRY" "$KOBJ_C" "$KOBJ_KBD" "$KOBJ_CONS" "$KOBJ_MEM" "$KOBJ_VFS" "$KOBJ_RAMFS" "$KOBJ_INITRD" "$KOBJ_ATA" "$KOBJ_RENDER" "$KOBJ_WINDOW" "$KOBJ_FB" "$KOBJ_GUI" "$KOBJ_SERIAL" \
+  "$KOBJ_IDT" "$KOBJ_WQ" "$KOBJ_IDT_ASM" "$KOBJ_KLOG" "$KOBJ_TSC" \
+  "$KOBJ_FONT" "$KOBJ_FONTDATA" "$KOBJ_SURFACE" "$KOBJ_WM" "$KOBJ_CPU" "$KOBJ_DOM" "$KOBJ_SCRIPT" "$KOBJ_CSS" "$KOBJ_SHELL" "$KOBJ_BENCH" "$KOBJ_HISTORY" "$KOBJ_BOOTPROF" $KOBJ_EXTRA
 
 echo "Converting kernel to flat binary..."
 objcopy -O binary "$KELF" "$KBIN"
 
+# COMPRESS=1 (default): the loader reads an LZ4-packed image whose stub
+# unpacks kernel.bin (initrd included) to its link address; COMPRESS=0
+# loads kernel.bin itself
+KIMG="$KBIN"
+LOAD_ADDR=0x00100000
+if [[ "${COMPRESS:-1}" == "1" ]]; then
+  echo "Compressing kernel..."
+  "${HOSTCC:-cc}" -O2 -I"$KDIR" tools/lz4pack.c "$KDIR/lz4.c" -o "$BUILD/lz4pack"
+  "$BUILD/lz4pack" "$KBIN" "$BUILD/kernel.lz4"
+  objcopy -I binary -O elf32-i386 -B i386 --rename-section .data=.payload,alloc,load,readonly,data,contents \
+    "$BUILD/kernel.lz4" "$BUILD/payload.o"
+
+  echo "Building decompression stub..."
+  # Optimized unlike the kernel: the stub's time is all decompression
+  gcc $CFLAGS_COMMON -O2 -ffunction-sections -c "$KDIR/stub.c" -o "$BUILD/stub.o"
+  gcc $CFLAGS_COMMON -O2 -ffunction-sections -c "$KDIR/lz4.c" -o "$BUILD/lz4.o"
+  nasm -f elf32 "$KDIR/stub_entry.asm" -o "$BUILD/stub_entry.o"
+  ld -m elf_i386 -T "$KDIR/stub.ld" -nostdlib --gc-sections -o "$BUILD/stub.elf" \
+    "$BUILD/stub_entry.o" "$BUILD/stub.o" "$BUILD/lz4.o" "$BUILD/payload.o"
+
+  # The kernel is unpacked below the stub and must not run into it
+  LOAD_ADDR=$(readelf -h "$BUILD/stub.elf" | awk '/Entry point/ { print $4 }')
+  KEND=0x$(nm "$KELF" | awk '$3 == "__bss_end" { print $1 }')
+  if (( KEND > LOAD_ADDR )); then
+    echo "Error: kernel ends at $KEND, past the stub at $LOAD_ADDR (kernel/stub.ld)" >&2
+    exit 1
+  fi
+  KIMG="$BUILD/kernel.img"
+  objcopy -O binary "$BUILD/stub.elf" "$KIMG"
+fi
+
 # Calculate sectors for loader (ceil(size/512))
-KBIN_SIZE=$(stat -c%s "$KBIN")
+KBIN_SIZE=$(stat -c%s "$KIMG")
 SECTORS=$(( (KBIN_SIZE + 511) / 512 ))
-echo "Kernel size: $KBIN_SIZE bytes -> $SECTORS sectors"
+echo "Boot image size: $KBIN_SIZE bytes -> $SECTORS sectors, loaded at $LOAD_ADDR"
 
-# Pad kernel to full sectors so image data matches sectors read
+# Pad image to full sectors so image data matches sectors read
 PAD=$(( SECTORS * 512 - KBIN_SIZE ))
 if (( PAD > 0 )); then
-  echo "Padding kernel by $PAD bytes to align to $SECTORS*512"
-  dd if=/dev/zero bs=1 count=$PAD status=none >> "$KBIN"
+  echo "Padding image by $PAD bytes to align to $SECTORS*512"
+  dd if=/dev/zero bs=1 count=$PAD status=none >> "$KIMG"
 fi
 
 # Recompute size sanity
-KBIN_SIZE2=$(stat -c%s "$KBIN")
+KBIN_SIZE2=$(stat -c%s "$KIMG")
 if (( KBIN_SIZE2 != SECTORS * 512 )); then
-  echo "Error: padded kernel size ($KBIN_SIZE2) != SECTORS*512 ($((SECTORS*512)))" >&2
+  echo "Error: padded image size ($KBIN_SIZE2) != SECTORS*512 ($((SECTORS*512)))" >&2
   exit 1
 fi
 
-# Assemble bootloader with KERNEL_SECTORS macro
-echo "Assembling bootloader with KERNEL_SECTORS=$SECTORS..."
-nasm -f bin -DKERNEL_SECTORS=$SECTORS "$BOOTLOADER" -o "$BOOT_BIN"
+# Verify a boot sector is exactly 512 bytes with signature 0x55AA
+check_boot_sector() {
+  local size sig
+  size=$(stat -c%s "$1")
+  if (( size != 512 )); then
+    echo "Error: $1 size is $size, expected 512" >&2
+    exit 1
+  fi
+  sig=$(hexdump -v -e '1/1 "%02x"' -s 510 -n 2 "$1")
+  if [[ "$sig" != "55aa" && "$sig" != "55AA" ]]; then
+    echo "Error: $1 missing 0x55AA signature (got $sig)" >&2
+    exit 1
+  fi
+}
 
-# Verify bootloader size is exactly 512 and signature 0x55AA
-BOOT_SIZE=$(stat -c%s "$BOOT_BIN")
-if (( BOOT_SIZE != 512 )); then
-  echo "Error: bootloader size is $BOOT_SIZE, expected 512" >&2
-  exit 1
-fi
-SIG=$(hexdump -v -e '1/1 "%02x"' -s 510 -n 2 "$BOOT_BIN")
-if [[ "$SIG" != "55aa" && "$SIG" != "55AA" ]]; then
-  echo "Error: bootloader missing 0x55AA signature (got $SIG)" >&2
-  exit 1
-fi
+# Assemble bootloader with KERNEL_SECTORS macro (kernel at LBA 1 on the floppy)
+echo "Assembling bootloader with KERNEL_SECTORS=$SECTORS..."
+nasm -f bin -DKERNEL_SECTORS=$SECTORS -DKERNEL_LOAD_ADDR=$LOAD_ADDR "$BOOTLOADER" -o "$BOOT_BIN"
+check_boot_sector "$BOOT_BIN"
 
 # Always create a floppy boot image for reliable boot
 echo "Creating floppy image..."
@@ -153,8 +274,8 @@ IMG="$BUILD/os.img"
 dd if=/dev/zero of="$IMG" bs=512 count=2880 status=none
 echo "Writing boot sector..."
 dd if="$BOOT_BIN" of="$IMG" conv=notrunc status=none
-echo "Writing kernel at LBA 1..$SECTORS..."
-dd if="$KBIN" of="$IMG" bs=512 seek=1 conv=notrunc status=none
+echo "Writing boot image at LBA 1..$SECTORS..."
+dd if="$KIMG" of="$IMG" bs=512 seek=1 conv=notrunc status=none
 
 echo "Done. Floppy Image: $IMG"
 
@@ -168,12 +289,18 @@ if (( MAKE_HDD_IMAGE )); then
   echo "Writing MBR with one partition..."
   nasm -f bin -DPT_LBA_START=${PART_START:-2048} -DPT_LBA_COUNT=$(( SECTORS_TOTAL - ${PART_START:-2048} )) mbr_pt.asm -o "$BUILD/mbr.bin"
   dd if="$BUILD/mbr.bin" of="$HDD_IMG" conv=notrunc status=none
-  echo "Writing VBR (bootloader) at LBA ${PART_START:-2048}..."
-  dd if="$BOOT_BIN" of="$HDD_IMG" bs=512 seek=${PART_START:-2048} conv=notrunc status=none
+  # Same bootloader, reading the kernel from the sector after the VBR
+  echo "Writing VBR (bootloader, kernel at LBA $(( ${PART_START:-2048} + 1 ))) at LBA ${PART_START:-2048}..."
+  nasm -f bin -DKERNEL_SECTORS=$SECTORS -DKERNEL_LOAD_ADDR=$LOAD_ADDR -DKERNEL_LBA=$(( ${PART_START:-2048} + 1 )) "$BOOTLOADER" -o "$BUILD/vbr.bin"
+  check_boot_sector "$BUILD/vbr.bin"
+  dd if="$BUILD/vbr.bin" of="$HDD_IMG" bs=512 seek=${PART_START:-2048} conv=notrunc status=none
   echo "Writing kernel right after VBR..."
-  dd if="$KBIN" of="$HDD_IMG" bs=512 seek=$(( ${PART_START:-2048} + 1 )) conv=notrunc status=none
+  dd if="$KIMG" of="$HDD_IMG" bs=512 seek=$(( ${PART_START:-2048} + 1 )) conv=notrunc status=none
   echo "Done. HDD Image: $HDD_IMG"
   echo "Run: qemu-system-i386 -m 64 -serial stdio -boot a -drive file=$IMG,if=floppy,format=raw -drive id=hdd,file=$HDD_IMG,if=none,format=raw -device ide-hd,drive=hdd,bus=ide.0"
 else
   echo "Run: qemu-system-i386 -m 64 -serial stdio -boot a -drive file=$IMG,if=floppy,format=raw"
 fi
+if [[ "${HEADLESS:-0}" == "1" ]]; then
+  echo "Headless: qemu-system-i386 -m 64 -nographic -boot a -drive file=$IMG,if=floppy,format=raw -device isa-debug-exit,iobase=0xf4,iosize=0x04"
+fi
@@ -1,6 +1,15 @@
 #include <stdint.h>
 #include "io.h"
 #include "ata.h"
+#include "console.h"
+#include "shell.h"
+
+#ifndef DISK_SECTORS
+#define DISK_SECTORS 2880
+#endif
+#ifndef PT_LBA_START
+#define PT_LBA_START 0
+#endif
 
 // Primary bus IO ports
 #define ATA_IO_BASE   0x1F0
@@ -36,7 +45,13 @@ static uint8_t status_wait(uint8_t mask, uint8_t match){
     return s;
 }
 
+static int cmd_disk(int argc, char** argv);
+static const shell_cmd_t disk_cmd = { "disk", cmd_disk,
+    "disk info\ndisk list\ndisk mkpt N\ndisk mkpart i s c t\ndisk clear",
+    "show disk mode/size/sectors\nlist MBR partitions\ncreate N primary partitions\nset entry i=start,count,typeHex\nzero the MBR (keep 0x55AA)", 0 };
+
 int ata_init(void){
+    shell_register(&disk_cmd);
     // Select master, LBA
     outb(REG_HDDEV, 0xE0);
     ata_delay400ns();
@@ -96,3 +111,61 @@ int ata_pio_write28(uint32_t lba, const void* buf){
     status_wait(STATUS_BSY, 0);
     return 0;
 }
+
+// ---- disk command: MBR inspection and editing ----
+
+static void mbr_zero(uint8_t* m){ for(int i=0;i<512;++i) m[i]=0; m[510]=0x55; m[511]=0xAA; }
+static void mbr_set_entry(uint8_t* m, int idx, uint8_t boot, uint8_t type, uint32_t lba_start, uint32_t lba_count){ int o=446+idx*16; m[o+0]=boot; m[o+1]=0; m[o+2]=0; m[o+3]=0; m[o+4]=type; m[o+5]=0xFF; m[o+6]=0xFF; m[o+7]=0xFF; m[o+8]=(uint8_t)(lba_start&0xFF); m[o+9]=(uint8_t)((lba_start>>8)&0xFF); m[o+10]=(uint8_t)((lba_start>>16)&0xFF); m[o+11]=(uint8_t)((lba_start>>24)&0xFF); m[o+12]=(uint8_t)(lba_count&0xFF); m[o+13]=(uint8_t)((lba_count>>8)&0xFF); m[o+14]=(uint8_t)((lba_count>>16)&0xFF); m[o+15]=(uint8_t)((lba_count>>24)&0xFF); }
+static int mbr_read(uint8_t* m){ return ata_pio_read28(0,m); }
+static int mbr_write(const uint8_t* m){ return ata_pio_write28(0,m); }
+static void print_part(int idx, uint8_t boot, uint8_t type, uint32_t s, uint32_t c){ sh_write("#"); char nb[4]; u32_to_dec((uint32_t)idx, nb); sh_write(nb); sh_write(" "); sh_write(boot?"* ":"  "); sh_write("type=0x"); char hx[3]; const char* hexd="0123456789ABCDEF"; hx[0]=hexd[(type>>4)&0xF]; hx[1]=hexd[type&0xF]; hx[2]=0; sh_write(hx); sh_write(" start="); char b1[16]; u32_to_dec(s,b1); sh_write(b1); sh_write(" count="); char b2[16]; u32_to_dec(c,b2); sh_writeln(b2); }
+
+static int cmd_disk(int argc, char** argv){
+    const char* p = argc > 1 ? argv[1] : "";
+    if (argc == 1) {
+#ifdef DISK_SIZE_MB
+        char b[16]; u32_to_dec(DISK_SIZE_MB, b);
+        sh_write("disk: hdd "); sh_write(b); sh_writeln("MB, 512-byte sectors");
+#else
+        sh_writeln("disk: hdd, 512-byte sectors");
+#endif
+    } else if (shell_streq(p, "info")) {
+        sh_writeln("mode: hdd");
+#ifdef DISK_SIZE_MB
+        sh_write("size: "); char b[16]; u32_to_dec(DISK_SIZE_MB, b); sh_write(b); sh_writeln(" MB");
+#endif
+        sh_write("sectors: "); char b2[16]; u32_to_dec(DISK_SECTORS, b2); sh_writeln(b2);
+    } else if (shell_streq(p, "list")) {
+        uint8_t m[512]; if (ata_available() && mbr_read(m)==0){ if (m[510]!=0x55||m[511]!=0xAA){ console_writeln("no MBR signature"); } else { for(int i=0;i<4;++i){ int o=446+i*16; uint8_t boot=m[o+0]; uint8_t type=m[o+4]; uint32_t s = (uint32_t)m[o+8] | ((uint32_t)m[o+9]<<8) | ((uint32_t)m[o+10]<<16) | ((uint32_t)m[o+11]<<24); uint32_t c = (uint32_t)m[o+12] | ((uint32_t)m[o+13]<<8) | ((uint32_t)m[o+14]<<16) | ((uint32_t)m[o+15]<<24); if(type!=0){ print_part(i,boot,type,s,c);} } } } else console_writeln("ata: no drive");
+    } else if (shell_streq(p, "mkpt")) {
+        uint32_t n=0; if(argc!=3 || parse_u32_dec(argv[2],&n)!=0 || n==0 || n>4){ console_writeln("usage: disk mkpt N (1..4)"); return -1; }
+        if(!ata_available()){ console_writeln("ata: no drive"); return -1; }
+        uint8_t m[512]; mbr_zero(m);
+        uint32_t base = (PT_LBA_START?PT_LBA_START:2048);
+        if (DISK_SECTORS<=base){ console_writeln("disk too small"); return -1; }
+        uint32_t avail = DISK_SECTORS - base;
+        uint32_t each = avail / n; if(each==0){ console_writeln("too many partitions"); return -1; }
+        for(uint32_t i=0;i<n && i<4;i++){
+            uint32_t start = base + i*each;
+            uint32_t count = (i==n-1)? (avail - i*each) : each;
+            mbr_set_entry(m,(int)i, (i==0)?0x80:0x00, 0x83, start, count);
+        }
+        if (mbr_write(m)==0) sh_writeln("ok"); else console_writeln("write failed");
+    } else if (shell_streq(p, "mkpart")) {
+        // disk mkpart i start count typeHex
+        uint32_t idx=0,start=0,count=0; uint8_t type=0;
+        if(argc!=6 || parse_u32_dec(argv[2],&idx)!=0 || idx>3 || parse_u32_dec(argv[3],&start)!=0 || parse_u32_dec(argv[4],&count)!=0 || parse_hex8(argv[5],&type)!=0){ console_writeln("usage: disk mkpart i start count typeHex"); return -1; }
+        if(!ata_available()){ console_writeln("ata: no drive"); return -1; }
+        uint8_t m[512]; if(mbr_read(m)!=0){ console_writeln("read failed"); return -1; }
+        if (m[510]!=0x55||m[511]!=0xAA) mbr_zero(m);
+        mbr_set_entry(m,(int)idx,(idx==0)?0x80:0x00,type,start,count);
+        if(mbr_write(m)==0) sh_writeln("ok"); else console_writeln("write failed");
+    } else if (shell_streq(p, "clear")) {
+        if(!ata_available()){ console_writeln("ata: no drive"); return -1; }
+        uint8_t m[512]; mbr_zero(m); if(mbr_write(m)==0) sh_writeln("ok"); else console_writeln("write failed");
+    } else {
+        console_writeln("usage: disk info|list|mkpt N|mkpart i start count type|clear");
+        return -1;
+    }
+    return 0;
+}
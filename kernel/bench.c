@@ -0,0 +1,303 @@
+#include <stdint.h>
+#include "bench.h"
+#include "io.h"
+#include "tsc.h"
+#include "memory.h"
+#include "vfs.h"
+#include "ramfs.h"
+#include "console.h"
+#include "serial.h"
+#include "fb.h"
+#include "wm.h"
+#include "ata.h"
+#include "shell.h"
+
+#ifndef PT_LBA_START
+#define PT_LBA_START 0
+#endif
+
+#define UC_BYTES   (256u * 1024u)
+#define RAMFS_N    32              // files per create/delete batch
+#define ATA_SPAN   2048            // sectors cycled through by ata_read
+
+typedef struct {
+    const char* name;
+    const char* what;
+    uint32_t bytes_per_op;
+    int (*setup)(void);            // optional; <0 unavailable, other nonzero failed
+    uint64_t (*run)(uint32_t iters);
+    void (*teardown)(void);
+} bench_t;
+
+// Interrupts stay off while a batch is timed so IRQ work does not land in it
+static uint32_t t_flags; static uint64_t t_start;
+static inline void tick(void){ t_flags = irq_save(); t_start = rdtsc(); }
+static inline uint64_t tock(void){ uint64_t c = rdtsc() - t_start; irq_restore(t_flags); return c; }
+
+static uint8_t blk[4096];
+static uint32_t op_bytes;          // set by a setup when bytes/op depends on the machine
+
+// ---- memory ----
+
+static uint64_t run_uc_alloc(uint32_t iters){
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) uc_free(uc_alloc(4096));
+    return tock();
+}
+
+static uchandle_t uc_h;
+static int setup_uc(void){
+    uc_h = uc_alloc(UC_BYTES);
+    if (!uc_h) return -3;
+    for (uint32_t off = 0; off < UC_BYTES; off += sizeof(blk)) uc_pwrite(uc_h, off, blk, sizeof(blk));
+    return 0;
+}
+static void teardown_uc(void){ uc_free(uc_h); uc_h = 0; }
+
+static uint64_t run_uc_write(uint32_t iters){
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) uc_pwrite(uc_h, (i % (UC_BYTES / sizeof(blk))) * sizeof(blk), blk, sizeof(blk));
+    return tock();
+}
+
+static uint64_t run_uc_read(uint32_t iters){
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) uc_read(uc_h, (i % (UC_BYTES / sizeof(blk))) * sizeof(blk), blk, sizeof(blk));
+    return tock();
+}
+
+// ---- ramfs ----
+
+static char names[RAMFS_N][16];
+
+static void make_files(void){ for (int i = 0; i < RAMFS_N; ++i) vfs_write(names[i], "x", 1); }
+static void remove_files(void){ for (int i = 0; i < RAMFS_N; ++i) vfs_rm(names[i]); }
+
+static int setup_ramfs(void){
+    for (int i = 0; i < RAMFS_N; ++i){
+        const char* p = "/.bench/f"; int n = 0;
+        while (*p) names[i][n++] = *p++;
+        names[i][n++] = (char)('0' + i / 10); names[i][n++] = (char)('0' + i % 10); names[i][n] = 0;
+    }
+    return vfs_mkdir("/.bench") == 0 ? 0 : -3;
+}
+static int setup_ramfs_filled(void){ int r = setup_ramfs(); if (!r) make_files(); return r; }
+static void teardown_ramfs(void){ remove_files(); vfs_rm("/.bench"); }
+
+static uint64_t run_ramfs_create(uint32_t iters){
+    uint64_t c = 0;
+    for (uint32_t i = 0; i < iters; i += RAMFS_N){
+        uint32_t n = iters - i < RAMFS_N ? iters - i : RAMFS_N;
+        tick();
+        for (uint32_t k = 0; k < n; ++k) vfs_write(names[k], "x", 1);
+        c += tock();
+        remove_files();
+    }
+    return c;
+}
+
+static uint64_t run_ramfs_delete(uint32_t iters){
+    uint64_t c = 0;
+    for (uint32_t i = 0; i < iters; i += RAMFS_N){
+        uint32_t n = iters - i < RAMFS_N ? iters - i : RAMFS_N;
+        make_files();
+        tick();
+        for (uint32_t k = 0; k < n; ++k) vfs_rm(names[k]);
+        c += tock();
+        remove_files();
+    }
+    return c;
+}
+
+static uint64_t run_ramfs_lookup(uint32_t iters){
+    uint32_t found = 0;
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) found += ramfs_find(names[i % RAMFS_N]) != 0;
+    uint64_t c = tock();
+    return found == iters ? c : 0;
+}
+
+static uint64_t run_ramfs_stat(uint32_t iters){
+    vfs_stat_t st;
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) vfs_stat(names[i % RAMFS_N], &st);
+    return tock();
+}
+
+static uint64_t run_path_resolve(uint32_t iters){
+    char out[SHELL_PATH_MAX];
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) shell_path(out, "../usr/./lib/../bin/tool");
+    return tock();
+}
+
+// ---- console ----
+
+static console_mirror_fn saved_mirror;
+static int setup_console(void){ saved_mirror = console_set_mirror(0); return 0; }
+// The scrolled-in junk is wiped; results are printed after all benchmarks
+static void teardown_console(void){ console_set_mirror(saved_mirror); console_clear(); }
+
+// One full line: scroll the shadow, save the row to scrollback, repaint
+static uint64_t run_console_scroll(uint32_t iters){
+    static const char line[] = "bench: console scroll 0123456789 abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRS";
+    tick();
+    for (uint32_t i = 0; i < iters; ++i){ console_writeln(line); console_flush(); }
+    return tock();
+}
+
+// ---- framebuffer ----
+
+static int setup_fb(void){
+    if (!g_fb.present || g_fb.width <= 64 || g_fb.height <= 64) return -2;
+    op_bytes = 64u * 64u * (uint32_t)g_fbops->bytespp;
+    return 0;
+}
+static void teardown_fb(void){ wm_damage_screen(0, 0, g_fb.width, g_fb.height); wm_render(); }
+
+static uint64_t run_fb_fill(uint32_t iters){
+    uint32_t seed = 12345, wx = (uint32_t)g_fb.width - 64, wy = (uint32_t)g_fb.height - 64;
+    tick();
+    for (uint32_t i = 0; i < iters; ++i){
+        seed = seed*1664525u + 1013904223u;
+        fb_fill_rect((int)((seed >> 8) % wx), (int)((seed >> 20) % wy), 64, 64, 0x00336699u ^ i);
+    }
+    return tock();
+}
+
+// ---- disk ----
+
+static int setup_ata(void){
+#ifdef DISK_MODE_HDD
+    return ata_available() ? 0 : -2;
+#else
+    return -2;
+#endif
+}
+
+static uint64_t run_ata_read(uint32_t iters){
+    tick();
+    for (uint32_t i = 0; i < iters; ++i) ata_pio_read28(PT_LBA_START + i % ATA_SPAN, blk);
+    return tock();
+}
+
+static const bench_t table[] = {
+    { "uc_alloc",      "uc_alloc(4 KiB) + uc_free",        0,    0,                  run_uc_alloc,       0 },
+    { "uc_write",      "uc_pwrite 4 KiB into 256 KiB",     4096, setup_uc,           run_uc_write,       teardown_uc },
+    { "uc_read",       "uc_read 4 KiB from 256 KiB",       4096, setup_uc,           run_uc_read,        teardown_uc },
+    { "ramfs_create",  "create a 1-byte file",             0,    setup_ramfs,        run_ramfs_create,   teardown_ramfs },
+    { "ramfs_lookup",  "find one of 32 files",             0,    setup_ramfs_filled, run_ramfs_lookup,   teardown_ramfs },
+    { "ramfs_stat",    "vfs_stat one of 32 files",         0,    setup_ramfs_filled, run_ramfs_stat,     teardown_ramfs },
+    { "ramfs_delete",  "remove a 1-byte file",             0,    setup_ramfs,        run_ramfs_delete,   teardown_ramfs },
+    { "path_resolve",  "resolve and normalize a path",     0,    0,                  run_path_resolve,   0 },
+    { "console_scroll","write a line, scroll, repaint",    0,    setup_console,      run_console_scroll, teardown_console },
+    { "fb_fill_rect",  "64x64 fill at random spots",       0,    setup_fb,           run_fb_fill,        teardown_fb },
+    { "ata_read",      "sequential PIO sector reads",      512,  setup_ata,          run_ata_read,       0 },
+};
+#define NBENCH ((int)(sizeof(table)/sizeof(table[0])))
+
+static const bench_t* find(const char* name){
+    for (int i = 0; i < NBENCH; ++i) if (shell_streq(table[i].name, name)) return &table[i];
+    return 0;
+}
+
+static int measure(const bench_t* b, bench_result_t* out){
+    uint64_t target = (uint64_t)tsc_khz() * BENCH_REP_MS;
+    if (!target) return -3;
+    // Double until a batch takes an eighth of the target, then scale up
+    uint32_t iters = 1; uint64_t c = 0;
+    for (;;){
+        c = b->run(iters);
+        if (!c) return -3;
+        if (c >= target / 8 || iters >= (1u << 24)) break;
+        iters *= 2;
+    }
+    if (c < target){
+        uint64_t scaled = udiv64_32((uint64_t)iters * target, (uint32_t)(c >> 32 ? 0xFFFFFFFFu : c));
+        iters = scaled > (1u << 26) ? (1u << 26) : (uint32_t)scaled;
+    }
+    b->run(iters);      // warm-up
+    uint64_t reps[BENCH_REPS];
+    for (int r = 0; r < BENCH_REPS; ++r){
+        uint64_t v = b->run(iters);
+        if (!v) return -3;
+        int k = r;
+        while (k && reps[k-1] > v){ reps[k] = reps[k-1]; k--; }
+        reps[k] = v;
+    }
+    uint64_t med = reps[BENCH_REPS / 2];
+    out->name = b->name;
+    out->ops = iters;
+    out->cycles = med;
+    out->ops_per_sec = tsc_per_sec(iters, med);
+    out->cycles_per_op_x10 = (uint32_t)udiv64_32(med * 10, iters);
+    uint32_t bytes = op_bytes ? op_bytes : b->bytes_per_op;
+    out->kib_per_sec = bytes ? tsc_per_sec(((uint64_t)iters * bytes) >> 10, med) : 0;
+    out->spread_x10 = (uint32_t)udiv64_32((reps[BENCH_REPS-1] - reps[0]) * 1000, (uint32_t)(med >> 32 ? 0xFFFFFFFFu : med));
+    return 0;
+}
+
+int bench_run(const char* name, bench_result_t* out){
+    const bench_t* b = find(name);
+    if (!b) return -1;
+    op_bytes = 0;
+    int r = b->setup ? b->setup() : 0;
+    if (r) return r == -2 ? -2 : -3;
+    r = measure(b, out);
+    if (b->teardown) b->teardown();
+    return r;
+}
+
+// ---- output ----
+
+static void x10(uint32_t v, char* buf){
+    u32_to_dec(v / 10, buf);
+    int n = 0; while (buf[n]) n++;
+    buf[n++] = '.'; buf[n++] = (char)('0' + v % 10); buf[n] = 0;
+}
+
+// The result lines must not be dropped when the headless mirror fills the ring
+static void print_result(const bench_result_t* r){
+    char b[16];
+    sh_write("  "); sh_put_col(r->name, 15, 0);
+    u32_to_dec(r->ops_per_sec, b); sh_put_col(b, 11, 1); sh_write(" ops/s");
+    x10(r->cycles_per_op_x10, b); sh_put_col(b, 11, 1); sh_write(" cyc/op");
+    if (r->kib_per_sec){ u32_to_dec(r->kib_per_sec / 1024, b); sh_put_col(b, 6, 1); sh_write(" MiB/s"); }
+    else sh_write("            ");
+    sh_write("  +-"); x10(r->spread_x10, b); sh_write(b); sh_writeln("%");
+
+    serial_write_wait("bench name="); serial_write_wait(r->name);
+    serial_write_wait(" ops="); u32_to_dec(r->ops, b); serial_write_wait(b);
+    serial_write_wait(" cycles="); u32_to_dec((uint32_t)(r->cycles >> 32 ? 0xFFFFFFFFu : r->cycles), b); serial_write_wait(b);
+    serial_write_wait(" ops_per_sec="); u32_to_dec(r->ops_per_sec, b); serial_write_wait(b);
+    serial_write_wait(" cycles_per_op="); x10(r->cycles_per_op_x10, b); serial_write_wait(b);
+    serial_write_wait(" kib_per_sec="); u32_to_dec(r->kib_per_sec, b); serial_write_wait(b);
+    serial_write_wait(" spread_pct="); x10(r->spread_x10, b); serial_write_wait(b); serial_putc_wait('\n');
+}
+
+static int cmd_bench(int argc, char** argv){
+    if (argc == 2 && shell_streq(argv[1], "list")){
+        for (int i = 0; i < NBENCH; ++i){ sh_write("  "); sh_put_col(table[i].name, 15, 0); sh_writeln(table[i].what); }
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) if (!find(argv[i])){ console_write("bench: unknown benchmark "); console_writeln(argv[i]); return -1; }
+    // Collected first: console_scroll clears the screen when it finishes
+    bench_result_t res[NBENCH]; int nres = 0, failed = 0;
+    const char* skipped[NBENCH]; int nskip = 0;
+    int n = argc > 1 ? argc - 1 : NBENCH;
+    for (int i = 0; i < n && nres < NBENCH; ++i){
+        const char* name = argc > 1 ? argv[i + 1] : table[i].name;
+        int r = bench_run(name, &res[nres]);
+        if (r == 0) nres++;
+        else if (r == -2) { if (nskip < NBENCH) skipped[nskip++] = name; }
+        else { console_write("bench: "); console_write(name); console_writeln(" failed"); failed++; }
+    }
+    for (int i = 0; i < nres; ++i) print_result(&res[i]);
+    for (int i = 0; i < nskip; ++i){ sh_write("  "); sh_put_col(skipped[i], 15, 0); sh_writeln("skipped (not available)"); }
+    return failed ? -1 : 0;
+}
+
+static const shell_cmd_t bench_cmd = { "bench", cmd_bench, "bench [name...]\nbench list",
+    "time kernel hot paths (ops/s, cycles/op)\nlist the benchmarks", 0 };
+
+void bench_init(void){ shell_register(&bench_cmd); }
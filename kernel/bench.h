@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+// In-kernel microbenchmarks for the hot paths (`bench [name...]`). Each
+// benchmark times a batch of operations with the TSC and interrupts off.
+// The batch is sized to take about BENCH_REP_MS, run once to warm up and
+// then BENCH_REPS times; the median repetition is reported as ops/s and
+// cycles/op, with (max - min) / median as a stability figure. Every result
+// also goes to COM1 as one key=value line:
+//   bench name=uc_alloc ops=... cycles=... ops_per_sec=... cycles_per_op=812.3 kib_per_sec=... spread_pct=0.4
+
+#define BENCH_REPS   5
+#define BENCH_REP_MS 20
+
+typedef struct {
+    const char* name;
+    uint32_t ops;               // per repetition
+    uint64_t cycles;            // median repetition
+    uint32_t ops_per_sec;
+    uint32_t cycles_per_op_x10;
+    uint32_t kib_per_sec;       // 0 unless the benchmark moves data
+    uint32_t spread_x10;        // (max - min) / median, tenths of a percent
+} bench_result_t;
+
+void bench_init(void);          // registers `bench`
+// 0 ok, -1 unknown name, -2 not available here (no framebuffer, no disk),
+// -3 setup failed or the TSC is not calibrated
+int bench_run(const char* name, bench_result_t* out);
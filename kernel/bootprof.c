@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include "bootprof.h"
+#include "io.h"
+#include "tsc.h"
+#include "serial.h"
+#include "shell.h"
+#include "console.h"
+
+typedef struct { const char* name; uint64_t start, end; } stage_t;
+
+static stage_t stages[BOOTPROF_MAX_STAGES];
+static int nstages = 0;
+static uint64_t t_loader, t_loaded;     // 0 without bootloader stamps
+static uint64_t t_unpacked;             // 0 unless the kernel came from a compressed image
+static uint64_t t_kernel, t_prompt;
+
+static uint64_t base(void){ return t_loader ? t_loader : t_kernel; }
+
+static void row(const char* name, uint64_t start, uint64_t end){
+    char b[16];
+    sh_write("  "); sh_put_col(name, 16, 0);
+    u32_to_dec((uint32_t)tsc_to_us(start - base()), b); sh_put_col(b, 10, 1);
+    u32_to_dec((uint32_t)tsc_to_us(end - start), b); sh_put_col(b, 10, 1);
+    sh_writeln("");
+}
+
+// Lines for the serial log must not be dropped when the TX ring is full
+static void ser_stage(const char* name, uint64_t start, uint64_t end){
+    char b[16];
+    serial_write_wait("bootprof stage="); serial_write_wait(name);
+    serial_write_wait(" start_us="); u32_to_dec((uint32_t)tsc_to_us(start - base()), b); serial_write_wait(b);
+    serial_write_wait(" us="); u32_to_dec((uint32_t)tsc_to_us(end - start), b); serial_write_wait(b);
+    serial_putc_wait('\n');
+}
+
+static int cmd_bootprof(int argc, char** argv){
+    (void)argc; (void)argv;
+    char b[16];
+    if (!tsc_khz() || !t_prompt) { console_writeln("bootprof: no timings"); return -1; }
+    sh_write(t_loader ? "boot timeline, us from boot sector entry (TSC " : "boot timeline, us from kernel entry (no bootloader stamps; TSC ");
+    u32_to_dec(tsc_khz(), b); sh_write(b); sh_writeln(" kHz)");
+    sh_write("  "); sh_put_col("stage", 16, 0); sh_put_col("start", 10, 1); sh_put_col("time", 10, 1); sh_writeln("");
+    if (t_loader) {
+        row("loader: read", t_loader, t_loaded);
+        if (t_unpacked) { row("loader: unpack", t_loaded, t_unpacked); row("loader: to kernel", t_unpacked, t_kernel); }
+        else row("loader: to pm", t_loaded, t_kernel);
+    }
+    for (int i = 0; i < nstages; ++i) row(stages[i].name, stages[i].start, stages[i].end);
+    row("to prompt", base(), t_prompt);
+    return 0;
+}
+
+static const shell_cmd_t bootprof_cmd = { "bootprof", cmd_bootprof, 0, "per-stage boot times", 0 };
+
+void bootprof_init(void){
+    t_kernel = rdtsc();
+    volatile bootinfo_tsc_t* bi = (volatile bootinfo_tsc_t*)(uintptr_t)BOOTINFO_TSC_ADDR;
+    if (bi->magic == BOOTINFO_TSC_MAGIC && bi->entry_tsc <= bi->loaded_tsc && bi->loaded_tsc <= t_kernel){
+        t_loader = bi->entry_tsc; t_loaded = bi->loaded_tsc;
+        // the stub's stamp; a stale one from an earlier boot is before this boot's loader
+        if (t_loaded <= bi->unpacked_tsc && bi->unpacked_tsc <= t_kernel) t_unpacked = bi->unpacked_tsc;
+    }
+    bi->magic = 0;      // a warm reboot does not reset the TSC; do not reuse stale stamps
+    bi->unpacked_tsc = 0;
+    shell_register(&bootprof_cmd);
+}
+
+void bootprof_begin(const char* stage){
+    if (nstages == BOOTPROF_MAX_STAGES) return;
+    stages[nstages].name = stage;
+    stages[nstages].start = stages[nstages].end = rdtsc();
+    nstages++;
+}
+
+void bootprof_end(void){ if (nstages) stages[nstages-1].end = rdtsc(); }
+
+void bootprof_done(void){
+    t_prompt = rdtsc();
+    if (!tsc_khz()) return;
+    if (t_loader) {
+        ser_stage("loader_read", t_loader, t_loaded);
+        if (t_unpacked) { ser_stage("loader_unpack", t_loaded, t_unpacked); ser_stage("loader_kernel", t_unpacked, t_kernel); }
+        else ser_stage("loader_pm", t_loaded, t_kernel);
+    }
+    for (int i = 0; i < nstages; ++i) ser_stage(stages[i].name, stages[i].start, stages[i].end);
+    ser_stage("prompt", base(), t_prompt);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+// Boot timing. The bootloader stores the TSC at its entry and after the
+// kernel is read in a bootinfo_tsc_t at BOOTINFO_TSC_ADDR, and the stub
+// of a compressed image once it has unpacked the kernel; kernel_main
+// brackets each init stage with bootprof_begin/end. Raw TSC values are
+// kept, so stages that run before tsc_init are still timed.
+// bootprof_done marks the prompt and writes one line per stage to COM1:
+//   bootprof stage=vfs start_us=182345 us=412
+// `bootprof` prints the same timeline.
+
+#define BOOTPROF_MAX_STAGES 24
+
+typedef struct {
+    uint32_t magic;         // BOOTINFO_TSC_MAGIC
+    uint32_t reserved;
+    uint64_t entry_tsc;     // first instructions of the boot sector
+    uint64_t loaded_tsc;    // kernel image read, before the switch to protected mode
+    uint64_t unpacked_tsc;  // compressed image unpacked (kernel/stub.c); not written by the loader
+} bootinfo_tsc_t;
+
+// Free conventional memory just past the boot sector: outside the kernel
+// image and its .bss, which kernel_entry zeroes
+#define BOOTINFO_TSC_ADDR  0x00007E00u
+#define BOOTINFO_TSC_MAGIC 0xB007C10Cu
+
+void bootprof_init(void);               // first thing in kernel_main; registers `bootprof`
+void bootprof_begin(const char* stage); // stage names are kept by pointer
+void bootprof_end(void);
+void bootprof_done(void);               // prompt reached
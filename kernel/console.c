@@ -1,71 +1,357 @@
 #include <stdint.h>
 #include "console.h"
 #include "io.h"
+#include "memory.h"
+#include "fb.h"
+#include "font.h"
+#include "wm.h"
+#include "tsc.h"
 
 #define VGA_MEM ((volatile uint16_t*)0xB8000)
-#define VGA_COLS 80
-#define VGA_ROWS 25
+#define VGA_COLS CONSOLE_COLS
+#define VGA_ROWS CONSOLE_ROWS
 
 static int cx = 0, cy = 0;
 static uint8_t color = 0x0F; // white on black
 
+// Shadow of the screen. Rows form a ring: screen row y lives in shadow row
+// (top + y) % VGA_ROWS, so scrolling moves `top` instead of copying cells.
+static uint16_t shadow[VGA_ROWS][VGA_COLS] __attribute__((aligned(4)));
+static int top = 0;
+static uint32_t dirty = 0;   // bit y = screen row y differs from VGA memory
+static int batch = 0;
+static uint64_t last_flush = 0;   // TSC of the last flush, for CONSOLE_BATCH_MS
+static console_mirror_fn mirror = 0;
+
+typedef uint32_t __attribute__((may_alias)) cellpair_t; // two cells per store
+
 static inline uint16_t vga_entry(char c) {
     return ((uint16_t)color << 8) | (uint8_t)c;
 }
 
+static inline uint16_t* row_ptr(int y) {
+    int r = top + y; if (r >= VGA_ROWS) r -= VGA_ROWS;
+    return shadow[r];
+}
+
+// Scrollback. Each saved row is a sequence of runs [attr][n][n chars] with
+// trailing blanks dropped; rows are appended to a byte ring (sb_text) and
+// a ring of start offsets (sb_index) locates them. Offsets and line
+// numbers grow monotonically and are reduced modulo the capacities.
+static uchandle_t sb_text = 0, sb_index = 0;
+static uint32_t sb_cap_bytes = 0, sb_cap_lines = 0;
+static uint32_t sb_first = 0, sb_next = 0;   // retained line numbers [first, next)
+static uint32_t sb_head = 0;                 // next byte offset
+static int view = 0;                         // lines scrolled back; 0 = live
+
+static void sb_ring_write(uchandle_t h, uint32_t cap, uint32_t pos, const void* src, uint32_t len) {
+    uint32_t off = pos % cap, n = cap - off;
+    if (n > len) n = len;
+    uc_pwrite(h, off, src, n);
+    if (len > n) uc_pwrite(h, 0, (const uint8_t*)src + n, len - n);
+}
+
+static void sb_ring_read(uchandle_t h, uint32_t cap, uint32_t pos, void* dst, uint32_t len) {
+    uint32_t off = pos % cap, n = cap - off;
+    if (n > len) n = len;
+    uc_read(h, off, dst, n);
+    if (len > n) uc_read(h, 0, (uint8_t*)dst + n, len - n);
+}
+
+static uint32_t sb_line_start(uint32_t line) {
+    if (line == sb_next) return sb_head;
+    uint32_t off;
+    sb_ring_read(sb_index, sb_cap_lines * 4, line * 4, &off, 4);
+    return off;
+}
+
+static void sb_push_row(const uint16_t* row) {
+    if (!sb_text) return;
+    uint8_t enc[VGA_COLS * 3];
+    int n = VGA_COLS;
+    while (n > 0 && row[n-1] == vga_entry(' ')) n--;
+    uint32_t len = 0;
+    for (int x = 0; x < n; ) {
+        uint8_t attr = (uint8_t)(row[x] >> 8);
+        int k = 0;
+        enc[len++] = attr; uint32_t cnt = len++;
+        while (x < n && (uint8_t)(row[x] >> 8) == attr) { enc[len++] = (uint8_t)row[x]; x++; k++; }
+        enc[cnt] = (uint8_t)k;
+    }
+    // Evict old lines until both the line and byte budgets have room
+    while (sb_first < sb_next && (sb_next - sb_first >= sb_cap_lines ||
+           sb_head + len - sb_line_start(sb_first) > sb_cap_bytes)) sb_first++;
+    sb_ring_write(sb_index, sb_cap_lines * 4, sb_next * 4, &sb_head, 4);
+    if (len) sb_ring_write(sb_text, sb_cap_bytes, sb_head, enc, len);
+    sb_head += len;
+    sb_next++;
+}
+
+// Expand saved line into 80 cells
+static void sb_get_row(uint32_t line, uint16_t* out) {
+    uint8_t enc[VGA_COLS * 3];
+    uint32_t a = sb_line_start(line), len = sb_line_start(line + 1) - a;
+    if (len > sizeof(enc)) len = 0;
+    if (len) sb_ring_read(sb_text, sb_cap_bytes, a, enc, len);
+    int x = 0;
+    for (uint32_t i = 0; i + 1 < len && x < VGA_COLS; ) {
+        uint16_t attr = (uint16_t)enc[i] << 8; int k = enc[i+1]; i += 2;
+        while (k-- > 0 && i < len && x < VGA_COLS) out[x++] = attr | enc[i++];
+    }
+    while (x < VGA_COLS) out[x++] = vga_entry(' ');
+}
+
+// Framebuffer backend: the same cell grid rendered with the glyph cache into
+// the console's window surface (the bottom WM window). fb_shown mirrors what
+// the surface currently shows so a flush only redraws cells that changed;
+// scrolls since the last flush are applied as one block move of the pixels.
+#define CELL_INVALID 0xFFFFu
+static int use_fb = 0;
+static int fb_win = -1;
+static surface_t* fb_surf = 0;
+static int scroll_pending = 0;
+static uint16_t fb_shown[VGA_ROWS][VGA_COLS];
+
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF
+};
+
+static void fb_draw_row(int y, const uint16_t* cells) {
+    uint16_t* shown = fb_shown[y];
+    char run[VGA_COLS];
+    int x = 0;
+    while (x < VGA_COLS) {
+        if (cells[x] == shown[x]) { x++; continue; }
+        // run of changed cells sharing one attribute
+        int start = x, n = 0; uint16_t attr = cells[x] & 0xFF00;
+        while (x < VGA_COLS && cells[x] != shown[x] && (cells[x] & 0xFF00) == attr) {
+            run[n++] = (char)cells[x]; shown[x] = cells[x]; x++;
+        }
+        font_draw_run(fb_surf, start*FONT_W, y*FONT_H, run, n,
+                      vga_rgb[(attr >> 8) & 0x0F], vga_rgb[(attr >> 12) & 0x0F]);
+        wm_damage_window(fb_win, start*FONT_W, y*FONT_H, n*FONT_W, FONT_H);
+    }
+}
+
+static void fb_apply_scroll(void) {
+    int k = scroll_pending;
+    scroll_pending = 0;
+    if (k <= 0) return;
+    if (k < VGA_ROWS) {
+        surf_copy(fb_surf, 0, 0, fb_surf, 0, k*FONT_H, VGA_COLS*FONT_W, (VGA_ROWS-k)*FONT_H);
+        wm_damage_window(fb_win, 0, 0, VGA_COLS*FONT_W, (VGA_ROWS-k)*FONT_H);
+        for (int y = 0; y < VGA_ROWS-k; ++y)
+            for (int x = 0; x < VGA_COLS; ++x) fb_shown[y][x] = fb_shown[y+k][x];
+    }
+    for (int y = (k < VGA_ROWS ? VGA_ROWS-k : 0); y < VGA_ROWS; ++y)
+        for (int x = 0; x < VGA_COLS; ++x) fb_shown[y][x] = CELL_INVALID;
+}
+
+static void fb_invalidate(void) {
+    scroll_pending = 0;
+    for (int y = 0; y < VGA_ROWS; ++y)
+        for (int x = 0; x < VGA_COLS; ++x) fb_shown[y][x] = CELL_INVALID;
+}
+
+void console_attach_fb(void) {
+    if (use_fb || !g_fb.present || g_fb.width < VGA_COLS*FONT_W || g_fb.height < VGA_ROWS*FONT_H) return;
+    int w = VGA_COLS*FONT_W, h = VGA_ROWS*FONT_H;
+    fb_win = wm_create((g_fb.width - w) / 2, (g_fb.height - h) / 2, w, h);
+    if (fb_win < 0) return;
+    fb_surf = wm_surface(fb_win);
+    use_fb = 1;
+    console_redraw();
+}
+
+void console_redraw(void) {
+    if (use_fb) fb_invalidate();
+    dirty = (1u << VGA_ROWS) - 1;
+    if (!batch) console_flush();
+}
+
+// Copy one screen row to the active backend
+static void present_row(int y, const uint16_t* cells) {
+    if (use_fb) { fb_draw_row(y, cells); return; }
+    // write-only, 32 bits at a time; never read back from VGA memory
+    const cellpair_t* src = (const cellpair_t*)cells;
+    volatile cellpair_t* dst = (volatile cellpair_t*)(VGA_MEM + y*VGA_COLS);
+    for (int x = 0; x < VGA_COLS/2; ++x) dst[x] = src[x];
+}
+
 static void vga_hide_cursor(void){
     // Disable hardware cursor (bit 5 in Cursor Start register)
     outb(0x3D4, 0x0A);
     outb(0x3D5, 0x20);
 }
 
+static void fill_row(int y, uint16_t cell) {
+    uint32_t pair = ((uint32_t)cell << 16) | cell;
+    cellpair_t* p = (cellpair_t*)row_ptr(y);
+    for (int x = 0; x < VGA_COLS/2; ++x) p[x] = pair;
+    dirty |= 1u << y;
+}
+
 static void scroll_if_needed(void) {
     if (cy < VGA_ROWS) return;
-    // scroll up by 1 line
-    for (int y = 1; y < VGA_ROWS; ++y) {
-        for (int x = 0; x < VGA_COLS; ++x) {
-            VGA_MEM[(y-1)*VGA_COLS + x] = VGA_MEM[y*VGA_COLS + x];
-        }
-    }
-    // clear last line
-    for (int x = 0; x < VGA_COLS; ++x) VGA_MEM[(VGA_ROWS-1)*VGA_COLS + x] = ((uint16_t)color << 8) | ' ';
+    // scroll up by 1 line: old row 0 becomes the new bottom row
+    sb_push_row(row_ptr(0));
+    if (++top == VGA_ROWS) top = 0;
+    fill_row(VGA_ROWS-1, vga_entry(' '));
+    dirty = (1u << VGA_ROWS) - 1;   // every screen row moved
+    scroll_pending++;
     cy = VGA_ROWS - 1;
 }
 
+// Scrolled-back view: blit history rows then the top of the live screen
+static void draw_view(void) {
+    uint16_t row[VGA_COLS] __attribute__((aligned(4)));
+    uint32_t hist = sb_next - sb_first;
+    for (int y = 0; y < VGA_ROWS; ++y) {
+        uint32_t v = hist - (uint32_t)view + (uint32_t)y;   // virtual line
+        const uint16_t* src;
+        if (v < hist) { sb_get_row(sb_first + v, row); src = row; }
+        else src = row_ptr((int)(v - hist));
+        present_row(y, src);
+    }
+    // fb_shown now holds history, not the live screen shifted by scrolls
+    scroll_pending = 0;
+    if (use_fb) wm_render();
+}
+
+void console_scroll_view(int lines) {
+    int hist = (int)(sb_next - sb_first);
+    int v = view + lines;
+    if (v < 0) v = 0;
+    if (v > hist) v = hist;
+    if (v == view) return;
+    view = v;
+    if (view) draw_view();
+    else { dirty = (1u << VGA_ROWS) - 1; console_flush(); }
+}
+
+uint32_t console_scrollback_lines(void) { return sb_next - sb_first; }
+
+int console_scrollback_init(uint32_t max_lines, uint32_t max_bytes) {
+    if (max_lines == 0 || max_bytes == 0) return -1;
+    sb_text = uc_alloc(max_bytes);
+    sb_index = uc_alloc(max_lines * 4);
+    if (!sb_text || !sb_index) {
+        if (sb_text) uc_free(sb_text);
+        if (sb_index) uc_free(sb_index);
+        sb_text = sb_index = 0;
+        return -1;
+    }
+    sb_cap_bytes = max_bytes; sb_cap_lines = max_lines;
+    sb_first = sb_next = 0; sb_head = 0; view = 0;
+    return 0;
+}
+
+void console_flush(void) {
+    if (view) {
+        // New output while scrolled back: snap to the live screen
+        if (!dirty) return;
+        view = 0;
+        scroll_pending = 0;
+        dirty = (1u << VGA_ROWS) - 1;
+    }
+    last_flush = rdtsc();
+    if (use_fb) fb_apply_scroll();
+    uint32_t d = dirty;
+    dirty = 0;
+    for (int y = 0; d; ++y, d >>= 1) {
+        if (d & 1) present_row(y, row_ptr(y));
+    }
+    if (use_fb) wm_render();
+}
+
+void console_sync(void) {
+    if (dirty || scroll_pending) console_flush();
+}
+
+// Inside a batch: has the screen gone CONSOLE_BATCH_MS without a flush?
+// Every newline counts until the TSC is calibrated.
+static int batch_due(void) {
+    uint32_t khz = tsc_khz();
+    return !khz || rdtsc() - last_flush >= (uint64_t)khz * CONSOLE_BATCH_MS;
+}
+
+void console_batch_begin(void) { batch++; }
+
+void console_batch_end(void) {
+    if (batch > 0 && --batch == 0) console_flush();
+}
+
 void console_init(void) {
     console_clear();
     vga_hide_cursor();
 }
 
 void console_clear(void) {
-    cx = cy = 0;
-    for (int i = 0; i < VGA_COLS*VGA_ROWS; ++i) VGA_MEM[i] = ((uint16_t)color << 8) | ' ';
+    cx = cy = 0; top = 0;
+    for (int y = 0; y < VGA_ROWS; ++y) fill_row(y, vga_entry(' '));
+    if (!batch) console_flush();
 }
 
 void console_set_color(uint8_t fg, uint8_t bg) {
     color = (bg << 4) | (fg & 0x0F);
 }
 
-void console_putc(char c) {
+console_mirror_fn console_set_mirror(console_mirror_fn fn) { console_mirror_fn old = mirror; mirror = fn; return old; }
+
+static void putc_nf(char c) {
+    if (mirror) mirror(c);
     if (c == '\n') {
         cx = 0; cy++;
         scroll_if_needed();
+        if (batch && batch_due()) console_flush();
         return;
     }
     if (c == '\r') { cx = 0; return; }
     if (c == '\b') {
-        if (cx > 0) { cx--; VGA_MEM[cy*VGA_COLS + cx] = vga_entry(' '); }
+        if (cx > 0) { cx--; row_ptr(cy)[cx] = vga_entry(' '); dirty |= 1u << cy; }
         return;
     }
-    VGA_MEM[cy*VGA_COLS + cx] = vga_entry(c);
+    row_ptr(cy)[cx] = vga_entry(c);
+    dirty |= 1u << cy;
     if (++cx >= VGA_COLS) { cx = 0; cy++; scroll_if_needed(); }
 }
 
+void console_putc(char c) {
+    putc_nf(c);
+    if (!batch) console_flush();
+}
+
 void console_write(const char* s) {
-    while (*s) console_putc(*s++);
+    while (*s) putc_nf(*s++);
+    if (!batch) console_flush();
 }
 
 void console_writeln(const char* s) {
-    console_write(s);
-    console_putc('\n');
+    while (*s) putc_nf(*s++);
+    putc_nf('\n');
+    if (!batch) console_flush();
+}
+
+void console_put_cell(int x, int y, uint16_t cell) {
+    if (x<0||x>=VGA_COLS||y<0||y>=VGA_ROWS) return;
+    row_ptr(y)[x] = cell;
+    dirty |= 1u << y;
+    if (!batch) console_flush();
+}
+
+void console_put_cells(int x, int y, const uint16_t* cells, int n) {
+    if (y<0||y>=VGA_ROWS) return;
+    if (x<0) { cells -= x; n += x; x = 0; }
+    if (x+n > VGA_COLS) n = VGA_COLS - x;
+    if (n <= 0) return;
+    uint16_t* row = row_ptr(y) + x;
+    for (int i = 0; i < n; ++i) row[i] = cells[i];
+    dirty |= 1u << y;
+    if (!batch) console_flush();
+}
+
+uint16_t console_get_cell(int x, int y) {
+    if (x<0||x>=VGA_COLS||y<0||y>=VGA_ROWS) return 0;
+    return row_ptr(y)[x];
 }
@@ -1,9 +1,55 @@
 #pragma once
 #include <stdint.h>
 
+#define CONSOLE_COLS 80
+#define CONSOLE_ROWS 25
+
 void console_init(void);
 void console_clear(void);
 void console_set_color(uint8_t fg, uint8_t bg);
 void console_putc(char c);
 void console_write(const char* s);
 void console_writeln(const char* s);
+// Copy every character written to the console to fn as well (NULL: off).
+// Returns the previous mirror
+typedef void (*console_mirror_fn)(char c);
+console_mirror_fn console_set_mirror(console_mirror_fn fn);
+
+// Output goes to a RAM shadow of the screen; dirty rows are copied to VGA
+// memory on flush. Outside a batch every call flushes on return; inside
+// begin/end (which nest) the flush happens at the outermost end, and at a
+// newline once CONSOLE_BATCH_MS have passed since the last flush, so a
+// long-running command still shows progress.
+#ifndef CONSOLE_BATCH_MS
+#define CONSOLE_BATCH_MS 50
+#endif
+void console_batch_begin(void);
+void console_batch_end(void);
+void console_flush(void);
+// Flush if anything is pending, batch or not; call before blocking on input
+void console_sync(void);
+
+// Scrollback: rows that scroll off the top are kept, run-length encoded, in
+// buffers from the kernel allocator (call after mem_init). Both limits cap
+// the memory used; the oldest lines are dropped first.
+#ifndef CONSOLE_SCROLLBACK_LINES
+#define CONSOLE_SCROLLBACK_LINES 10000
+#endif
+#ifndef CONSOLE_SCROLLBACK_BYTES
+#define CONSOLE_SCROLLBACK_BYTES (512u*1024u)
+#endif
+int console_scrollback_init(uint32_t max_lines, uint32_t max_bytes);
+// Move the view by `lines` (positive = back in history); 0 output snaps back
+void console_scroll_view(int lines);
+uint32_t console_scrollback_lines(void);
+
+// Render the console into the VBE framebuffer (centered 80x25 cells of
+// 8x16 glyphs) instead of VGA text memory; call once the LFB is up
+void console_attach_fb(void);
+// Repaint every cell (e.g. after something else drew over the screen)
+void console_redraw(void);
+
+// Raw cell access (attr<<8 | ch) for text-mode windows drawn over the console
+void console_put_cell(int x, int y, uint16_t cell);
+void console_put_cells(int x, int y, const uint16_t* cells, int n);   // one row span, clipped
+uint16_t console_get_cell(int x, int y);
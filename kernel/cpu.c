@@ -0,0 +1,39 @@
+#include <stdint.h>
+#include "cpu.h"
+
+static uint32_t g_feat = 0;
+
+static int have_cpuid(void){
+    // CPUID exists if EFLAGS.ID (bit 21) can be toggled
+    uint32_t a, b;
+    __asm__ __volatile__(
+        "pushfl\n\tpopl %0\n\tmovl %0, %1\n\txorl $0x200000, %0\n\t"
+        "pushl %0\n\tpopfl\n\tpushfl\n\tpopl %0\n\tpushl %1\n\tpopfl"
+        : "=&r"(a), "=&r"(b));
+    return ((a ^ b) & 0x200000) != 0;
+}
+
+static void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d){
+    __asm__ __volatile__("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+void cpu_init(void){
+    if (!have_cpuid()) return;
+    uint32_t a, b, c, d;
+    cpuid(0, &a, &b, &c, &d);
+    if (a < 1) return;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & (1u << 25)) || !(d & (1u << 24))) return;   // SSE, FXSR
+    uint32_t cr0, cr4;
+    __asm__ __volatile__("movl %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~(1u << 2);   // EM off
+    cr0 |= 1u << 1;      // MP on
+    __asm__ __volatile__("movl %0, %%cr0" :: "r"(cr0));
+    __asm__ __volatile__("movl %%cr4, %0" : "=r"(cr4));
+    cr4 |= (1u << 9) | (1u << 10);   // OSFXSR, OSXMMEXCPT
+    __asm__ __volatile__("movl %0, %%cr4" :: "r"(cr4));
+    g_feat |= CPU_FEAT_SSE;
+    if (d & (1u << 26)) g_feat |= CPU_FEAT_SSE2;
+}
+
+uint32_t cpu_features(void){ return g_feat; }
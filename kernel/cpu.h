@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+// CPU feature detection. cpu_init enables SSE/SSE2 (CR0.MP, CR4.OSFXSR and
+// OSXMMEXCPT) when CPUID reports them. Only code marked
+// __attribute__((target("sse2"))) may use XMM registers: the interrupt
+// stubs do not save them, so IRQ-time code must stay integer-only.
+#define CPU_FEAT_SSE  (1u << 0)
+#define CPU_FEAT_SSE2 (1u << 1)
+
+void cpu_init(void);
+uint32_t cpu_features(void);
+static inline int cpu_has_sse2(void){ return (cpu_features() & CPU_FEAT_SSE2) != 0; }
@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include "css.h"
+
+#define DECL_FG      1
+#define DECL_BG      2
+#define DECL_DISPLAY 4
+
+typedef struct { uint8_t fg, bg, display, set; } decls_t;
+
+typedef struct {
+    const char *tag, *cls, *id;     // interned; NULL matches anything
+    uint16_t spec;
+    decls_t d;
+} rule_t;
+
+typedef struct {
+    const char *tag, *cls, *id, *inl;
+    uint8_t pfg, pbg, used;
+    css_style_t out;
+} cache_ent_t;
+
+static dom_doc_t* g_doc;
+static rule_t rules[CSS_MAX_RULES];
+static int nrules;
+static cache_ent_t cache[CSS_CACHE_SLOTS];
+static css_stats_t stats;
+static const char *n_h1, *n_p, *n_div, *a_class, *a_id, *a_style;
+
+static int is_space(char c){ return c==' '||c=='\t'||c=='\r'||c=='\n'; }
+static int is_name(char c){ return (c>='a'&&c<='z')||(c>='A'&&c<='Z')||(c>='0'&&c<='9')||c=='-'||c=='_'; }
+static char lower(char c){ return (c>='A'&&c<='Z')?(char)(c+32):c; }
+
+// Case-insensitive: does s[0..len) start with lowercase word p?
+static int starts(const char* s, int len, const char* p){
+    int i = 0;
+    for (; p[i]; ++i) if (i >= len || lower(s[i]) != p[i]) return 0;
+    return 1;
+}
+
+uint8_t css_color(const char* s, int len){
+    static const struct { const char* name; uint8_t c; } names[] = {
+        {"black",0},{"blue",1},{"green",2},{"cyan",3},{"red",4},{"magenta",5},
+        {"brown",6},{"yellow",6},{"lightgray",7},{"grey",7},{"darkgray",8},
+        {"lightblue",9},{"lightgreen",10},{"lightcyan",11},{"lightred",12},
+        {"lightmagenta",13},{"lightyellow",14},{"white",15}
+    };
+    while (len && is_space(s[len-1])) len--;
+    if (!len) return 7;
+    for (unsigned i=0;i<sizeof(names)/sizeof(names[0]);++i) if (starts(s, len, names[i].name)) return names[i].c;
+    uint32_t v = 0;
+    for (int i=0;i<len;++i){ if (s[i]<'0'||s[i]>'9') return 7; v = v*10 + (uint32_t)(s[i]-'0'); if (v>15) return 7; }
+    return (uint8_t)v;
+}
+
+// "prop: value; ..." over s[0..len)
+static void parse_decls(const char* s, int len, decls_t* d){
+    int i = 0;
+    while (i < len){
+        while (i < len && (is_space(s[i]) || s[i]==';')) i++;
+        int p = i;
+        while (i < len && s[i] != ':' && s[i] != ';') i++;
+        int plen = i - p;
+        while (plen && is_space(s[p+plen-1])) plen--;
+        if (i >= len || s[i] != ':') continue;
+        i++;
+        while (i < len && is_space(s[i])) i++;
+        int v = i;
+        while (i < len && s[i] != ';') i++;
+        int vlen = i - v;
+        const char* pn = s + p;
+        if (plen == 5 && starts(pn, plen, "color")) { d->fg = css_color(s+v, vlen); d->set |= DECL_FG; }
+        else if ((plen == 10 && starts(pn, plen, "background")) || (plen == 16 && starts(pn, plen, "background-color"))) {
+            d->bg = css_color(s+v, vlen); d->set |= DECL_BG;
+        }
+        else if (plen == 7 && starts(pn, plen, "display")) {
+            d->display = starts(s+v, vlen, "none") ? CSS_NONE : starts(s+v, vlen, "block") ? CSS_BLOCK : CSS_INLINE;
+            d->set |= DECL_DISPLAY;
+        }
+    }
+}
+
+static css_style_t apply(const decls_t* d, css_style_t st){
+    if (d->set & DECL_FG) st.fg = d->fg;
+    if (d->set & DECL_BG) st.bg = d->bg;
+    if (d->set & DECL_DISPLAY) st.display = d->display;
+    return st;
+}
+
+css_style_t css_apply_decls(const char* s, css_style_t base){
+    if (!s) return base;
+    int len = 0; while (s[len]) len++;
+    decls_t d = {0,0,0,0};
+    parse_decls(s, len, &d);
+    return apply(&d, base);
+}
+
+void css_begin(dom_doc_t* doc){
+    g_doc = doc;
+    nrules = 0;
+    for (int i=0;i<CSS_CACHE_SLOTS;++i) cache[i].used = 0;
+    css_stats_t z = {0,0,0,0}; stats = z;
+    n_h1 = dom_intern(doc, "h1", 2); n_p = dom_intern(doc, "p", 1); n_div = dom_intern(doc, "div", 3);
+    a_class = dom_intern(doc, "class", 5); a_id = dom_intern(doc, "id", 2); a_style = dom_intern(doc, "style", 5);
+}
+
+const css_stats_t* css_stats(void){ return &stats; }
+
+// One compound selector in s[0..len), already trimmed. 0 if unsupported
+static int parse_selector(const char* s, int len, rule_t* r){
+    r->tag = r->cls = r->id = 0; r->spec = 0;
+    int i = 0;
+    if (!len) return 0;
+    while (i < len){
+        char kind = s[i];
+        if (kind == '*') { i++; continue; }
+        if (kind == '.' || kind == '#') i++;
+        else if (!is_name(kind) || r->tag || i) return 0;   // combinator or junk
+        int st = i;
+        char name[CSS_NAME_MAX]; int n = 0;
+        while (i < len && is_name(s[i])) { if (n < CSS_NAME_MAX-1) name[n++] = kind == '.' || kind == '#' ? s[i] : lower(s[i]); i++; }
+        if (i == st) return 0;
+        const char* in = dom_intern(g_doc, name, (uint32_t)n);
+        if (!in) return 0;
+        if (kind == '.') { if (r->cls) return 0; r->cls = in; r->spec += 10; }
+        else if (kind == '#') { if (r->id) return 0; r->id = in; r->spec += 100; }
+        else { r->tag = in; r->spec += 1; }
+    }
+    return 1;
+}
+
+static void add_rules(const char* sel, int slen, const decls_t* d){
+    int i = 0;
+    while (i <= slen){
+        int st = i;
+        while (i < slen && sel[i] != ',') i++;
+        int a = st, b = i;
+        while (a < b && is_space(sel[a])) a++;
+        while (b > a && is_space(sel[b-1])) b--;
+        i++;
+        if (a == b) continue;
+        if (nrules == CSS_MAX_RULES || !parse_selector(sel + a, b - a, &rules[nrules])) { stats.dropped++; continue; }
+        rules[nrules++].d = *d;
+        stats.rules++;
+    }
+}
+
+void css_add_sheet(const char* s, int len){
+    int i = 0;
+    while (i < len){
+        while (i < len && is_space(s[i])) i++;
+        if (i + 1 < len && s[i]=='/' && s[i+1]=='*'){
+            i += 2;
+            while (i + 1 < len && !(s[i]=='*' && s[i+1]=='/')) i++;
+            i += 2;
+            continue;
+        }
+        if (i >= len) break;
+        int sel = i;
+        while (i < len && s[i] != '{' && s[i] != ';') i++;
+        if (i >= len) break;
+        if (s[i] == ';') { i++; continue; }        // @import and friends
+        int slen = i - sel;
+        int body = ++i, depth = 1;
+        while (i < len && depth) { if (s[i]=='{') depth++; else if (s[i]=='}') depth--; i++; }
+        if (s[sel] == '@') { stats.dropped++; continue; }   // @media etc.
+        decls_t d = {0,0,0,0};
+        parse_decls(s + body, i - body - (depth ? 0 : 1), &d);
+        add_rules(s + sel, slen, &d);
+    }
+}
+
+static int has_class(const char* list, const char* cls){
+    while (*list){
+        while (is_space(*list)) list++;
+        const char* c = cls;
+        while (*list && !is_space(*list) && *list == *c) { list++; c++; }
+        if (!*c && (!*list || is_space(*list))) return 1;
+        while (*list && !is_space(*list)) list++;
+    }
+    return 0;
+}
+
+static int str_eq(const char* a, const char* b){ while (*a && *a == *b) { a++; b++; } return *a == *b; }
+
+static css_style_t cascade(const char* tag, const char* cls, const char* id, const char* inl, css_style_t parent){
+    css_style_t st = { parent.fg, parent.bg, (tag == n_h1 || tag == n_p || tag == n_div) ? CSS_BLOCK : CSS_INLINE };
+    // Matches in source order, then a stable sort by specificity
+    uint8_t m[CSS_MAX_RULES]; int nm = 0;
+    for (int i = 0; i < nrules; ++i){
+        const rule_t* r = &rules[i];
+        if (r->tag && r->tag != tag) continue;
+        if (r->id && (!id || !str_eq(r->id, id))) continue;
+        if (r->cls && (!cls || !has_class(cls, r->cls))) continue;
+        int k = nm++;
+        while (k && rules[m[k-1]].spec > r->spec) { m[k] = m[k-1]; k--; }
+        m[k] = (uint8_t)i;
+    }
+    for (int i = 0; i < nm; ++i) st = apply(&rules[m[i]].d, st);
+    return css_apply_decls(inl, st);
+}
+
+static uint32_t mix(uint32_t h, uint32_t v){ h = (h ^ v) * 0x9E3779B1u; return h ^ (h >> 15); }
+
+css_style_t css_compute(const dom_node_t* n, css_style_t parent){
+    const char *cls = 0, *id = 0, *inl = 0;
+    for (const dom_attr_t* a = n->attrs; a; a = a->next){
+        if (a->name == a_class) cls = a->value;
+        else if (a->name == a_id) id = a->value;
+        else if (a->name == a_style) inl = a->value;
+    }
+    stats.lookups++;
+    uint32_t h = mix(mix(mix(mix(mix(0, (uint32_t)(uintptr_t)n->name), (uint32_t)(uintptr_t)cls),
+                     (uint32_t)(uintptr_t)id), (uint32_t)(uintptr_t)inl), (uint32_t)parent.fg << 8 | parent.bg);
+    // Probe a few slots; on a miss take the first free one, else evict the home slot
+    cache_ent_t* slot = 0;
+    for (int k = 0; k < 4; ++k){
+        cache_ent_t* e = &cache[(h + (uint32_t)k) & (CSS_CACHE_SLOTS-1)];
+        if (!e->used) { if (!slot) slot = e; continue; }
+        if (e->tag == n->name && e->cls == cls && e->id == id && e->inl == inl && e->pfg == parent.fg && e->pbg == parent.bg){
+            stats.hits++;
+            return e->out;
+        }
+    }
+    if (!slot) slot = &cache[h & (CSS_CACHE_SLOTS-1)];
+    css_style_t st = cascade(n->name, cls, id, inl, parent);
+    slot->tag = n->name; slot->cls = cls; slot->id = id; slot->inl = inl;
+    slot->pfg = parent.fg; slot->pbg = parent.bg; slot->used = 1;
+    slot->out = st;
+    return st;
+}
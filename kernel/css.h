@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include "dom.h"
+
+// Style sheets for the renderer. Rules come from <style> blocks:
+//   sel[, sel...] { color: X; background: Y; display: block|inline|none }
+// where a selector is a compound of at most one tag (or *), one .class and
+// one #id, e.g. "p", ".note", "div#main", "p.note". Rules with combinators
+// are ignored. The cascade orders matches by specificity, then source
+// order; the style="" attribute applies last. color and background inherit,
+// display does not (h1/p/div default to block, everything else to inline).
+//
+// Computed styles are cached by (tag, class, id, style attribute, parent
+// style). DOM strings are interned, so the key is a handful of pointers and
+// a node that looks like one seen before costs one hash probe.
+
+#define CSS_MAX_RULES   128
+#define CSS_CACHE_SLOTS 1024      // power of two
+#define CSS_NAME_MAX    32
+
+enum { CSS_INLINE, CSS_BLOCK, CSS_NONE };
+
+typedef struct { uint8_t fg, bg, display; } css_style_t;
+
+typedef struct {
+    uint32_t rules;
+    uint32_t dropped;           // selectors we do not support, or rules past CSS_MAX_RULES
+    uint32_t lookups;
+    uint32_t hits;
+} css_stats_t;
+
+// Start a document: clears the sheet and the cache. Names in the sheet are
+// interned into doc so they compare by pointer with the tree
+void css_begin(dom_doc_t* doc);
+void css_add_sheet(const char* s, int len);
+css_style_t css_compute(const dom_node_t* n, css_style_t parent);
+// Apply "prop: value; ..." declarations (also used for style="")
+css_style_t css_apply_decls(const char* s, css_style_t base);
+uint8_t css_color(const char* s, int len);      // VGA name or 0..15; 7 if unknown
+const css_stats_t* css_stats(void);
@@ -0,0 +1,308 @@
+#include <stdint.h>
+#include "dom.h"
+
+enum {
+    S_TEXT, S_TAG_OPEN, S_TAG_NAME, S_ATTRS, S_ATTR_NAME, S_ATTR_AFTER_NAME,
+    S_VALUE_START, S_VALUE_Q, S_VALUE_U, S_END_NAME, S_BANG, S_BANG_DASH,
+    S_COMMENT, S_DECL, S_RAW
+};
+
+static int is_space(char c){ return c==' '||c=='\t'||c=='\r'||c=='\n'; }
+static int is_name(char c){ return (c>='a'&&c<='z')||(c>='A'&&c<='Z')||(c>='0'&&c<='9')||c=='-'||c=='_'||c==':'; }
+static char lower(char c){ return (c>='A'&&c<='Z')?(char)(c+32):c; }
+
+static void* arena_alloc(dom_doc_t* d, uint32_t n){
+    const uint32_t a = (uint32_t)sizeof(void*);     // 4 in the kernel, 8 in the host build
+    n = (n + a - 1) & ~(a - 1);
+    if (d->size - d->used < n) { d->oom = 1; return 0; }
+    void* p = d->base + d->used;
+    d->used += n;
+    d->stats.arena_used = d->used;
+    return p;
+}
+
+static const char* copy_str(dom_doc_t* d, const char* s, uint32_t len){
+    char* c = (char*)arena_alloc(d, len + 1);
+    if (!c) return 0;
+    for (uint32_t k=0;k<len;++k) c[k] = s[k];
+    c[len] = 0;
+    return c;
+}
+
+static uint32_t str_hash(const char* s, uint32_t len){
+    uint32_t h = 2166136261u;
+    for (uint32_t i=0;i<len;++i) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+// Double the table; the old one stays behind in the arena
+static int intern_grow(dom_doc_t* d){
+    uint32_t n = d->intern_slots * 2;
+    const char** t = (const char**)arena_alloc(d, n * (uint32_t)sizeof(char*));
+    if (!t) return -1;
+    for (uint32_t i=0;i<n;++i) t[i] = 0;
+    for (uint32_t i=0;i<d->intern_slots;++i){
+        const char* e = d->intern[i];
+        if (!e) continue;
+        uint32_t len = 0; while (e[len]) len++;
+        uint32_t j = str_hash(e, len) & (n-1);
+        while (t[j]) j = (j + 1) & (n-1);
+        t[j] = e;
+    }
+    d->intern = t; d->intern_slots = n;
+    return 0;
+}
+
+// FNV-1a, linear probing. Strings are stored NUL-terminated so a slot holds
+// just the pointer. The table doubles at 3/4 load, so every tag and
+// attribute name stays unique however large the document.
+const char* dom_intern(dom_doc_t* d, const char* s, uint32_t len){
+    uint32_t h = str_hash(s, len), mask = d->intern_slots - 1;
+    uint32_t i = h & mask;
+    for (;; i = (i + 1) & mask){
+        const char* e = d->intern[i];
+        if (!e) break;
+        uint32_t k = 0;
+        while (k < len && e[k] == s[k]) k++;
+        if (k == len && e[k] == 0) { d->stats.intern_hits++; return e; }
+    }
+    if (d->stats.strings >= d->intern_slots / 4 * 3){
+        if (intern_grow(d) != 0) return 0;
+        mask = d->intern_slots - 1;
+        for (i = h & mask; d->intern[i]; i = (i + 1) & mask) { }
+    }
+    const char* c = copy_str(d, s, len);
+    if (!c) return 0;
+    d->intern[i] = c;
+    d->stats.strings++;
+    return c;
+}
+
+// Names the renderer and CSS compare against, interned before anything the
+// document brings
+static const char* const known_names[] = {
+    "html", "head", "body", "h1", "p", "div", "span", "br", "script", "style", "class", "id"
+};
+
+int dom_init(dom_doc_t* d, void* arena, uint32_t size){
+    d->base = (uint8_t*)arena; d->size = size; d->used = 0; d->oom = 0;
+    dom_stats_t z = {0}; d->stats = z;
+    d->intern_slots = DOM_INTERN_SLOTS;
+    d->intern = (const char**)arena_alloc(d, DOM_INTERN_SLOTS * sizeof(char*));
+    d->root = (dom_node_t*)arena_alloc(d, sizeof(dom_node_t));
+    if (!d->intern || !d->root) return -1;
+    for (int i=0;i<DOM_INTERN_SLOTS;++i) d->intern[i] = 0;
+    dom_node_t r = { DOM_ELEMENT, 0, "#document", 0, 0, 0, 0, 0 };
+    *d->root = r;
+    for (uint32_t i=0;i<sizeof(known_names)/sizeof(known_names[0]);++i){
+        const char* n = known_names[i];
+        uint32_t len = 0; while (n[len]) len++;
+        if (!dom_intern(d, n, len)) return -1;
+    }
+    return 0;
+}
+
+const char* dom_attr(const dom_node_t* n, const char* name){
+    for (const dom_attr_t* a = n->attrs; a; a = a->next) if (a->name == name) return a->value;
+    return 0;
+}
+
+// ---- tree building ----
+
+static dom_node_t* top(dom_parser_t* p){ return p->depth ? p->stack[p->depth-1] : p->doc->root; }
+
+static dom_node_t* append(dom_parser_t* p, uint8_t type, const char* name, uint32_t len){
+    dom_node_t* n = (dom_node_t*)arena_alloc(p->doc, sizeof(dom_node_t));
+    if (!n) return 0;
+    dom_node_t* parent = top(p);
+    dom_node_t z = { type, (uint16_t)len, name, 0, parent, 0, 0, 0 };
+    *n = z;
+    if (parent->last_child) parent->last_child->next = n; else parent->first_child = n;
+    parent->last_child = n;
+    return n;
+}
+
+static void flush_text(dom_parser_t* p){
+    if (!p->tlen) return;
+    // Text is never compared by pointer, so it does not go through the table
+    const char* s = copy_str(p->doc, p->text, (uint32_t)p->tlen);
+    if (s && append(p, DOM_TEXT, s, (uint32_t)p->tlen)) p->doc->stats.texts++;
+    p->tlen = 0;
+}
+
+static void add_text(dom_parser_t* p, char c){
+    if (p->tlen == DOM_TEXT_RUN) flush_text(p);
+    p->text[p->tlen++] = c;
+}
+
+static int name_is(const char* a, const char* b){
+    while (*a && *a == *b) { a++; b++; }
+    return *a == 0 && *b == 0;
+}
+
+// HTML void elements never take children
+static int is_void(const char* n){
+    return name_is(n, "br") || name_is(n, "hr") || name_is(n, "img") || name_is(n, "meta") || name_is(n, "link") || name_is(n, "input");
+}
+
+static void start_tag(dom_parser_t* p){
+    const char* name = dom_intern(p->doc, p->name, (uint32_t)p->nlen);
+    p->cur = name ? append(p, DOM_ELEMENT, name, 0) : 0;
+    if (p->cur) p->doc->stats.elements++;
+    p->selfclose = 0;
+}
+
+static void add_attr(dom_parser_t* p){
+    if (!p->cur) return;
+    dom_attr_t* a = (dom_attr_t*)arena_alloc(p->doc, sizeof(dom_attr_t));
+    if (!a) return;
+    a->name = dom_intern(p->doc, p->aname, (uint32_t)p->alen);
+    a->value = dom_intern(p->doc, p->value, (uint32_t)p->vlen);
+    if (!a->name || !a->value) return;
+    // keep source order
+    a->next = 0;
+    dom_attr_t** tail = &p->cur->attrs;
+    while (*tail) tail = &(*tail)->next;
+    *tail = a;
+    p->doc->stats.attrs++;
+}
+
+static void finish_start_tag(dom_parser_t* p){
+    dom_node_t* n = p->cur;
+    p->cur = 0;
+    p->state = S_TEXT;
+    if (!n || p->selfclose || is_void(n->name)) return;
+    if (p->depth < DOM_MAX_DEPTH) p->stack[p->depth++] = n;
+    if (name_is(n->name, "script") || name_is(n->name, "style")){
+        p->raw_name = n->name;
+        p->raw_match = 0;
+        p->state = S_RAW;
+    }
+}
+
+static void end_tag(dom_parser_t* p){
+    p->name[p->nlen] = 0;
+    // pop to the nearest matching open element; stray end tags are ignored
+    for (int i = p->depth-1; i >= 0; --i){
+        if (name_is(p->stack[i]->name, p->name)) { p->depth = i; return; }
+    }
+}
+
+// ---- tokenizer ----
+
+void dom_parse_begin(dom_parser_t* p, dom_doc_t* doc){
+    p->doc = doc; p->state = S_TEXT; p->depth = 0; p->cur = 0;
+    p->nlen = p->alen = p->vlen = p->tlen = 0;
+}
+
+static void step(dom_parser_t* p, char c){
+    switch (p->state){
+    case S_TEXT:
+        if (c == '<') { p->state = S_TAG_OPEN; return; }
+        add_text(p, c);
+        return;
+    case S_TAG_OPEN:
+        if (c == '/') { flush_text(p); p->nlen = 0; p->state = S_END_NAME; return; }
+        if (c == '!') { flush_text(p); p->state = S_BANG; return; }
+        if (is_name(c)) { flush_text(p); p->name[0] = lower(c); p->nlen = 1; p->state = S_TAG_NAME; return; }
+        add_text(p, '<');
+        p->state = S_TEXT;
+        step(p, c);
+        return;
+    case S_TAG_NAME:
+        if (is_name(c)) { if (p->nlen < DOM_NAME_MAX-1) p->name[p->nlen++] = lower(c); return; }
+        start_tag(p);
+        p->state = S_ATTRS;
+        step(p, c);
+        return;
+    case S_ATTRS:
+        if (is_space(c)) return;
+        if (c == '>') { finish_start_tag(p); return; }
+        if (c == '/') { p->selfclose = 1; return; }
+        p->aname[0] = lower(c); p->alen = 1; p->vlen = 0;
+        p->state = S_ATTR_NAME;
+        return;
+    case S_ATTR_NAME:
+        if (c == '=') { p->state = S_VALUE_START; return; }
+        if (is_space(c)) { p->state = S_ATTR_AFTER_NAME; return; }
+        if (c == '>' || c == '/') { add_attr(p); p->state = S_ATTRS; step(p, c); return; }
+        if (p->alen < DOM_NAME_MAX-1) p->aname[p->alen++] = lower(c);
+        return;
+    case S_ATTR_AFTER_NAME:
+        if (is_space(c)) return;
+        if (c == '=') { p->state = S_VALUE_START; return; }
+        add_attr(p);
+        p->state = S_ATTRS;
+        step(p, c);
+        return;
+    case S_VALUE_START:
+        if (is_space(c)) return;
+        if (c == '"' || c == '\'') { p->quote = c; p->state = S_VALUE_Q; return; }
+        if (c == '>') { add_attr(p); finish_start_tag(p); return; }
+        p->state = S_VALUE_U;
+        step(p, c);
+        return;
+    case S_VALUE_Q:
+        if (c == p->quote) { add_attr(p); p->state = S_ATTRS; return; }
+        if (p->vlen < DOM_VALUE_MAX-1) p->value[p->vlen++] = c;
+        return;
+    case S_VALUE_U:
+        if (is_space(c) || c == '>') { add_attr(p); p->state = S_ATTRS; step(p, c); return; }
+        if (p->vlen < DOM_VALUE_MAX-1) p->value[p->vlen++] = c;
+        return;
+    case S_END_NAME:
+        if (c == '>') { end_tag(p); p->state = S_TEXT; return; }
+        if (is_name(c) && p->nlen < DOM_NAME_MAX-1) p->name[p->nlen++] = lower(c);
+        return;
+    case S_BANG:
+        p->state = (c == '-') ? S_BANG_DASH : S_DECL;
+        if (c == '>') p->state = S_TEXT;
+        return;
+    case S_BANG_DASH:
+        p->state = (c == '-') ? S_COMMENT : S_DECL;
+        p->dashes = 0;
+        if (c == '>') p->state = S_TEXT;
+        return;
+    case S_COMMENT:
+        if (c == '>' && p->dashes >= 2) { p->state = S_TEXT; return; }
+        p->dashes = (c == '-') ? p->dashes + 1 : 0;
+        return;
+    case S_DECL:
+        if (c == '>') p->state = S_TEXT;
+        return;
+    case S_RAW: {
+        // raw text until "</" raw_name; a partial match that fails is text
+        int m = p->raw_match;
+        char want = m == 0 ? '<' : m == 1 ? '/' : p->raw_name[m-2];
+        if (lower(c) == want){
+            p->raw_match = ++m;
+            if (m >= 2 && p->raw_name[m-2] == 0){
+                // matched "</name"; S_END_NAME skips the rest of the end tag
+                flush_text(p);
+                p->nlen = 0;
+                while (p->raw_name[p->nlen]) { p->name[p->nlen] = p->raw_name[p->nlen]; p->nlen++; }
+                p->state = S_END_NAME;
+            }
+            return;
+        }
+        for (int i=0; i<m; ++i) add_text(p, i == 0 ? '<' : i == 1 ? '/' : p->raw_name[i-2]);
+        p->raw_match = 0;
+        if (c == '<') { p->raw_match = 1; return; }
+        add_text(p, c);
+        return;
+    }
+    }
+}
+
+void dom_parse_feed(dom_parser_t* p, const char* data, uint32_t n){
+    p->doc->stats.bytes_in += n;
+    for (uint32_t i=0; i<n; ++i) step(p, data[i]);
+}
+
+void dom_parse_end(dom_parser_t* p){
+    if (p->state == S_TAG_NAME) start_tag(p);
+    if (p->cur) finish_start_tag(p);
+    flush_text(p);
+    p->depth = 0;
+    p->state = S_TEXT;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+
+// Compact DOM for the SAM/HTML renderer. A streaming tokenizer consumes
+// input in blocks of any size (a tag may straddle blocks) and builds the
+// tree in one linear pass. Nodes, attributes and strings are bump-allocated
+// from a caller-supplied arena; tag names and attribute names/values are
+// interned, so equal strings share storage and tag checks are pointer
+// compares against dom_intern results. Text runs are plain copies.
+
+#define DOM_ELEMENT 1
+#define DOM_TEXT    2
+
+#define DOM_NAME_MAX   32     // longer tag/attr names are truncated
+#define DOM_VALUE_MAX  256    // longer attribute values are truncated
+#define DOM_TEXT_RUN   1024   // longer text is split into several nodes
+#define DOM_INTERN_SLOTS 4096 // initial hash table size; doubles at 3/4 load
+#define DOM_MAX_DEPTH  64     // deeper nesting is flattened
+
+typedef struct dom_attr {
+    const char* name;
+    const char* value;
+    struct dom_attr* next;
+} dom_attr_t;
+
+typedef struct dom_node {
+    uint8_t type;
+    uint16_t len;               // text length (DOM_TEXT)
+    const char* name;           // interned tag name, or the text run
+    dom_attr_t* attrs;
+    struct dom_node* parent;
+    struct dom_node* first_child;
+    struct dom_node* last_child;
+    struct dom_node* next;
+} dom_node_t;
+
+typedef struct {
+    uint32_t bytes_in;
+    uint32_t elements;
+    uint32_t texts;
+    uint32_t attrs;
+    uint32_t strings;           // strings held in the intern table
+    uint32_t intern_hits;       // strings that reused existing storage
+    uint32_t arena_used;
+} dom_stats_t;
+
+typedef struct {
+    uint8_t* base;
+    uint32_t size, used;
+    int oom;                    // set once the arena ran out; parse continues, nodes are dropped
+    dom_node_t* root;           // synthetic #document element
+    const char** intern;        // intern_slots entries inside the arena
+    uint32_t intern_slots;
+    dom_stats_t stats;
+} dom_doc_t;
+
+// Tokenizer state; feed it blocks between dom_parse_begin and dom_parse_end
+typedef struct {
+    dom_doc_t* doc;
+    int state;
+    dom_node_t* stack[DOM_MAX_DEPTH];
+    int depth;
+    dom_node_t* cur;            // element whose start tag is being read
+    int selfclose, quote, dashes, raw_match;
+    const char* raw_name;       // script/style: text until </raw_name
+    int nlen, alen, vlen, tlen;
+    char name[DOM_NAME_MAX];
+    char aname[DOM_NAME_MAX];
+    char value[DOM_VALUE_MAX];
+    char text[DOM_TEXT_RUN];
+} dom_parser_t;
+
+// 0 ok, -1 arena too small for the bookkeeping
+int dom_init(dom_doc_t* doc, void* arena, uint32_t size);
+const char* dom_intern(dom_doc_t* doc, const char* s, uint32_t len);   // NULL if out of memory
+
+void dom_parse_begin(dom_parser_t* p, dom_doc_t* doc);
+void dom_parse_feed(dom_parser_t* p, const char* data, uint32_t n);
+void dom_parse_end(dom_parser_t* p);   // flushes text, closes open elements
+
+const char* dom_attr(const dom_node_t* n, const char* name);   // by interned name
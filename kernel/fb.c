@@ -2,18 +2,153 @@
 #include "fb.h"
 #include "console.h"
 #include "io.h"
+#include "tsc.h"
+#include "rect.h"
+#include "surface.h"
+#include "memory.h"
 
 framebuffer_t g_fb = {0};
+const fb_ops_t* g_fbops = 0;
+
+// ---- per-format kernels ----
+
+static inline void stosl(void* d, uint32_t v, uint32_t n){
+    __asm__ __volatile__("rep stosl" : "+D"(d), "+c"(n) : "a"(v) : "memory");
+}
+
+static inline void movs(void* d, const void* s, uint32_t n){
+    uint32_t dw = n >> 2, tail = n & 3;
+    __asm__ __volatile__("rep movsl" : "+S"(s), "+D"(d), "+c"(dw) : : "memory");
+    __asm__ __volatile__("rep movsb" : "+S"(s), "+D"(d), "+c"(tail) : : "memory");
+}
+
+static uint32_t pack32(uint32_t rgb){ return rgb & 0x00FFFFFFu; }
+static uint32_t pack24(uint32_t rgb){ return rgb & 0x00FFFFFFu; }
+static uint32_t pack16(uint32_t rgb){ return fb_rgb565((uint8_t)(rgb>>16), (uint8_t)(rgb>>8), (uint8_t)rgb); }
+
+static void fill32(uint8_t* d, int pitch, int w, int h, uint32_t px){
+    for (int y=0; y<h; ++y, d+=pitch) stosl(d, px, (uint32_t)w);
+}
+
+static void fill16(uint8_t* d, int pitch, int w, int h, uint32_t px){
+    uint32_t pair = (px & 0xFFFF) | (px << 16);
+    for (int y=0; y<h; ++y, d+=pitch){
+        uint16_t* p = (uint16_t*)d; int n = w;
+        if (((uintptr_t)p & 2) && n) { *p++ = (uint16_t)px; n--; }
+        stosl(p, pair, (uint32_t)n >> 1);
+        if (n & 1) p[n-1] = (uint16_t)px;
+    }
+}
+
+static void fill24(uint8_t* d, int pitch, int w, int h, uint32_t px){
+    // 4 pixels = 12 bytes = 3 dwords (B G R B | G R B G | R B G R)
+    uint32_t b = px & 0xFF, g = (px >> 8) & 0xFF, r = (px >> 16) & 0xFF;
+    uint32_t p0 = b | g<<8 | r<<16 | b<<24, p1 = g | r<<8 | b<<16 | g<<24, p2 = r | b<<8 | g<<16 | r<<24;
+    for (int y=0; y<h; ++y, d+=pitch){
+        uint32_t* q = (uint32_t*)d; int n = w;
+        for (; n >= 4; n -= 4, q += 3) { q[0] = p0; q[1] = p1; q[2] = p2; }
+        uint8_t* t = (uint8_t*)q;
+        while (n--) { *t++ = (uint8_t)b; *t++ = (uint8_t)g; *t++ = (uint8_t)r; }
+    }
+}
+
+#define DEF_COPY(name, bytespp) \
+static void name(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){ \
+    for (int y=0; y<h; ++y, d+=dp, s+=sp) movs(d, s, (uint32_t)w * bytespp); \
+}
+DEF_COPY(copy32, 4)
+DEF_COPY(copy24, 3)
+DEF_COPY(copy16, 2)
+
+static void c8888_to_32(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){ copy32(d, dp, s, sp, w, h); }
+
+static void c8888_to_16(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){
+    for (int y=0; y<h; ++y, d+=dp, s+=sp){
+        const uint32_t* in = (const uint32_t*)s; uint16_t* out = (uint16_t*)d; int x = 0;
+        for (; x+1 < w; x += 2){
+            uint32_t a = in[x], b = in[x+1];
+            uint32_t pa = ((a >> 8) & 0xF800) | ((a >> 5) & 0x07E0) | ((a >> 3) & 0x001F);
+            uint32_t pb = ((b >> 8) & 0xF800) | ((b >> 5) & 0x07E0) | ((b >> 3) & 0x001F);
+            if (((uintptr_t)(out + x) & 2) == 0) *(uint32_t*)(out + x) = pa | (pb << 16);
+            else { out[x] = (uint16_t)pa; out[x+1] = (uint16_t)pb; }
+        }
+        if (x < w){ uint32_t a = in[x]; out[x] = (uint16_t)(((a >> 8) & 0xF800) | ((a >> 5) & 0x07E0) | ((a >> 3) & 0x001F)); }
+    }
+}
+
+static void c8888_to_24(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){
+    for (int y=0; y<h; ++y, d+=dp, s+=sp){
+        const uint32_t* in = (const uint32_t*)s; uint8_t* out = d;
+        for (int x=0; x<w; ++x){ uint32_t a = in[x]; out[0] = (uint8_t)a; out[1] = (uint8_t)(a>>8); out[2] = (uint8_t)(a>>16); out += 3; }
+    }
+}
+
+static inline uint32_t expand565(uint32_t c){
+    uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+    return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+static void c565_to_32(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){
+    for (int y=0; y<h; ++y, d+=dp, s+=sp){
+        const uint16_t* in = (const uint16_t*)s; uint32_t* out = (uint32_t*)d;
+        for (int x=0; x<w; ++x) out[x] = expand565(in[x]);
+    }
+}
+
+static void c565_to_24(uint8_t* d, int dp, const uint8_t* s, int sp, int w, int h){
+    for (int y=0; y<h; ++y, d+=dp, s+=sp){
+        const uint16_t* in = (const uint16_t*)s; uint8_t* out = d;
+        for (int x=0; x<w; ++x){ uint32_t a = expand565(in[x]); out[0] = (uint8_t)a; out[1] = (uint8_t)(a>>8); out[2] = (uint8_t)(a>>16); out += 3; }
+    }
+}
+
+static const fb_ops_t ops32 = { 32, 4, pack32, fill32, copy32, c8888_to_32, c565_to_32 };
+static const fb_ops_t ops24 = { 24, 3, pack24, fill24, copy24, c8888_to_24, c565_to_24 };
+static const fb_ops_t ops16 = { 16, 2, pack16, fill16, copy16, c8888_to_16, copy16 };
+
+const fb_ops_t* fb_ops_for(int bpp){
+    switch (bpp) {
+    case 32: return &ops32;
+    case 24: return &ops24;
+    case 16: return &ops16;
+    default: return 0;
+    }
+}
+
+static fb_rect_t dirty[FB_MAX_DIRTY];
+static int ndirty = 0;
+static fb_stats_t stats;
 
 void fb_init(void){
     const bootinfo_fb_t* bi = (const bootinfo_fb_t*)(uintptr_t)FB_BOOTINFO_ADDR;
     if (bi && bi->magic == 0xB007F00Du && bi->present){
+        const vbe_modeinfo_t* mi = (const vbe_modeinfo_t*)(uintptr_t)FB_BOOTINFO_MODEINFO;
         g_fb.present = 1;
-        g_fb.width = bi->width;
-        g_fb.height = bi->height;
-        g_fb.pitch = bi->pitch;
-        g_fb.bpp = bi->bpp;
-        g_fb.addr = (volatile void*)(uintptr_t)bi->phys_base;
+        g_fb.width = mi->width;
+        g_fb.height = mi->height;
+        g_fb.pitch = mi->pitch;
+        g_fb.bpp = mi->bpp;
+        g_fb.addr = (volatile void*)(uintptr_t)mi->phys_base;
+        if ((uint32_t)g_fb.pitch * g_fb.height > FB_BACKBUF_MAX){
+            g_fb.present = 0;
+            console_writeln("fb: mode too large for back buffer (staying in text mode)");
+            return;
+        }
+        // Back buffer, glyph cache and surface arena are fixed ranges from
+        // 16 MiB up; the framebuffer console needs all three
+        if (!mem_phys_fits(FB_BACKBUF_ADDR, SURFACE_ARENA_ADDR + SURFACE_ARENA_SIZE - FB_BACKBUF_ADDR)){
+            g_fb.present = 0;
+            console_writeln("fb: not enough RAM for the back buffer (staying in text mode)");
+            return;
+        }
+        g_fbops = fb_ops_for(g_fb.bpp);
+        if (!g_fbops){
+            g_fb.present = 0;
+            console_writeln("fb: unsupported bpp (staying in text mode)");
+            return;
+        }
+        g_fb.back = (uint8_t*)(uintptr_t)FB_BACKBUF_ADDR;
+        ndirty = 0;
         console_writeln("fb: initialized from boot info");
         return;
     }
@@ -26,51 +161,83 @@ uint16_t fb_rgb565(uint8_t r, uint8_t g, uint8_t b){
     return (uint16_t)(((r>>3)<<11) | ((g>>2)<<5) | (b>>3));
 }
 
-void fb_clear(uint32_t color){
-    if(!g_fb.present) return;
-    uint8_t* base = (uint8_t*)g_fb.addr;
-    if (g_fb.bpp == 32){
-        for (int y=0; y<g_fb.height; ++y){
-            uint32_t* row = (uint32_t*)(base + y*g_fb.pitch);
-            for (int x=0; x<g_fb.width; ++x) row[x] = color;
-        }
-    } else if (g_fb.bpp == 16){
-        uint16_t c = (uint16_t)color;
-        for (int y=0; y<g_fb.height; ++y){
-            uint16_t* row = (uint16_t*)(base + y*g_fb.pitch);
-            for (int x=0; x<g_fb.width; ++x) row[x] = c;
+static int rect_clip(int* x, int* y, int* w, int* h){
+    if (*x<0){ *w+=*x; *x=0; }
+    if (*y<0){ *h+=*y; *y=0; }
+    if (*x+*w>g_fb.width) *w=g_fb.width-*x;
+    if (*y+*h>g_fb.height) *h=g_fb.height-*y;
+    return *w>0 && *h>0;
+}
+
+void fb_damage(int x, int y, int w, int h){
+    if (!g_fb.present || !rect_clip(&x,&y,&w,&h)) return;
+    fb_rect_t r = { x, y, w, h };
+    // Merge with an existing rect when the union wastes little area, so
+    // overlapping draws (body, border, title) collapse into one copy
+    for (int i=0;i<ndirty;++i){
+        fb_rect_t u = rect_union(&dirty[i], &r);
+        if (rect_area(&u) <= rect_area(&dirty[i]) + rect_area(&r) + (rect_area(&u) >> 3)){
+            dirty[i] = dirty[--ndirty];
+            fb_damage(u.x, u.y, u.w, u.h);   // may merge again
+            return;
         }
     }
+    if (ndirty == FB_MAX_DIRTY){
+        // List full: fold everything into one bounding box
+        for (int i=1;i<ndirty;++i) dirty[0] = rect_union(&dirty[0], &dirty[i]);
+        dirty[0] = rect_union(&dirty[0], &r);
+        ndirty = 1;
+        return;
+    }
+    dirty[ndirty++] = r;
+}
+
+// Wide copy of one rectangle from the back buffer to the LFB
+static uint32_t present_rect(const fb_rect_t* r){
+    int bytespp = g_fbops->bytespp;
+    uint32_t off = (uint32_t)r->y * g_fb.pitch + (uint32_t)(r->x * bytespp);
+    uint32_t n = (uint32_t)(r->w * bytespp);
+    const uint8_t* src = g_fb.back + off;
+    uint8_t* dst = (uint8_t*)g_fb.addr + off;
+    for (int yy=0; yy<r->h; ++yy){
+        movs(dst, src, n);
+        src += g_fb.pitch; dst += g_fb.pitch;
+    }
+    return n * (uint32_t)r->h;
+}
+
+void fb_present(void){
+    if (!g_fb.present) return;
+    uint64_t t0 = rdtsc();
+    uint32_t bytes = 0;
+    for (int i=0;i<ndirty;++i) bytes += present_rect(&dirty[i]);
+    stats.last_rects = (uint32_t)ndirty;
+    ndirty = 0;
+    stats.last_bytes = bytes;
+    stats.last_cycles = (uint32_t)(rdtsc() - t0);
+    stats.frames++;
+}
+
+const fb_stats_t* fb_stats(void){ return &stats; }
+
+void fb_clear(uint32_t color){
+    if(!g_fb.present) return;
+    g_fbops->fill(g_fb.back, g_fb.pitch, g_fb.width, g_fb.height, g_fbops->pack(color));
+    ndirty = 0;
+    fb_damage(0, 0, g_fb.width, g_fb.height);
 }
 
 void fb_putpixel(int x, int y, uint32_t color){
     if(!g_fb.present) return; if (x<0||y<0||x>=g_fb.width||y>=g_fb.height) return;
-    uint8_t* base = (uint8_t*)g_fb.addr;
-    if (g_fb.bpp == 32){
-        *(uint32_t*)(base + y*g_fb.pitch + x*4) = color;
-    } else if (g_fb.bpp == 16){
-        *(uint16_t*)(base + y*g_fb.pitch + x*2) = (uint16_t)color;
-    }
+    g_fbops->fill(g_fb.back + y*g_fb.pitch + x*g_fbops->bytespp, g_fb.pitch, 1, 1, g_fbops->pack(color));
+    fb_damage(x, y, 1, 1);
 }
 
 void fb_fill_rect(int x, int y, int w, int h, uint32_t color){
     if(!g_fb.present) return;
-    if (x<0){ w+=x; x=0; } if (y<0){ h+=y; y=0; }
-    if (x+w>g_fb.width) w=g_fb.width-x; if (y+h>g_fb.height) h=g_fb.height-y;
-    if (w<=0||h<=0) return;
-    uint8_t* base = (uint8_t*)g_fb.addr;
-    if (g_fb.bpp == 32){
-        for (int yy=0; yy<h; ++yy){
-            uint32_t* row = (uint32_t*)(base + (y+yy)*g_fb.pitch + x*4);
-            for (int xx=0; xx<w; ++xx) row[xx] = color;
-        }
-    } else if (g_fb.bpp == 16){
-        uint16_t c=(uint16_t)color;
-        for (int yy=0; yy<h; ++yy){
-            uint16_t* row = (uint16_t*)(base + (y+yy)*g_fb.pitch + x*2);
-            for (int xx=0; xx<w; ++xx) row[xx] = c;
-        }
-    }
+    if (!rect_clip(&x,&y,&w,&h)) return;
+    g_fbops->fill(g_fb.back + y*g_fb.pitch + x*g_fbops->bytespp, g_fb.pitch, w, h, g_fbops->pack(color));
+    fb_damage(x, y, w, h);
 }
 
 void fb_rect_border(int x, int y, int w, int h, int thickness, uint32_t color){
@@ -80,3 +247,49 @@ void fb_rect_border(int x, int y, int w, int h, int thickness, uint32_t color){
     fb_fill_rect(x, y, thickness, h, color);
     fb_fill_rect(x+w-thickness, y, thickness, h, color);
 }
+
+void fb_blit(int x, int y, const void* src, int src_bpp, int spitch, int w, int h){
+    if(!g_fb.present) return;
+    const uint8_t* s = (const uint8_t*)src;
+    int sb = src_bpp / 8;
+    int x0 = x, y0 = y;
+    if (!rect_clip(&x,&y,&w,&h)) return;
+    s += (y - y0) * spitch + (x - x0) * sb;
+    uint8_t* d = g_fb.back + y*g_fb.pitch + x*g_fbops->bytespp;
+    if (src_bpp == g_fb.bpp) g_fbops->copy(d, g_fb.pitch, s, spitch, w, h);
+    else if (src_bpp == 32) g_fbops->from8888(d, g_fb.pitch, s, spitch, w, h);
+    else if (src_bpp == 16) g_fbops->from565(d, g_fb.pitch, s, spitch, w, h);
+    else return;
+    fb_damage(x, y, w, h);
+}
+
+int fb_bench(int bpp, fb_bench_t* out){
+    const fb_ops_t* ops = fb_ops_for(bpp);
+    if (!g_fb.present || !ops) return -1;
+    int w = g_fb.width, h = g_fb.height;
+    if ((uint32_t)w * ops->bytespp * (uint32_t)h > FB_BACKBUF_MAX) return -2;
+    // Lay the back buffer out as `bpp` and time the public entry points,
+    // damage tracking included; the mode is put back afterwards
+    framebuffer_t saved = g_fb;
+    const fb_ops_t* saved_ops = g_fbops;
+    g_fb.bpp = (uint8_t)bpp; g_fb.pitch = (uint16_t)(w * ops->bytespp); g_fbops = ops;
+
+    uint64_t t0 = rdtsc();
+    for (int i=0;i<1000;++i) fb_clear(0x00336699u ^ (uint32_t)i);
+    uint64_t t1 = rdtsc();
+    uint32_t seed = 12345;
+    for (int i=0;i<100000;++i){
+        seed = seed*1664525u + 1013904223u;
+        int rx = (int)((seed >> 8) % (uint32_t)(w - 16)), ry = (int)((seed >> 20) % (uint32_t)(h - 16));
+        fb_fill_rect(rx, ry, 16, 16, 0x00336699u);
+    }
+    uint64_t t2 = rdtsc();
+
+    g_fb = saved; g_fbops = saved_ops;
+    ndirty = 0;
+    out->clear_cycles = (uint32_t)udiv64_32(t1 - t0, 1000);
+    out->clear_px_per_sec = tsc_per_sec((uint64_t)1000 * (uint32_t)(w*h), t1 - t0);
+    out->rect_cycles = (uint32_t)udiv64_32(t2 - t1, 100000);
+    out->rect_px_per_sec = tsc_per_sec((uint64_t)100000 * 256, t2 - t1);
+    return 0;
+}
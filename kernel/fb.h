@@ -1,30 +1,70 @@
 #pragma once
 #include <stdint.h>
 
+// Written by the bootloader when ENABLE_VBE set a mode. The geometry is
+// taken from the VBE mode info block the BIOS left at FB_BOOTINFO_MODEINFO
 typedef struct {
     uint32_t magic;     // 0xB007F00D
     uint16_t present;   // 1 if VBE LFB set
     uint16_t reserved;
-    uint16_t width;
-    uint16_t height;
-    uint16_t pitch;     // bytes per scanline
-    uint8_t  bpp;       // 16 or 32
-    uint8_t  pad[1];
-    uint32_t phys_base; // LFB physical address
 } bootinfo_fb_t;
 
 #define FB_BOOTINFO_ADDR 0x00070000u
+#define FB_BOOTINFO_MODEINFO (FB_BOOTINFO_ADDR + 0x100u)
+
+// The fields of the VBE ModeInfoBlock that fb_init uses
+typedef struct __attribute__((packed)) {
+    uint8_t  pad0[0x10];
+    uint16_t pitch;     // BytesPerScanLine
+    uint16_t width;     // XResolution
+    uint16_t height;    // YResolution
+    uint8_t  pad1[3];
+    uint8_t  bpp;       // BitsPerPixel
+    uint8_t  pad2[0x0E];
+    uint32_t phys_base; // PhysBasePtr
+} vbe_modeinfo_t;
+
+// Off-screen back buffer in system RAM (above the kernel image and pool).
+// All fb_* drawing lands here; fb_present copies damaged areas to the LFB.
+#define FB_BACKBUF_ADDR 0x01000000u
+#define FB_BACKBUF_MAX  (8u*1024u*1024u)
+#define FB_MAX_DIRTY 16
 
 typedef struct {
     uint8_t present;     // 1 if LFB available
     uint16_t width;
     uint16_t height;
     uint16_t pitch;      // bytes per scanline
-    uint8_t bpp;         // bits per pixel (16 or 32 supported)
+    uint8_t bpp;         // bits per pixel (16, 24 or 32 supported)
     volatile void* addr; // linear framebuffer base
+    uint8_t* back;       // back buffer (same pitch as the LFB)
 } framebuffer_t;
 
+typedef struct { int x, y, w, h; } fb_rect_t;
+
+// Per-format pixel kernels, chosen once by fb_init from g_fb.bpp. Callers
+// clip; kernels do no bounds or format checks. Colors given to fb_* are
+// 0x00RRGGBB and are packed once per call with `pack`.
+typedef struct {
+    uint8_t bpp;
+    uint8_t bytespp;
+    uint32_t (*pack)(uint32_t rgb);
+    void (*fill)(uint8_t* dst, int pitch, int w, int h, uint32_t px);
+    void (*copy)(uint8_t* dst, int dpitch, const uint8_t* src, int spitch, int w, int h);
+    // Convert ARGB8888 / RGB565 source rows into this format
+    void (*from8888)(uint8_t* dst, int dpitch, const uint8_t* src, int spitch, int w, int h);
+    void (*from565)(uint8_t* dst, int dpitch, const uint8_t* src, int spitch, int w, int h);
+} fb_ops_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t last_cycles;   // TSC cycles spent in the last fb_present
+    uint32_t last_bytes;    // bytes copied to the LFB by it
+    uint32_t last_rects;
+} fb_stats_t;
+
 extern framebuffer_t g_fb;
+extern const fb_ops_t* g_fbops;   // NULL until fb_init finds an LFB
 
 void fb_init(void);
 uint16_t fb_rgb565(uint8_t r, uint8_t g, uint8_t b);
@@ -32,3 +72,26 @@ void fb_clear(uint32_t color);
 void fb_putpixel(int x, int y, uint32_t color);
 void fb_fill_rect(int x, int y, int w, int h, uint32_t color);
 void fb_rect_border(int x, int y, int w, int h, int thickness, uint32_t color);
+
+// Damage tracking: primitives call fb_damage; fb_present merges the list
+// and copies only those rectangles to the LFB
+void fb_damage(int x, int y, int w, int h);
+void fb_present(void);
+const fb_stats_t* fb_stats(void);
+
+// Blit a w*h block of src (src_bpp 16 or 32) into the back buffer at x,y,
+// converting to the screen format
+void fb_blit(int x, int y, const void* src, int src_bpp, int spitch, int w, int h);
+
+const fb_ops_t* fb_ops_for(int bpp);   // NULL if unsupported
+
+typedef struct {
+    uint32_t clear_cycles;      // per full-screen clear
+    uint32_t clear_px_per_sec;
+    uint32_t rect_cycles;       // per small rect
+    uint32_t rect_px_per_sec;
+} fb_bench_t;
+// 1000 fb_clear and 100k 16x16 fb_fill_rect calls at the screen size with
+// the back buffer laid out as `bpp`. Needs an LFB (-1 otherwise); the
+// caller recomposes the screen afterwards
+int fb_bench(int bpp, fb_bench_t* out);
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include "font.h"
+
+typedef struct {
+    uint32_t fg, bg;      // packed pixels for the current format
+    uint8_t bpp;          // 0 = slot unused
+    uint32_t last_use;
+    uint8_t ready[FONT_GLYPHS];
+} glyph_slot_t;
+
+static glyph_slot_t slots[GLYPH_CACHE_SLOTS];
+static uint32_t use_clock = 0;
+
+static uint8_t* slot_pixels(int s, unsigned char c){
+    return (uint8_t*)(uintptr_t)GLYPH_CACHE_ADDR + ((uint32_t)s * FONT_GLYPHS + c) * GLYPH_BYTES_MAX;
+}
+
+void glyph_cache_reset(void){
+    for (int i=0;i<GLYPH_CACHE_SLOTS;++i) slots[i].bpp = 0;
+}
+
+static void expand(uint8_t* out, const fb_ops_t* ops, uint32_t fg, uint32_t bg, unsigned char c){
+    const uint8_t* bits = font8x16[c];
+    int stride = FONT_W * ops->bytespp;
+    for (int y=0; y<FONT_H; ++y, out += stride){
+        uint8_t b = bits[y];
+        // Runs of equal bits become single fills
+        int x = 0;
+        while (x < FONT_W){
+            int on = (b >> (7-x)) & 1, n = 1;
+            while (x+n < FONT_W && (((b >> (7-x-n)) & 1) == on)) n++;
+            ops->fill(out + x*ops->bytespp, stride, n, 1, on ? fg : bg);
+            x += n;
+        }
+    }
+}
+
+const uint8_t* glyph_cache_get(uint32_t fg, uint32_t bg, unsigned char c){
+    const fb_ops_t* ops = g_fbops;
+    if (c >= FONT_GLYPHS) c = 0x7F;
+    uint32_t pf = ops->pack(fg), pb = ops->pack(bg);
+    int s = -1, victim = 0;
+    for (int i=0;i<GLYPH_CACHE_SLOTS;++i){
+        if (slots[i].bpp == ops->bpp && slots[i].fg == pf && slots[i].bg == pb){ s = i; break; }
+        if (slots[i].bpp == 0 || slots[i].last_use < slots[victim].last_use) victim = i;
+    }
+    if (s < 0){
+        s = victim;
+        slots[s].fg = pf; slots[s].bg = pb; slots[s].bpp = ops->bpp;
+        for (int i=0;i<FONT_GLYPHS;++i) slots[s].ready[i] = 0;
+    }
+    slots[s].last_use = ++use_clock;
+    uint8_t* px = slot_pixels(s, c);
+    if (!slots[s].ready[c]){ expand(px, ops, pf, pb, c); slots[s].ready[c] = 1; }
+    return px;
+}
+
+void font_draw_run(surface_t* dst, int x, int y, const char* s, int len, uint32_t fg, uint32_t bg){
+    if (!g_fbops || !dst->px || len <= 0) return;
+    const fb_ops_t* ops = g_fbops;
+    int gstride = FONT_W * ops->bytespp;
+    if (x >= 0 && y >= 0 && y + FONT_H <= dst->h && x + len*FONT_W <= dst->w){
+        // Whole run inside: straight row copies from the cache
+        uint8_t* d = dst->px + y*dst->pitch + x*ops->bytespp;
+        for (int i=0; i<len; ++i, d += gstride)
+            ops->copy(d, dst->pitch, glyph_cache_get(fg, bg, (unsigned char)s[i]), gstride, FONT_W, FONT_H);
+    } else {
+        // Partially visible: surf_copy clips each glyph
+        surface_t g = { FONT_W, FONT_H, gstride, ops->bpp, 0, 0 };
+        for (int i=0; i<len; ++i){
+            g.px = (uint8_t*)glyph_cache_get(fg, bg, (unsigned char)s[i]);
+            surf_copy(dst, x + i*FONT_W, y, &g, 0, 0, FONT_W, FONT_H);
+        }
+    }
+}
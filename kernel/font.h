@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include "fb.h"
+#include "surface.h"
+
+#define FONT_W 8
+#define FONT_H 16
+#define FONT_GLYPHS 128
+
+extern const uint8_t font8x16[FONT_GLYPHS][FONT_H];
+
+// Glyph cache: glyphs pre-expanded into rows of screen-format pixels for a
+// given (fg, bg) pair, so drawing text is a row copy per glyph. Each slot
+// covers one color pair and fills lazily; the least recently used slot is
+// recycled. Storage sits after the framebuffer back buffer.
+#define GLYPH_CACHE_ADDR  (FB_BACKBUF_ADDR + FB_BACKBUF_MAX)
+#define GLYPH_CACHE_SLOTS 8
+#define GLYPH_BYTES_MAX   (FONT_W * FONT_H * 4)
+
+// FONT_H rows of FONT_W pixels, tightly packed (row stride FONT_W*bytespp).
+// Colors are 0x00RRGGBB; requires an LFB (g_fbops set).
+const uint8_t* glyph_cache_get(uint32_t fg, uint32_t bg, unsigned char c);
+void glyph_cache_reset(void);   // after a mode change
+
+// Draw exactly len glyphs at pixel x,y into dst (clipped). Does not record
+// damage; the caller knows whether dst is the back buffer or a window.
+void font_draw_run(surface_t* dst, int x, int y, const char* s, int len, uint32_t fg, uint32_t bg);
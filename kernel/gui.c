@@ -1,18 +1,85 @@
 #include <stdint.h>
 #include "gui.h"
 #include "console.h"
+#include "font.h"
+#include "wm.h"
+#include "io.h"
+#include "shell.h"
+
+#ifdef ENABLE_GUI
+static GuiWindow demo_win = { .id = -1 };
+
+// One line per GUI frame: client draw time, compose+present time and what it touched
+static void print_frame_stats(uint32_t draw_cyc, uint32_t render_cyc){
+    const wm_stats_t* ws = wm_stats(); const fb_stats_t* fs = fb_stats(); char b[16];
+    sh_write("frame: draw="); u32_to_dec(draw_cyc, b); sh_write(b);
+    sh_write(" render="); u32_to_dec(render_cyc, b); sh_write(b);
+    sh_write(" cyc, composed "); u32_to_dec(ws->last_px, b); sh_write(b);
+    sh_write(" px in "); u32_to_dec(ws->last_rects, b); sh_write(b);
+    sh_write(" rects, presented "); u32_to_dec(fs->last_bytes, b); sh_write(b);
+    sh_write(" bytes, frame #"); u32_to_dec(fs->frames, b); sh_writeln(b);
+}
+
+static int cmd_gui(int argc, char** argv){
+    const char* sub = argc > 1 ? argv[1] : "";
+    if (shell_streq(sub, "demo") && argc == 2) {
+        if (!g_fb.present){ console_writeln("no framebuffer"); return -1; }
+        uint64_t t0 = rdtsc();
+        if (demo_win.id < 0) gui_window_init(&demo_win, 40, 30, 320, 200, "foxos GUI");
+        else wm_raise(demo_win.id);
+        gui_window_draw(&demo_win);
+        gui_window_fill_text(&demo_win, "Hello GUI!\nThis window is composited from its own surface.");
+        uint64_t t1 = rdtsc();
+        wm_render();
+        uint64_t t2 = rdtsc();
+        if (demo_win.id < 0) { console_writeln("gui: no window"); return -1; }
+        print_frame_stats((uint32_t)(t1-t0), (uint32_t)(t2-t1));
+        sh_writeln("gui ok");
+    } else if (shell_streq(sub, "move")) {
+        uint32_t x=0, y=0;
+        if (argc!=4 || parse_u32_dec(argv[2],&x)!=0 || parse_u32_dec(argv[3],&y)!=0 || x>4096 || y>4096){ console_writeln("usage: gui move X Y"); return -1; }
+        if (demo_win.id < 0){ console_writeln("gui: no window (run gui demo)"); return -1; }
+        uint64_t t0 = rdtsc();
+        gui_window_move(&demo_win, (int)x, (int)y);
+        wm_render();
+        print_frame_stats(0, (uint32_t)(rdtsc()-t0));
+    } else if (shell_streq(sub, "close") && argc == 2) {
+        if (demo_win.id < 0) { console_writeln("gui: no window"); return -1; }
+        gui_window_close(&demo_win); wm_render();
+    } else {
+        console_writeln("usage: gui demo|move X Y|close");
+        return -1;
+    }
+    return 0;
+}
+static const shell_cmd_t gui_cmd = { "gui", cmd_gui,
+    "gui demo\ngui move X Y\ngui close",
+    "open/redraw the demo window\nmove it (repaints exposed area)\nclose it", 0 };
+#else
+static int cmd_gui(int argc, char** argv){
+    (void)argc; (void)argv;
+    console_writeln("gui disabled");
+    return -1;
+}
+static const shell_cmd_t gui_cmd = { "gui", cmd_gui, 0, "GUI demo (not in this build)", 0 };
+#endif
 
 void gui_init(void){
 #ifndef ENABLE_GUI
-    // GUI disabled; do nothing
-    console_writeln("gui: disabled");
+    // GUI disabled; `gui` only says so
+    shell_register(&gui_cmd);
     return;
 #else
+    shell_register(&gui_cmd);
     fb_init();
+    glyph_cache_reset();
     if (!g_fb.present){
         console_writeln("gui: framebuffer not available; staying in text mode");
     } else {
-        fb_clear(0x00202020); // dark gray
+        // Desktop first, then the console as the bottom window
+        wm_damage_screen(0, 0, g_fb.width, g_fb.height);
+        wm_render();
+        console_attach_fb();
     }
 #endif
 }
@@ -24,30 +91,45 @@ void gui_window_init(GuiWindow* w, int x, int y, int w_, int h_, const char* tit
     w->title_bg = 0x00000080; // navy
     w->title_fg = 0x00FFFFFF; // white
     int i=0; for(; title && title[i] && i<(int)sizeof(w->title)-1; ++i) w->title[i]=title[i]; w->title[i]=0;
+#ifdef ENABLE_GUI
+    w->id = wm_create(x, y, w_, h_);
+#else
+    w->id = -1;
+#endif
 }
 
-static void draw_char(int x, int y, uint32_t fg, uint32_t bg, char c){
-    // Placeholder: no font yet; draw a tiny 6x8 block for each char to visualize text
-    int cw=6, ch=8;
-    fb_fill_rect(x, y, cw, ch, bg);
-    // Basic bar for non-space
-    if (c!=' '){ fb_rect_border(x, y, cw, ch, 1, fg); }
+int gui_draw_text(surface_t* dst, int x, int y, const char* s, int n, uint32_t fg, uint32_t bg){
+    if (!g_fb.present) return 0;
+    int len = 0; while ((n < 0 || len < n) && s[len] && s[len] != '\n') len++;
+    if (!len) return 0;
+    font_draw_run(dst, x, y, s, len, fg, bg);
+    return len;
 }
 
 void gui_window_draw(const GuiWindow* w){
 #ifndef ENABLE_GUI
     return;
 #else
-    if (!g_fb.present) return;
+    surface_t* s = wm_surface(w->id);
+    if (!s) return;
     // body and border
-    fb_fill_rect(w->x, w->y, w->w, w->h, w->bg);
-    fb_rect_border(w->x, w->y, w->w, w->h, 2, w->border);
+    surf_fill_rect(s, 0, 0, w->w, w->h, w->bg);
+    surf_rect_border(s, 0, 0, w->w, w->h, 2, w->border);
     // title bar
     int tb_h = 16;
-    fb_fill_rect(w->x+2, w->y+2, w->w-4, tb_h, w->title_bg);
-    // title text mock (monospace 6x8 blocks)
-    int tx = w->x+6, ty = w->y+4;
-    for(int i=0; w->title[i] && i<50; ++i){ draw_char(tx+i*6, ty, w->title_fg, w->title_bg, w->title[i]); }
+    surf_fill_rect(s, 2, 2, w->w-4, tb_h, w->title_bg);
+    // title text, clipped to the title bar
+    int maxc = (w->w - 12) / FONT_W;
+    if (maxc > 0) gui_draw_text(s, 6, 2, w->title, maxc, w->title_fg, w->title_bg);
+    // translucent gloss over the top half of the title bar
+    surface_t gloss;
+    if (surface_alloc_argb(&gloss, w->w-4, tb_h/2) == 0){
+        surf_fill_rect(&gloss, 0, 0, gloss.w, gloss.h, 0x40404040);   // white at 25%, premultiplied
+        fb_rect_t r = { 2, 2, gloss.w, gloss.h };
+        blit_alpha(&gloss, s, &r);
+        surface_free(&gloss);
+    }
+    wm_damage_window(w->id, 0, 0, w->w, w->h);
 #endif
 }
 
@@ -55,13 +137,32 @@ void gui_window_fill_text(const GuiWindow* w, const char* text){
 #ifndef ENABLE_GUI
     return;
 #else
-    if (!g_fb.present) return;
-    int tx = w->x+6, ty = w->y+20; int col=0, row=0; int cw=6, ch=8; int maxcols=(w->w-12)/cw; int maxrows=(w->h-28)/ch;
-    for (int i=0; text[i] && row<maxrows; ++i){
-        char c=text[i];
-        if (c=='\n'){ col=0; row++; continue; }
-        draw_char(tx + col*cw, ty + row*ch, 0x00000000, w->bg, c);
-        if (++col>=maxcols){ col=0; row++; }
+    surface_t* s = wm_surface(w->id);
+    if (!s) return;
+    int tx = 6, ty = 20; int maxcols=(w->w-12)/FONT_W; int maxrows=(w->h-28)/FONT_H;
+    if (maxcols <= 0) return;
+    // Lay out whole runs per row (wrapping at maxcols) and blit each at once
+    const char* p = text;
+    int row = 0;
+    for (; *p && row<maxrows; ++row){
+        int n = gui_draw_text(s, tx, ty + row*FONT_H, p, maxcols, 0x00000000, w->bg);
+        p += n;
+        if (*p == '\n') p++;
     }
+    if (row) wm_damage_window(w->id, tx, ty, maxcols*FONT_W, row*FONT_H);
+#endif
+}
+
+void gui_window_move(GuiWindow* w, int x, int y){
+#ifdef ENABLE_GUI
+    wm_move(w->id, x, y);
+#endif
+    w->x = x; w->y = y;
+}
+
+void gui_window_close(GuiWindow* w){
+#ifdef ENABLE_GUI
+    wm_destroy(w->id);
 #endif
+    w->id = -1;
 }
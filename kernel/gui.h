@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include "fb.h"
+#include "surface.h"
 
 typedef struct {
     int x, y, w, h;
@@ -9,9 +10,17 @@ typedef struct {
     uint32_t title_bg;
     uint32_t title_fg;
     char title[64];
+    int id;             // window manager id, <0 when not mapped
 } GuiWindow;
 
 void gui_init(void);
 void gui_window_init(GuiWindow* w, int x, int y, int w_, int h_, const char* title);
+// Drawing goes into the window's backing surface and is composited by wm
 void gui_window_draw(const GuiWindow* w);
 void gui_window_fill_text(const GuiWindow* w, const char* text);
+void gui_window_move(GuiWindow* w, int x, int y);
+void gui_window_close(GuiWindow* w);
+
+// Draw up to n chars of s (n < 0: to NUL) in one row of 8x16 cells into dst;
+// stops at '\n'. Returns the number of chars drawn. Colors are 0x00RRGGBB.
+int gui_draw_text(surface_t* dst, int x, int y, const char* s, int n, uint32_t fg, uint32_t bg);
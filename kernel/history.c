@@ -0,0 +1,26 @@
+#include <stdint.h>
+#include "history.h"
+
+static char buf[HISTORY_MAX][HISTORY_LINE];
+static int head = 0;     // next insert position
+static int count = 0;    // number of valid entries (<= HISTORY_MAX)
+
+static int str_eq(const char* a, const char* b){ int i=0; while(a[i] && b[i]){ if(a[i]!=b[i]) return 0; i++; } return a[i]==0 && b[i]==0; }
+
+void history_reset(void){ head = 0; count = 0; }
+
+int history_count(void){ return count; }
+
+const char* history_get(int offset){
+    if (offset < 0 || offset >= count) return 0;
+    int idx = head - 1 - offset; if (idx < 0) idx += HISTORY_MAX;
+    return buf[idx];
+}
+
+void history_add(const char* line){
+    if (!line || !line[0]) return;
+    if (count > 0 && str_eq(history_get(0), line)) return;
+    int i = 0; while (line[i] && i < HISTORY_LINE-1){ buf[head][i] = line[i]; i++; } buf[head][i] = 0;
+    head = (head + 1) % HISTORY_MAX;
+    if (count < HISTORY_MAX) count++;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// Command-line history: a ring of the last HISTORY_MAX lines, newest at
+// offset 0. The shell's input loop keeps its own browse position.
+
+#define HISTORY_MAX 16
+#define HISTORY_LINE 256
+
+void history_reset(void);
+// Skips empty lines and repeats of the newest entry; long lines are cut
+void history_add(const char* line);
+int history_count(void);
+const char* history_get(int offset);   // NULL outside [0, history_count)
@@ -0,0 +1,51 @@
+; Interrupt entry stubs: CPU exceptions 0..31 and PIC IRQs 32..47
+[bits 32]
+
+global isr_stub_table
+extern isr_dispatch
+
+; Exceptions that push an error code themselves
+%macro ISR_STUB 1
+isr_%1:
+%if %1 = 8 || (%1 >= 10 && %1 <= 14) || %1 = 17 || %1 = 21 || %1 = 29 || %1 = 30
+    push dword %1
+%else
+    push dword 0            ; dummy error code
+    push dword %1
+%endif
+    jmp isr_common
+%endmacro
+
+section .text
+
+%assign i 0
+%rep 48
+ISR_STUB i
+%assign i i+1
+%endrep
+
+; Stack on entry: vector, error code, eip, cs, eflags
+isr_common:
+    pusha
+    push ds
+    push es
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    cld
+    push esp                ; isr_frame_t*
+    call isr_dispatch
+    add esp, 4
+    pop es
+    pop ds
+    popa
+    add esp, 8              ; drop vector + error code
+    iret
+
+section .rodata
+isr_stub_table:
+%assign i 0
+%rep 48
+    dd isr_%+i
+%assign i i+1
+%endrep
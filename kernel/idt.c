@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include "idt.h"
+#include "io.h"
+#include "console.h"
+#include "serial.h"
+#include "workqueue.h"
+#include "shell.h"
+
+#define PIC1_CMD  0x20
+#define PIC1_DATA 0x21
+#define PIC2_CMD  0xA0
+#define PIC2_DATA 0xA1
+#define PIC_EOI   0x20
+
+typedef struct {
+    uint16_t off_lo;
+    uint16_t sel;
+    uint8_t  zero;
+    uint8_t  type;
+    uint16_t off_hi;
+} __attribute__((packed)) idt_entry_t;
+
+static idt_entry_t idt[48];
+static irq_handler_t irq_handlers[IRQ_COUNT];
+static irq_stat_t irq_stat[IRQ_COUNT];
+static int g_irq_active = 0;
+static volatile int irq_depth = 0;
+
+extern const uint32_t isr_stub_table[48];
+
+static void idt_set(int n, uint32_t handler){
+    idt[n].off_lo = (uint16_t)(handler & 0xFFFF);
+    idt[n].sel = 0x08;   // flat code segment from the bootloader GDT
+    idt[n].zero = 0;
+    idt[n].type = 0x8E;  // present, ring 0, 32-bit interrupt gate
+    idt[n].off_hi = (uint16_t)(handler >> 16);
+}
+
+static void pic_remap(void){
+    uint8_t m1 = inb(PIC1_DATA), m2 = inb(PIC2_DATA); (void)m1; (void)m2;
+    outb(PIC1_CMD, 0x11); io_wait(); outb(PIC2_CMD, 0x11); io_wait();   // ICW1: init + ICW4
+    outb(PIC1_DATA, IRQ_BASE); io_wait(); outb(PIC2_DATA, IRQ_BASE+8); io_wait();
+    outb(PIC1_DATA, 0x04); io_wait(); outb(PIC2_DATA, 0x02); io_wait(); // cascade on IRQ2
+    outb(PIC1_DATA, 0x01); io_wait(); outb(PIC2_DATA, 0x01); io_wait(); // 8086 mode
+    // Everything masked except the cascade; irq_register unmasks lines
+    outb(PIC1_DATA, 0xFB); outb(PIC2_DATA, 0xFF);
+}
+
+void irq_mask(int irq){
+    if (irq<0||irq>=IRQ_COUNT) return;
+    uint16_t port = irq<8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, (uint8_t)(inb(port) | (1u << (irq & 7))));
+}
+
+void irq_unmask(int irq){
+    if (irq<0||irq>=IRQ_COUNT) return;
+    uint16_t port = irq<8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, (uint8_t)(inb(port) & ~(1u << (irq & 7))));
+}
+
+int irq_register(int irq, irq_handler_t h){
+    if (irq<0||irq>=IRQ_COUNT) return -1;
+    uint32_t f = irq_save();
+    irq_handlers[irq] = h;
+    if (h) irq_unmask(irq); else irq_mask(irq);
+    irq_restore(f);
+    return 0;
+}
+
+int irq_active(void){ return g_irq_active; }
+
+const irq_stat_t* irq_stats(int irq){ return (irq>=0 && irq<IRQ_COUNT) ? &irq_stat[irq] : 0; }
+
+static int cmd_irqstat(int argc, char** argv){
+    (void)argc; (void)argv;
+    char b[16];
+    for (int q=0; q<IRQ_COUNT; ++q){
+        const irq_stat_t* s = irq_stats(q); if (!s || !s->count) continue;
+        sh_write("irq "); u32_to_dec((uint32_t)q, b); sh_write(b);
+        sh_write(": count="); u32_to_dec(s->count, b); sh_write(b);
+        sh_write(" avg_cyc="); u32_to_dec((uint32_t)udiv64_32(s->cycles_total, s->count), b); sh_write(b);
+        sh_write(" max_cyc="); u32_to_dec(s->cycles_max, b); sh_writeln(b);
+    }
+    const wq_stat_t* w = work_stats();
+    sh_write("work: queued="); u32_to_dec(w->queued, b); sh_write(b);
+    sh_write(" ran="); u32_to_dec(w->ran, b); sh_write(b);
+    sh_write(" batches="); u32_to_dec(w->batches, b); sh_write(b);
+    sh_write(" max_batch="); u32_to_dec(w->max_batch, b); sh_write(b);
+    sh_write(" dropped="); u32_to_dec(w->dropped, b); sh_writeln(b);
+    sh_write("serial: tx dropped="); u32_to_dec(serial_tx_dropped(), b); sh_writeln(b);
+    return 0;
+}
+static const shell_cmd_t irqstat_cmd = { "irqstat", cmd_irqstat, 0, "IRQ top-half and work queue stats", 0 };
+
+void idt_init(void){
+    shell_register(&irqstat_cmd);
+    for (int i=0;i<48;++i) idt_set(i, isr_stub_table[i]);
+    pic_remap();
+    struct { uint16_t limit; uint32_t base; } __attribute__((packed)) idtr = { sizeof(idt)-1, (uint32_t)(uintptr_t)idt };
+    __asm__ __volatile__("lidt %0" : : "m"(idtr));
+    g_irq_active = 1;
+    __asm__ __volatile__("sti");
+}
+
+static void exception_halt(const isr_frame_t* f){
+    static const char hexd[] = "0123456789ABCDEF";
+    char msg[] = "[cpu] exception 0x00 at eip 0x00000000";
+    msg[18] = hexd[(f->vector>>4)&0xF]; msg[19] = hexd[f->vector&0xF];
+    for (int i=0;i<8;++i) msg[30+i] = hexd[(f->eip >> (28-4*i)) & 0xF];
+    serial_write_sync(msg); serial_write_sync("\n");
+    console_writeln(msg); console_flush();
+    for(;;){ __asm__ __volatile__("cli; hlt"); }
+}
+
+void isr_dispatch(isr_frame_t* f){
+    if (f->vector < IRQ_BASE) { exception_halt(f); return; }
+    int irq = (int)f->vector - IRQ_BASE;
+    if (irq >= IRQ_COUNT) return;
+    // Spurious IRQ7/15: the in-service bit is clear; no EOI on that PIC
+    if (irq == 7 || irq == 15) {
+        uint16_t cmd = irq==7 ? PIC1_CMD : PIC2_CMD;
+        outb(cmd, 0x0B);
+        if (!(inb(cmd) & 0x80)) { if (irq == 15) outb(PIC1_CMD, PIC_EOI); return; }
+    }
+
+    // Top half: interrupts are off from gate entry until EOI + return
+    uint64_t t0 = rdtsc();
+    irq_handler_t h = irq_handlers[irq];
+    if (h) h(irq);
+    if (irq >= 8) outb(PIC2_CMD, PIC_EOI);
+    outb(PIC1_CMD, PIC_EOI);
+    uint32_t dt = (uint32_t)(rdtsc() - t0);
+    irq_stat_t* s = &irq_stat[irq];
+    s->count++; s->cycles_total += dt; if (dt > s->cycles_max) s->cycles_max = dt;
+
+    // Bottom half: drain deferred work on the way out, interrupts on
+    if (irq_depth == 0) {
+        irq_depth++;
+        __asm__ __volatile__("sti");
+        work_run_pending();
+        __asm__ __volatile__("cli");
+        irq_depth--;
+    }
+}
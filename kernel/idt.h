@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+// Register frame pushed by isr_common in idt.asm
+typedef struct {
+    uint32_t es, ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; // pusha
+    uint32_t vector, err;
+    uint32_t eip, cs, eflags;
+} isr_frame_t;
+
+#define IRQ_BASE 0x20
+#define IRQ_COUNT 16
+
+// IRQ top half: runs with interrupts disabled; keep it to ack + enqueue
+typedef void (*irq_handler_t)(int irq);
+
+// Per-line top-half statistics (cycles measured with the TSC)
+typedef struct {
+    uint32_t count;
+    uint32_t cycles_max;   // longest interrupts-off stretch seen
+    uint64_t cycles_total;
+} irq_stat_t;
+
+void idt_init(void);   // remap PIC, install gates, sti
+int irq_register(int irq, irq_handler_t h); // also unmasks the line
+void irq_mask(int irq);
+void irq_unmask(int irq);
+int irq_active(void);   // 1 once idt_init has enabled interrupts
+const irq_stat_t* irq_stats(int irq);
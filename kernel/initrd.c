@@ -2,9 +2,11 @@
 #include "initrd.h"
 #include "vfs.h"
 
-// Weak defaults if not provided by the build system
-__attribute__((weak)) const unsigned char initrd_blob[] = "file:/etc/motd=Welcome to foxos\nfile:/init/hello.txt=Hello initrd\n";
-__attribute__((weak)) const unsigned int initrd_size = sizeof("file:/etc/motd=Welcome to foxos\nfile:/init/hello.txt=Hello initrd\n")-1;
+// Weak defaults if not provided by the build system. File data is one line;
+// in it \n stands for a newline and \\ for a backslash
+#define INITRD_DEFAULT_RC "# headless boot script\\necho foxos headless boot\\nmem\\nshutdown"
+__attribute__((weak)) const unsigned char initrd_blob[] = "file:/etc/motd=Welcome to foxos\nfile:/init/hello.txt=Hello initrd\nfile:/init/rc=" INITRD_DEFAULT_RC "\n";
+__attribute__((weak)) const unsigned int initrd_size = sizeof("file:/etc/motd=Welcome to foxos\nfile:/init/hello.txt=Hello initrd\nfile:/init/rc=" INITRD_DEFAULT_RC "\n")-1;
 
 static int starts_with(const char* s, const char* p){ while(*p){ if(*s++!=*p++) return 0; } return 1; }
 
@@ -17,8 +19,16 @@ void initrd_load_into_ramfs(void){
             const char* path = p+5; const char* eq = path; while(eq<nl && *eq!='=') ++eq;
             if (eq<nl) {
                 char spath[128]; unsigned i=0; while(path<eq && i<sizeof(spath)-1) spath[i++]=*path++; spath[i]=0;
-                const char* data = eq+1; uint32_t len = (uint32_t)(nl - data);
-                vfs_write(spath, data, len);
+                // Unescape by writing the literal spans between escapes
+                const char* data = eq+1; const char* run = data;
+                vfs_write(spath, "", 0);
+                for (const char* q = data; q < nl; ++q) {
+                    if (*q != '\\' || q + 1 >= nl) continue;
+                    vfs_append(spath, run, (uint32_t)(q - run));
+                    vfs_append(spath, q[1] == 'n' ? "\n" : q + 1, 1);
+                    run = ++q + 1;
+                }
+                vfs_append(spath, run, (uint32_t)(nl - run));
             }
         }
         p = nl + 1;
@@ -24,3 +24,35 @@ static inline uint16_t inw(uint16_t port) {
 static inline void outw(uint16_t port, uint16_t val) {
     __asm__ __volatile__("outw %0, %1" : : "a"(val), "Nd"(port));
 }
+
+// Time-stamp counter (cycles since reset)
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Save EFLAGS and disable interrupts; pair with irq_restore. The host
+// build of the portable modules (tests/host, FOXOS_HOST) has no IF to touch
+#ifdef FOXOS_HOST
+static inline uint32_t irq_save(void) { return 0; }
+static inline void irq_restore(uint32_t flags) { (void)flags; }
+#else
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) __asm__ __volatile__("sti" : : : "memory");
+}
+#endif
+
+// 64/32 unsigned divide without libgcc (__udivdi3 is not linked)
+static inline uint64_t udiv64_32(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n;
+    uint32_t qhi = hi / d, r = hi % d, qlo;
+    __asm__("divl %4" : "=a"(qlo), "=d"(r) : "a"(lo), "d"(r), "rm"(d));
+    return ((uint64_t)qhi << 32) | qlo;
+}
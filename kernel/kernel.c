@@ -10,6 +10,16 @@
 #include "render.h"
 #include "gui.h"
 #include "serial.h"
+#include "idt.h"
+#include "workqueue.h"
+#include "klog.h"
+#include "tsc.h"
+#include "wm.h"
+#include "cpu.h"
+#include "shell.h"
+#include "bench.h"
+#include "history.h"
+#include "bootprof.h"
 
 #ifndef DISK_SECTORS
 #define DISK_SECTORS 2880
@@ -24,11 +34,7 @@
 #define PT_LBA_COUNT 0
 #endif
 
-static inline char to_lower(char c){ return (c>='A'&&c<='Z')? (char)(c+32): c; }
-static int streq(const char* a, const char* b){ while(*a && *b){ if(*a!=*b) return 0; ++a; ++b; } return *a==0 && *b==0; }
-static int startswith(const char* s,const char* p){ while(*p){ if(*s++!=*p++) return 0; } return 1; }
-
-static void list_cb(const char* name, int isDir){ console_write(isDir?"[D] ":"[F] "); console_writeln(name); }
+static void list_cb(const char* name, int isDir){ sh_write(isDir?"[D] ":"[F] "); sh_writeln(name); }
 
 // Forward declaration for recursive remove
 static int vfs_rm_recursive(const char* path);
@@ -36,85 +42,21 @@ static int vfs_rm_recursive(const char* path);
 // Forward decl for RM reboot path
 static void do_reboot_realmode(void);
 
-// Simple path resolver relative to CWD. Supports '.' and '..'.
-static void path_resolve(char* out, const char* cwd, const char* in){
-    // if absolute
-    if (in && *in=='/') {
-        int i=0; while(in[i]){ out[i]=in[i]; i++; } out[i]=0;
-    } else {
-        // start with cwd
-        int k=0; while(cwd[k]){ out[k]=cwd[k]; k++; }
-        if (k==0) out[k++]='/';
-        if (in && *in){ if (out[k-1]!='/') out[k++]='/'; int i=0; while(in[i]) out[k++]=in[i++]; }
-        out[k]=0;
-    }
-    // normalize: process segments, handling '.' and '..'
-    char tmp[128]; int ti=0; int i=0; // skip leading '/'
-    if (out[0]!='/'){ tmp[ti++]='/'; }
-    int depth=0; int segStart=1;
-    tmp[0]='/'; ti=1; depth=0; segStart=1;
-    while(out[i]){
-        // copy until next '/'
-        int j=i; while(out[j] && out[j]!='/') j++;
-        int segLen = j-i;
-        if (segLen==0) { i = j+1; continue; }
-        // check segment content
-        if (segLen==1 && out[i]=='.') {
-            // skip '.'
-        } else if (segLen==2 && out[i]=='.' && out[i+1]=='.') {
-            // pop last segment
-            if (ti>1){
-                // remove trailing '/'
-                if (tmp[ti-1]=='/' && ti>1) ti--;
-                // backtrack to previous '/'
-                while (ti>1 && tmp[ti-1]!='/') ti--;
-            }
-        } else {
-            if (tmp[ti-1] != '/') tmp[ti++]='/';
-            for (int k=0;k<segLen && ti<127;k++) tmp[ti++]=out[i+k];
-            tmp[ti]=0;
-        }
-        i = j;
-        if (out[i] == '/') i++;
-    }
-    if (ti>1 && tmp[ti-1]=='/') ti--; tmp[ti]=0;
-    // ensure not empty
-    if (ti==0){ tmp[ti++]='/'; tmp[ti]=0; }
-    // copy back
-    for (int k=0; tmp[k]; ++k) out[k]=tmp[k]; out[ti]=0;
-}
-
-static void u32_to_dec(uint32_t v, char* buf){ int n=0; if(v==0){ buf[n++]='0'; buf[n]=0; return; } char tmp[16]; int t=0; while(v){ tmp[t++] = (char)('0'+(v%10)); v/=10; } while(t--) buf[n++]=tmp[t]; buf[n]=0; }
-
 // History/input helpers
 static void input_set_line(char* line, int* plen, const char* src){
+    console_batch_begin();
     while(*plen > 0){ console_putc('\b'); (*plen)--; }
     int i=0; if (src){ while(src[i] && i < 255){ line[i]=src[i]; i++; } }
     line[i]=0; *plen=i; console_write(line);
+    console_batch_end();
 }
 
-#define HISTORY_MAX 16
-static char history_buf[HISTORY_MAX][256];
-static int history_head = 0;     // next insert position
-static int history_count = 0;    // number of valid entries (<= HISTORY_MAX)
 static int history_browse = -1;  // -1 = not browsing; 0=newest, 1=older, ...
-static char edit_saved[256];     // saved in-progress edit when starting browse
+static char edit_saved[HISTORY_LINE];   // saved in-progress edit when starting browse
 static int edit_saved_valid = 0;
 
-static const char* history_get_offset(int offset){
-    if (offset < 0 || offset >= history_count) return 0;
-    int idx = history_head - 1 - offset; if (idx < 0) idx += HISTORY_MAX;
-    return history_buf[idx];
-}
-
-static int str_eq(const char* a, const char* b){ int i=0; while(a && b && a[i] && b[i]){ if(a[i]!=b[i]) return 0; i++; } return a && b && a[i]==0 && b[i]==0; }
 static void str_copy(char* dst, const char* src, int cap){ int i=0; if(cap<=0) return; while(src && src[i] && i<cap-1){ dst[i]=src[i]; i++; } dst[i]=0; }
 
-// Parse decimal uint32 from token (null-terminated)
-static int parse_u32_dec(const char* s, uint32_t* out){ if(!s||!*s) return -1; uint32_t v=0; for(int i=0; s[i]; ++i){ char c=s[i]; if(c<'0'||c>'9') return -2; uint32_t d=(uint32_t)(c-'0'); uint32_t nv = v*10u + d; if (nv < v) return -3; v = nv; } *out=v; return 0; }
-// Parse hex byte from 1-2 hex digits
-static int parse_hex8(const char* s, uint8_t* out){ if(!s||!*s) return -1; uint32_t v=0; int i=0; for(; s[i] && i<2; ++i){ char c=s[i]; if(c>='0'&&c<='9') v = (v<<4) | (uint32_t)(c-'0'); else { char lc = (c>='A'&&c<='Z')?(c+32):c; if(lc>='a'&&lc<='f') v = (v<<4) | (uint32_t)(10 + lc-'a'); else return -2; } } if(s[i]) return -3; *out=(uint8_t)v; return 0; }
-
 // Short busy-wait
 static inline void io_wait_short(void){ for(volatile int i=0;i<10000;++i) __asm__ __volatile__("nop"); }
 
@@ -124,12 +66,12 @@ static void kbc_reset(void){
     for(volatile int i=0;i<100000;i++){
         if ((inb(0x64) & 0x02) == 0) break;
     }
-    serial_writeln("[sys] reset fallback: KBC 0x64");
+    serial_writeln("[sys] reset fallback: KBC 0x64"); serial_flush();
     outb(0x64, 0xFE);
 }
 
 static void triple_fault(void){
-    serial_writeln("[sys] reset fallback: triple fault");
+    serial_writeln("[sys] reset fallback: triple fault"); serial_flush();
     struct { uint16_t limit; uint32_t base; } __attribute__((packed)) idtr = {0, 0};
     __asm__ __volatile__("lidt %0" : : "m"(idtr));
     __asm__ __volatile__("int3");
@@ -139,7 +81,7 @@ static void triple_fault(void){
 // Cold reboot: warm vector, mask PIC, disable NMI, KBC reset with waits, then CF9 as fallback, finally HLT
 static void reboot_machine(void){
     __asm__ __volatile__("cli");
-    serial_writeln("[sys] reboot: real-mode BIOS int19");
+    serial_writeln("[sys] reboot: real-mode BIOS int19"); serial_flush();
     console_writeln("rebooting (BIOS)...");
     do_reboot_realmode();
     for(;;){ __asm__ __volatile__("hlt"); }
@@ -148,7 +90,7 @@ static void reboot_machine(void){
 // Fast restart: KBC + CF9 fallback
 static void restart_machine_fast(void){
     __asm__ __volatile__("cli");
-    serial_writeln("[sys] restart: KBC, fallback CF9");
+    serial_writeln("[sys] restart: KBC, fallback CF9"); serial_flush();
 
     // Mask PIC, disable NMI
     outb(0x21, 0xFF); outb(0xA1, 0xFF);
@@ -192,13 +134,52 @@ static void poweroff_machine(void){
     for(;;){ __asm__ __volatile__("hlt"); }
 }
 
-#ifdef DISK_MODE_HDD
-static void mbr_zero(uint8_t* m){ for(int i=0;i<512;++i) m[i]=0; m[510]=0x55; m[511]=0xAA; }
-static void mbr_set_entry(uint8_t* m, int idx, uint8_t boot, uint8_t type, uint32_t lba_start, uint32_t lba_count){ int o=446+idx*16; m[o+0]=boot; m[o+1]=0; m[o+2]=0; m[o+3]=0; m[o+4]=type; m[o+5]=0xFF; m[o+6]=0xFF; m[o+7]=0xFF; m[o+8]=(uint8_t)(lba_start&0xFF); m[o+9]=(uint8_t)((lba_start>>8)&0xFF); m[o+10]=(uint8_t)((lba_start>>16)&0xFF); m[o+11]=(uint8_t)((lba_start>>24)&0xFF); m[o+12]=(uint8_t)(lba_count&0xFF); m[o+13]=(uint8_t)((lba_count>>8)&0xFF); m[o+14]=(uint8_t)((lba_count>>16)&0xFF); m[o+15]=(uint8_t)((lba_count>>24)&0xFF); }
-static int mbr_read(uint8_t* m){ return ata_pio_read28(0,m); }
-static int mbr_write(const uint8_t* m){ return ata_pio_write28(0,m); }
-static void print_part(int idx, uint8_t boot, uint8_t type, uint32_t s, uint32_t c){ console_write("#"); char nb[4]; u32_to_dec((uint32_t)idx, nb); console_write(nb); console_write(" "); console_write(boot?"* ":"  "); console_write("type=0x"); char hx[3]; const char* hexd="0123456789ABCDEF"; hx[0]=hexd[(type>>4)&0xF]; hx[1]=hexd[type&0xF]; hx[2]=0; console_write(hx); console_write(" start="); char b1[16]; u32_to_dec(s,b1); console_write(b1); console_write(" count="); char b2[16]; u32_to_dec(c,b2); console_writeln(b2); }
-#endif
+static void print_render_stats(void){
+    const render_stats_t* rs = render_stats(); char b[16];
+    sh_write("render ok: "); u32_to_dec(rs->dom.elements + rs->dom.texts, b); sh_write(b);
+    sh_write(" nodes ("); u32_to_dec(rs->dom.elements, b); sh_write(b);
+    sh_write(" elem, "); u32_to_dec(rs->dom.texts, b); sh_write(b);
+    sh_write(" text, "); u32_to_dec(rs->dom.attrs, b); sh_write(b);
+    sh_write(" attr), "); u32_to_dec(rs->dom.strings, b); sh_write(b);
+    sh_write(" strings ("); u32_to_dec(rs->dom.intern_hits, b); sh_write(b);
+    sh_write(" reused), "); u32_to_dec(rs->lines, b); sh_write(b);
+    sh_writeln(" lines");
+    sh_write(rs->cached ? "  layout cached; built from " : "  ");
+    u32_to_dec(rs->dom.bytes_in, b); sh_write(b);
+    sh_write(" bytes: parse "); u32_to_dec(rs->parse_us, b); sh_write(b);
+    sh_write(" us, layout "); u32_to_dec(rs->layout_us, b); sh_write(b);
+    sh_write(" us; blit "); u32_to_dec(rs->blit_us, b); sh_write(b);
+    sh_writeln(rs->truncated ? " us (arena FULL, truncated)" : " us");
+    if (rs->script.scripts){
+        sh_write("  scripts "); u32_to_dec(rs->script.scripts, b); sh_write(b);
+        sh_write(": "); u32_to_dec(rs->script.code_bytes, b); sh_write(b);
+        sh_write(" bytes of code, "); u32_to_dec(rs->script.insns, b); sh_write(b);
+        sh_write(" insns, "); u32_to_dec(rs->script.errors, b); sh_write(b);
+        sh_writeln(" errors");
+    }
+    if (rs->css.lookups){
+        sh_write("  styles: "); u32_to_dec(rs->css.rules, b); sh_write(b);
+        sh_write(" rules, "); u32_to_dec(rs->css.hits, b); sh_write(b);
+        sh_write("/"); u32_to_dec(rs->css.lookups, b); sh_write(b);
+        sh_writeln(" cache hits");
+    }
+}
+
+// Block until a key arrives, running deferred work while idle. A key
+// decoded at IRQ exit since keyboard_getchar, or work queued, skips the
+// hlt; sti;hlt is atomic, so an IRQ after the check still wakes us
+static int idle_wait_char(void){
+    console_sync();   // a batched command waiting for input shows its output
+    for (;;) {
+        int ch = keyboard_getchar();
+        if (ch != -1) return ch;
+        if (!work_run_worker()) {
+            __asm__ __volatile__("cli");
+            if (keyboard_has_char() || work_pending()) __asm__ __volatile__("sti");
+            else __asm__ __volatile__("sti; hlt");
+        }
+    }
+}
 
 // Helper state for directory listing during recursive delete
 static int g_ls_found = 0;
@@ -241,53 +222,379 @@ static int vfs_rm_recursive(const char* path){
     return vfs_rm(path);
 }
 
-void kernel_main() {
-    serial_init();
-    serial_writeln("[foxos] serial online");
+// ---- shell commands ----
+
+// Test script state (auto-injected commands when 'test' is entered)
+#ifdef DISK_MODE_HDD
+static const char* test_script[] = {
+    "clear","ls","mkdir /test","echo hello > /test/hello.txt","ls /test","cat /test/hello.txt","stat /test","disk info","disk list"
+};
+#else
+static const char* test_script[] = {
+    "clear","ls","mkdir /test","echo hello > /test/hello.txt","ls /test","cat /test/hello.txt","stat /test"
+};
+#endif
+static int test_mode = 0, test_index = 0;
+static const int test_count = (int)(sizeof(test_script)/sizeof(test_script[0]));
 
+static int usage(const char* u){ console_write("usage: "); console_writeln(u); return -1; }
+
+static int cmd_help(int argc, char** argv){
+    (void)argc; (void)argv; shell_help();
+    sh_writeln("  cmd | cmd, > >> <    - pipe output, redirect to/from a file");
+    sh_writeln("  Shift+PgUp/PgDn      - page through scrollback");
+    return 0;
+}
+static int cmd_clear(int argc, char** argv){ (void)argc; (void)argv; console_clear(); return 0; }
+static int cmd_test(int argc, char** argv){ (void)argc; (void)argv; sh_writeln("test: starting"); test_mode = 1; test_index = 0; return 0; }
+static int cmd_pwd(int argc, char** argv){ (void)argc; (void)argv; sh_writeln(shell_cwd()); return 0; }
+
+static int cmd_ls(int argc, char** argv){
+    char path[SHELL_PATH_MAX]; shell_path(path, argc > 1 ? argv[1] : 0);
+    return vfs_ls(path, list_cb);
+}
+
+static int cmd_cd(int argc, char** argv){
+    if (argc != 2) return usage("cd <dir>");
+    if (shell_chdir(argv[1]) != 0) { console_writeln("cd: no such dir"); return -1; }
+    sh_writeln("ok");
+    return 0;
+}
+
+static int cmd_cat(int argc, char** argv){
+    if (argc != 2) return usage("cat <path>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]); vfs_stat_t st;
+    if (vfs_stat(path, &st)!=0 || st.isDir) { console_writeln("cat: not found"); return -1; }
+    char buf[512]; uint32_t off=0, n=0; char last='\n';
+    while (vfs_read_at(path, off, buf, sizeof(buf), &n)==0 && n){ sh_write_n(buf, (int)n); last = buf[n-1]; off += n; }
+    if (last != '\n') sh_putc('\n');
+    return 0;
+}
+
+static int cmd_touch(int argc, char** argv){
+    if (argc != 2) return usage("touch <path>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]); uint32_t out=0;
+    if (vfs_read(path, 0, 0, &out)!=0 && vfs_write(path, "", 0)!=0) { console_writeln("touch failed"); return -1; }
+    sh_writeln("ok");
+    return 0;
+}
+
+// cp/mv <src> <dst> (files only), streamed a block at a time
+static int copy_file(int argc, char** argv, int move){
+    if (argc != 3) return usage(move ? "mv <src> <dst>" : "cp <src> <dst>");
+    char sp[SHELL_PATH_MAX], dp[SHELL_PATH_MAX]; shell_path(sp, argv[1]); shell_path(dp, argv[2]);
+    char buf[512]; uint32_t off=0, n=0; vfs_stat_t st;
+    if (vfs_stat(sp, &st)!=0 || st.isDir) { console_writeln(move ? "mv: read failed" : "cp: read failed"); return -1; }
+    if (vfs_write(dp, "", 0)!=0) { console_writeln(move ? "mv: write failed" : "cp: write failed"); return -1; }
+    while (vfs_read_at(sp, off, buf, sizeof(buf), &n)==0 && n){
+        if (vfs_append(dp, buf, n)!=0) { console_writeln(move ? "mv: write failed" : "cp: write failed"); return -1; }
+        off += n;
+    }
+    if (move && vfs_rm(sp)!=0) { console_writeln("mv: remove src failed"); return -1; }
+    sh_writeln("ok");
+    return 0;
+}
+static int cmd_cp(int argc, char** argv){ return copy_file(argc, argv, 0); }
+static int cmd_mv(int argc, char** argv){ return copy_file(argc, argv, 1); }
+
+static int cmd_echo(int argc, char** argv){
+    for (int i = 1; i < argc; ++i){ if (i > 1) sh_putc(' '); sh_write(argv[i]); }
+    sh_putc('\n');
+    return 0;
+}
+
+// ---- filters: fed the previous stage's output (or a '<' file) in chunks ----
+
+// cat with no file: pass input through
+static void cat_feed(void* st, const char* d, int n){ (void)st; sh_write_n(d, n); }
+static const shell_filter_t cat_filter = { 0, cat_feed, 0 };
+
+typedef struct { uint32_t lines, words, bytes; int in_word; } count_st;
+static void count_feed(void* st, const char* d, int n){
+    count_st* c = (count_st*)st;
+    c->bytes += (uint32_t)n;
+    for (int i = 0; i < n; ++i){
+        int sp = d[i] == ' ' || d[i] == '\t' || d[i] == '\n' || d[i] == '\r';
+        if (d[i] == '\n') c->lines++;
+        if (!sp && !c->in_word) c->words++;
+        c->in_word = !sp;
+    }
+}
+static void count_end(void* st){
+    count_st* c = (count_st*)st; char b[16];
+    u32_to_dec(c->lines, b); sh_write(b); sh_write(" lines, ");
+    u32_to_dec(c->words, b); sh_write(b); sh_write(" words, ");
+    u32_to_dec(c->bytes, b); sh_write(b); sh_writeln(" bytes");
+}
+static const shell_filter_t count_filter = { 0, count_feed, count_end };
+
+// Lines longer than the buffer are matched and printed by their prefix
+#define GREP_LINE 232
+typedef struct { const char* pat; int n, lost; char line[GREP_LINE]; } grep_st;
+static int grep_begin(void* st, int argc, char** argv){
+    if (argc != 2) return usage("grep PATTERN");
+    ((grep_st*)st)->pat = argv[1];
+    return 0;
+}
+static void grep_line(grep_st* g){
+    for (int i = 0; i <= g->n; ++i){
+        int k = 0; while (g->pat[k] && i + k < g->n && g->line[i+k] == g->pat[k]) k++;
+        if (!g->pat[k]) { sh_write_n(g->line, g->n); sh_putc('\n'); break; }
+    }
+    g->n = 0; g->lost = 0;
+}
+static void grep_feed(void* st, const char* d, int n){
+    grep_st* g = (grep_st*)st;
+    for (int i = 0; i < n; ++i){
+        if (d[i] == '\n') grep_line(g);
+        else if (g->n < GREP_LINE) g->line[g->n++] = d[i];
+        else g->lost = 1;
+    }
+}
+static void grep_end(void* st){ grep_st* g = (grep_st*)st; if (g->n || g->lost) grep_line(g); }
+static const shell_filter_t grep_filter = { grep_begin, grep_feed, grep_end };
+
+typedef struct { uint32_t left; } head_st;
+static int head_begin(void* st, int argc, char** argv){
+    head_st* h = (head_st*)st; h->left = 10;
+    if (argc > 2 || (argc == 2 && parse_u32_dec(argv[1], &h->left) != 0)) return usage("head [N]");
+    return 0;
+}
+static void head_feed(void* st, const char* d, int n){
+    head_st* h = (head_st*)st; int i = 0;
+    while (i < n && h->left) if (d[i++] == '\n') h->left--;
+    sh_write_n(d, i);
+}
+static const shell_filter_t head_filter = { head_begin, head_feed, 0 };
+
+static int cmd_run(int argc, char** argv){
+    if (argc != 2) return usage("run <script>");
+    int r = shell_run_file(argv[1]);
+    if (r == -1) { console_writeln("run: not found"); return -1; }
+    if (r > 0) { char b[16]; u32_to_dec((uint32_t)r, b); console_write("run: "); console_write(b); console_writeln(" command(s) failed"); return -1; }
+    return r;
+}
+
+static int cmd_mkdir(int argc, char** argv){
+    if (argc != 2) return usage("mkdir <dir>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]);
+    if (vfs_mkdir(path)!=0) { console_writeln("mkdir failed"); return -1; }
+    sh_writeln("ok");
+    return 0;
+}
+
+static int cmd_rm(int argc, char** argv){
+    int rec = argc == 3 && shell_streq(argv[1], "-r");
+    if (argc != 2 && !rec) return usage("rm [-r] <path>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[argc-1]);
+    int r = rec ? vfs_rm_recursive(path) : vfs_rm(path);
+    if (r != 0) { console_writeln(rec ? "rm -r failed" : shell_streq(argv[0], "rmdir") ? "rmdir failed" : "rm failed"); return -1; }
+    sh_writeln("ok");
+    return 0;
+}
+
+static int cmd_stat(int argc, char** argv){
+    if (argc != 2) return usage("stat <path>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]); vfs_stat_t st;
+    if (vfs_stat(path,&st)!=0) { console_writeln("stat: not found"); return -1; }
+    char buf[16];
+    sh_write("type: "); sh_writeln(st.isDir?"dir":"file");
+    if(!st.isDir){ sh_write("size: "); u32_to_dec(st.size, buf); sh_writeln(buf);}
+    else { sh_write("children: "); u32_to_dec(st.children, buf); sh_writeln(buf);}
+    return 0;
+}
+
+#ifdef DISK_MODE_FLOPPY
+static int cmd_disk(int argc, char** argv){
+    (void)argv;
+    if (argc > 1) { console_writeln("not supported in floppy mode"); return -1; }
+    sh_writeln("disk: superfloppy 1.44MB, 512-byte sectors, 2880 sectors, no partition table");
+    return 0;
+}
+#endif
+
+static int cmd_render(int argc, char** argv){
+    if (argc != 2) return usage("render <file>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]);
+    if (render_file(path)!=0) { console_writeln("render failed"); return -1; }
+    render_close(); print_render_stats();
+    return 0;
+}
+
+// Pager over the cached layout: arrows/PgUp/PgDn scroll, q quits
+static int cmd_view(int argc, char** argv){
+    if (argc != 2) return usage("view <file>");
+    char path[SHELL_PATH_MAX]; shell_path(path, argv[1]);
+    if (render_file(path)!=0) { console_writeln("view failed"); return -1; }
+    for (;;) {
+        int k = idle_wait_char();
+        if (k == 'q' || k == 'Q') break;
+        if (k == KBD_KEY_UP) render_scroll(-1);
+        else if (k == KBD_KEY_DOWN) render_scroll(1);
+        else if (k == KBD_KEY_PGUP || k == KBD_KEY_SHIFT_PGUP) render_scroll(-(CONSOLE_ROWS - 7));
+        else if (k == KBD_KEY_PGDN || k == KBD_KEY_SHIFT_PGDN) render_scroll(CONSOLE_ROWS - 7);
+    }
+    render_close();
+    console_clear();
+    print_render_stats();
+    return 0;
+}
+
+static int cmd_fb(int argc, char** argv){
+    if (argc != 2 || !shell_streq(argv[1], "bench")) return usage("fb bench");
+    // Both benches draw into the back buffer, which exists only with an LFB
+    if (!g_fb.present){ console_writeln("fb bench: no framebuffer"); return -1; }
+    int bw = g_fb.width, bh = g_fb.height;
+    static const int fmts[3] = { 16, 24, 32 };
+    char b[16];
+    for (int f=0; f<3; ++f){
+        fb_bench_t r;
+        if (fb_bench(fmts[f], &r) != 0) continue;
+        u32_to_dec((uint32_t)fmts[f], b); sh_write(b); sh_write("bpp: clear ");
+        u32_to_dec(r.clear_cycles, b); sh_write(b); sh_write(" cyc ");
+        u32_to_dec(r.clear_px_per_sec / 1000000u, b); sh_write(b); sh_write(" Mpx/s, rect16 ");
+        u32_to_dec(r.rect_cycles, b); sh_write(b); sh_write(" cyc ");
+        u32_to_dec(r.rect_px_per_sec / 1000000u, b); sh_write(b); sh_writeln(" Mpx/s");
+    }
+    // Full-screen premultiplied ARGB blend; one 60 Hz frame is 16667 us
+    for (int f=0; f<3; ++f){
+        for (int simd=1; simd>=0; --simd){
+            uint32_t cyc;
+            if (surf_bench_alpha(fmts[f], simd, bw, bh, &cyc) != 0) continue;
+            sh_write("alpha "); u32_to_dec((uint32_t)fmts[f], b); sh_write(b);
+            sh_write(simd ? "bpp sse2: " : "bpp scalar: ");
+            u32_to_dec(cyc, b); sh_write(b); sh_write(" cyc/frame, ");
+            u32_to_dec((uint32_t)tsc_to_us(cyc), b); sh_write(b); sh_writeln(" us");
+        }
+    }
+    // The bench scribbled over the back buffer; recompose it
+    wm_damage_screen(0, 0, g_fb.width, g_fb.height); wm_render();
+    return 0;
+}
+
+static int cmd_reboot(int argc, char** argv){
+    (void)argc; (void)argv;
+    serial_writeln("[sys] reboot requested");
+    console_writeln("rebooting..."); console_flush(); serial_flush();
+    reboot_machine();
+    return 0;
+}
+
+static int cmd_restart(int argc, char** argv){
+    (void)argc; (void)argv;
+    serial_writeln("[sys] restart requested (BIOS)");
+    console_writeln("restarting (BIOS)..."); console_flush(); serial_flush();
+    do_reboot_realmode();
+    return 0;
+}
+
+static int cmd_shutdown(int argc, char** argv){
+    (void)argc; (void)argv;
+    serial_writeln("[sys] shutdown requested");
+    console_writeln("powering off..."); console_flush(); serial_flush();
+    poweroff_machine();
+    return 0;
+}
+
+static const shell_cmd_t core_cmds[] = {
+    { "help",     cmd_help,     0, "show this help", 0 },
+    { "clear",    cmd_clear,    0, "clear screen", 0 },
+    { "reboot",   cmd_reboot,   0, "reboot the machine", 0 },
+    { "restart",  cmd_restart,  0, "reboot via BIOS int19", 0 },
+    { "shutdown", cmd_shutdown, 0, "power off the machine", 0 },
+    { "poweroff", cmd_shutdown, 0, "same as shutdown", 0 },
+    { "test",     cmd_test,     0, "run scripted demo", 0 },
+    { "run",      cmd_run,      "run <script>", "run a file of commands", 0 },
+    { "ls",       cmd_ls,       "ls [path]", "list directory", 0 },
+    { "pwd",      cmd_pwd,      0, "print working dir", 0 },
+    { "cd",       cmd_cd,       "cd <dir>", "change directory (.. goes up)", 0 },
+    { "cat",      cmd_cat,      "cat <path>\n... | cat", "print file\npass input through", &cat_filter },
+    { "touch",    cmd_touch,    "touch <path>", "create empty file", 0 },
+    { "cp",       cmd_cp,       "cp <src> <dst>", "copy file", 0 },
+    { "mv",       cmd_mv,       "mv <src> <dst>", "move/rename file", 0 },
+    { "echo",     cmd_echo,     "echo TEXT", "print TEXT", 0 },
+    { "mkdir",    cmd_mkdir,    "mkdir <dir>", "create directory", 0 },
+    { "rm",       cmd_rm,       "rm <path>\nrm -r <path>", "remove file\nrecursive remove", 0 },
+    { "rmdir",    cmd_rm,       "rmdir <path>", "remove directory", 0 },
+    { "stat",     cmd_stat,     "stat <path>", "show file/dir info", 0 },
+#ifdef DISK_MODE_FLOPPY
+    { "disk",     cmd_disk,     0, "show floppy info", 0 },
+#endif
+    { "render",   cmd_render,   "render <file>", "render tiny SAM file (HTML-like)", 0 },
+    { "view",     cmd_view,     "view <file>", "render and page it (arrows, PgUp/PgDn, q)", 0 },
+    { "count",    0,            "... | count", "count lines, words and bytes", &count_filter },
+    { "grep",     0,            "... | grep PATTERN", "lines containing PATTERN", &grep_filter },
+    { "head",     0,            "... | head [N]", "first N lines (10)", &head_filter },
+    { "fb",       cmd_fb,       "fb bench", "fill/alpha kernels per bpp", 0 },
+};
+
+void kernel_main() {
+    bootprof_init();
+    for (unsigned i=0; i<sizeof(core_cmds)/sizeof(core_cmds[0]); ++i) shell_register(&core_cmds[i]);
+    bootprof_begin("klog"); klog_init(); bootprof_end();
+    bootprof_begin("serial"); serial_init(); bootprof_end();
+    klog(KLOG_INFO, KLOG_SERIAL, "serial online");
+    bootprof_begin("tsc"); tsc_init(); bootprof_end();
+    bootprof_begin("cpu"); cpu_init(); bootprof_end();
+    klog(KLOG_INFO, KLOG_KERN, cpu_has_sse2() ? "cpu: SSE2 enabled" : "cpu: no SSE2, scalar paths only");
+
+    bootprof_begin("console");
     console_init();
+#ifdef HEADLESS_BOOT
+    // Unattended: COM1 carries the console; the serial log sink would only
+    // repeat what the console sink prints
+    console_set_mirror(serial_putc_wait);
+    klog_set_sink_levels(KLOG_WARN, -1);
+#endif
     console_set_color(0x0F, 0x00);
     console_writeln("foxos console ready");
-    serial_writeln("[foxos] console ready");
-
-    mem_init();
-    serial_writeln("[foxos] memory init done");
-
-    vfs_init();
-    vfs_mount_ramfs();
-    initrd_load_into_ramfs();
+    bootprof_end();
+    klog(KLOG_INFO, KLOG_KERN, "console ready");
+
+    bootprof_begin("mem"); mem_init(); bootprof_end();
+    klog(KLOG_INFO, KLOG_MEM, "memory init done");
+    bootprof_begin("scrollback");
+    if (console_scrollback_init(CONSOLE_SCROLLBACK_LINES, CONSOLE_SCROLLBACK_BYTES) != 0)
+        klog(KLOG_WARN, KLOG_KERN, "console scrollback unavailable");
+    bootprof_end();
+
+    bootprof_begin("vfs"); vfs_init(); vfs_mount_ramfs(); bootprof_end();
+    bootprof_begin("initrd"); initrd_load_into_ramfs(); bootprof_end();
     console_writeln("vfs: ramfs mounted, initrd loaded");
-    serial_writeln("[foxos] vfs/initrd ready");
+    klog(KLOG_INFO, KLOG_VFS, "vfs/initrd ready");
 
 #ifdef DISK_MODE_HDD
-    ata_init();
-    serial_writeln("[foxos] ata init done");
+    bootprof_begin("ata"); ata_init(); bootprof_end();
+    klog(KLOG_INFO, KLOG_ATA, "ata init done");
 #endif
 
 #ifdef ENABLE_GUI
-    gui_init();
+    bootprof_begin("gui"); gui_init(); bootprof_end();
 #else
-    // gui_init();
+    gui_init();     // registers a `gui` that reports the GUI is disabled
 #endif
 
-    keyboard_init();
-    serial_writeln("[foxos] keyboard ready");
+    bench_init();
 
-    char cwd[128]; cwd[0] = '/'; cwd[1] = 0;
-    char line[256]; int len = 0;
-    history_head = 0; history_count = 0; history_browse = -1; edit_saved_valid = 0; edit_saved[0]=0;
+    bootprof_begin("keyboard"); keyboard_init(); bootprof_end();
+    klog(KLOG_INFO, KLOG_KBD, "keyboard ready");
 
-    // Test script state (auto-injected commands when 'test' is entered)
-#ifdef DISK_MODE_HDD
-    static const char* test_script[] = {
-        "clear","ls","mkdir /test","echo hello > /test/hello.txt","ls /test","cat /test/hello.txt","stat /test","disk info","disk list"
-    };
-#else
-    static const char* test_script[] = {
-        "clear","ls","mkdir /test","echo hello > /test/hello.txt","ls /test","cat /test/hello.txt","stat /test"
-    };
+    bootprof_begin("irq");
+    idt_init();
+    keyboard_enable_irq();
+    serial_enable_irq();
+    bootprof_end();
+    klog(KLOG_INFO, KLOG_IRQ, "interrupts on, keyboard on IRQ1, COM1 TX on IRQ4");
+    bootprof_done();
+
+#ifdef HEADLESS_BOOT
+    console_batch_begin();
+    if (shell_run_file("/init/rc") == -1) console_writeln("headless: no /init/rc");
+    console_batch_end();
 #endif
-    int test_mode = 0; int test_index = 0; const int test_count = (int)(sizeof(test_script)/sizeof(test_script[0]));
+
+    char line[SHELL_LINE_MAX]; int len = 0;
+    history_reset(); history_browse = -1; edit_saved_valid = 0; edit_saved[0]=0;
 
     console_write("foxos> ");
 
@@ -300,21 +607,24 @@ void kernel_main() {
             ch = '\n';
             if (test_index >= test_count) test_mode = 0;
         } else {
-            ch = keyboard_getchar();
-            if (ch == -1) { for (int i=0;i<1000;++i) io_wait(); continue; }
+            ch = idle_wait_char();
         }
 
+        // Scrollback paging redraws from the ring; the command line is untouched
+        if (ch == KBD_KEY_SHIFT_PGUP) { console_scroll_view(CONSOLE_ROWS - 1); continue; }
+        if (ch == KBD_KEY_SHIFT_PGDN) { console_scroll_view(-(CONSOLE_ROWS - 1)); continue; }
+
         // History navigation first
         if (ch == KBD_KEY_UP) {
-            if (history_count == 0) continue;
+            if (history_count() == 0) continue;
             if (history_browse == -1){
                 // entering browse: save current edit
                 str_copy(edit_saved, line, sizeof(edit_saved)); edit_saved_valid = 1;
                 history_browse = 0;
-            } else if (history_browse < history_count - 1) {
+            } else if (history_browse < history_count() - 1) {
                 history_browse++;
             }
-            const char* src = history_get_offset(history_browse);
+            const char* src = history_get(history_browse);
             if (src) input_set_line(line, &len, src);
             continue;
         } else if (ch == KBD_KEY_DOWN) {
@@ -325,238 +635,27 @@ void kernel_main() {
                 if (edit_saved_valid) input_set_line(line, &len, edit_saved); else input_set_line(line, &len, "");
             } else {
                 history_browse--;
-                const char* src = history_get_offset(history_browse);
+                const char* src = history_get(history_browse);
                 if (src) input_set_line(line, &len, src);
             }
             continue;
         }
 
         if (ch == '\n') {
+            // Command output is batched: it reaches VGA memory at the prompt,
+            // every CONSOLE_BATCH_MS of output, or when the command waits for a key
+            console_batch_begin();
             console_putc('\n');
             line[len] = '\0';
-            serial_write("[cmd] "); serial_writeln(line);
-            // commit history (before we mutate case)
-            if (len > 0) {
-                // avoid consecutive duplicate
-                int last_idx = (history_head - 1 + HISTORY_MAX) % HISTORY_MAX;
-                if (!(history_count > 0 && str_eq(history_buf[last_idx], line))) {
-                    str_copy(history_buf[history_head], line, sizeof(history_buf[history_head]));
-                    history_head = (history_head + 1) % HISTORY_MAX;
-                    if (history_count < HISTORY_MAX) history_count++;
-                }
-            }
+            klog(KLOG_INFO, KLOG_SHELL, line);
+            history_add(line);   // before shell_exec tokenizes it in place
             // reset browsing state after execution
             history_browse = -1; edit_saved_valid = 0; edit_saved[0]=0;
 
-            // lowercase command keyword only
-            int i=0; while(line[i] && line[i]!=' '){ line[i]=to_lower(line[i]); i++; }
-
-            if (streq(line, "clear")) {
-                console_clear();
-            } else if (streq(line, "help")) {
-                console_writeln("commands:");
-                console_writeln("  help                 - show this help");
-                console_writeln("  clear                - clear screen");
-                console_writeln("  reboot               - reboot the machine");
-                console_writeln("  restart              - reboot (fast, CF9)");
-                console_writeln("  shutdown             - power off the machine");
-                console_writeln("  test                 - run scripted demo");
-                console_writeln("  ls [path]            - list directory");
-                console_writeln("  pwd                  - print working dir");
-                console_writeln("  cd <dir>             - change directory");
-                console_writeln("  cd ..                - go up one level");
-                console_writeln("  cat <path>           - print file");
-                console_writeln("  touch <path>         - create empty file");
-                console_writeln("  cp <src> <dst>       - copy file (<=1024B)");
-                console_writeln("  mv <src> <dst>       - move/rename file");
-                console_writeln("  echo TEXT > PATH     - write file");
-                console_writeln("  echo TEXT >> PATH    - append to file");
-                console_writeln("  mkdir <dir>          - create directory");
-                console_writeln("  rm <path>            - remove file");
-                console_writeln("  rmdir <path>         - remove directory");
-                console_writeln("  rm -r <path>         - recursive remove");
-                console_writeln("  stat <path>          - show file/dir info");
-                console_writeln("  render <file>        - render tiny SAM file (HTML-like)");
-#ifdef DISK_MODE_FLOPPY
-                console_writeln("  disk                 - show floppy info");
-#else
-                console_writeln("  disk info            - show disk mode/size/sectors");
-                console_writeln("  disk list            - list MBR partitions");
-                console_writeln("  disk mkpt N          - create N primary partitions");
-                console_writeln("  disk mkpart i s c t  - set entry i=start,count,typeHex");
-                console_writeln("  disk clear           - zero the MBR (keep 0x55AA)");
-#endif
-            } else if (streq(line, "test")) {
-                console_writeln("test: starting");
-                test_mode = 1;
-                test_index = 0;
-            } else if (streq(line, "ls")) {
-                vfs_ls(cwd, list_cb);
-            } else if (startswith(line, "ls ")) {
-                char path[128]; path_resolve(path, cwd, line+3); vfs_ls(path, list_cb);
-            } else if (streq(line, "pwd")) {
-                console_writeln(cwd);
-            } else if (streq(line, "cd ..")) {
-                // go to parent
-                int L=0; while(cwd[L]) L++; if (L>1){ // remove trailing segment
-                    if (cwd[L-1]=='/' && L>1) L--; // remove trailing /
-                    while(L>1 && cwd[L-1]!='/') L--; if (L>1 && cwd[L-1]=='/') L--; if (L==0) { cwd[0]='/'; cwd[1]=0; } else { cwd[L+1]=0; cwd[L+1]=0; }
-                    // rebuild properly
-                    if (L<=1){ cwd[0]='/'; cwd[1]=0; } else { cwd[L+1]=0; }
-                }
-                console_writeln("ok");
-            } else if (startswith(line, "cd ")) {
-                char path[128]; path_resolve(path, cwd, line+3); vfs_stat_t st; if (vfs_stat(path,&st)==0 && st.isDir){ int j=0; while(path[j]){ cwd[j]=path[j]; j++; } cwd[j]=0; console_writeln("ok"); } else { console_writeln("cd: no such dir"); }
-            } else if (startswith(line, "cat ")) {
-                char path[128]; path_resolve(path, cwd, line+4); char buf[256]; uint32_t out=0; if (vfs_read(path, buf, sizeof(buf)-1, &out)==0){ buf[out]=0; console_writeln(buf);} else { console_writeln("cat: not found"); }
-            } else if (startswith(line, "touch ")) {
-                char path[128]; path_resolve(path, cwd, line+6); uint32_t out=0; if (vfs_read(path, 0, 0, &out)==0) { console_writeln("ok"); } else { if (vfs_write(path, "", 0)==0) console_writeln("ok"); else console_writeln("touch failed"); }
-            } else if (startswith(line, "cp ")) {
-                // cp <src> <dst> (files only, up to 1024 bytes)
-                char* p = line+3; while(*p==' ') p++; char* src = p; while(*p && *p!=' ') p++; if(!*p){ console_writeln("usage: cp <src> <dst>"); }
-                else { *p=0; char* dst = p+1; char sp[128], dp[128]; path_resolve(sp,cwd,src); path_resolve(dp,cwd,dst); char buf[1024]; uint32_t n=0; if (vfs_read(sp, buf, sizeof(buf), &n)==0){ if (vfs_write(dp, buf, n)==0) console_writeln("ok"); else console_writeln("cp: write failed"); } else console_writeln("cp: read failed"); }
-            } else if (startswith(line, "mv ")) {
-                // mv <src> <dst> (files only, up to 1024 bytes)
-                char* p = line+3; while(*p==' ') p++; char* src = p; while(*p && *p!=' ') p++; if(!*p){ console_writeln("usage: mv <src> <dst>"); }
-                else { *p=0; char* dst = p+1; char sp[128], dp[128]; path_resolve(sp,cwd,src); path_resolve(dp,cwd,dst); char buf[1024]; uint32_t n=0; if (vfs_read(sp, buf, sizeof(buf), &n)==0){ if (vfs_write(dp, buf, n)==0){ if (vfs_rm(sp)==0) console_writeln("ok"); else console_writeln("mv: remove src failed"); } else console_writeln("mv: write failed"); } else console_writeln("mv: read failed"); }
-            } else if (startswith(line, "echo ")) {
-                // echo text > /path  OR  echo text >> /path (append)
-                char* p = line+5; // after space
-                char* gt = p; while(*gt && *gt!='>') gt++;
-                if (*gt=='>') {
-                    if (gt[1]=='>' && gt[2]==' ') {
-                        *gt = 0; // terminate text
-                        char path_in[128]; char* path = gt+3; path_resolve(path_in, cwd, path);
-                        // append: read existing (up to 1024), then write concatenation
-                        char buf[1024]; uint32_t n=0; if (vfs_read(path_in, buf, sizeof(buf), &n)!=0) n=0; // if not exist, treat as empty
-                        uint32_t tlen=0; while(p[tlen]) tlen++;
-                        if (n + tlen > sizeof(buf)) { console_writeln("append too large"); }
-                        else { for (uint32_t k=0;k<tlen;++k) buf[n+k]=p[k]; if (vfs_write(path_in, buf, n+tlen)==0) console_writeln("ok"); else console_writeln("write failed"); }
-                    } else if (gt[1]==' ') {
-                        *gt = 0; char path_in[128]; char* path = gt+2; path_resolve(path_in, cwd, path); uint32_t l=0; while(p[l]) l++; if (vfs_write(path_in,p,l)==0) console_writeln("ok"); else console_writeln("write failed");
-                    } else {
-                        console_writeln("usage: echo TEXT > /path | echo TEXT >> /path");
-                    }
-                } else {
-                    console_writeln(p);
-                }
-            } else if (startswith(line, "mkdir ")) {
-                char path[128]; path_resolve(path, cwd, line+6); if (vfs_mkdir(path)==0) console_writeln("ok"); else console_writeln("mkdir failed");
-            } else if (startswith(line, "rm -r ")) {
-                char path[128]; path_resolve(path, cwd, line+6); if (vfs_rm_recursive(path)==0) console_writeln("ok"); else console_writeln("rm -r failed");
-            } else if (startswith(line, "rm ")) {
-                char path[128]; path_resolve(path, cwd, line+3); if (vfs_rm(path)==0) console_writeln("ok"); else console_writeln("rm failed");
-            } else if (startswith(line, "rmdir ")) {
-                char path[128]; path_resolve(path, cwd, line+6); if (vfs_rm(path)==0) console_writeln("ok"); else console_writeln("rmdir failed");
-            } else if (startswith(line, "stat ")) {
-                char path[128]; path_resolve(path, cwd, line+5); vfs_stat_t st; if (vfs_stat(path,&st)==0){
-                    console_write("type: "); console_writeln(st.isDir?"dir":"file");
-                    if(!st.isDir){ console_write("size: "); char buf[16]; u32_to_dec(st.size, buf); console_writeln(buf);} else { console_write("children: "); char buf[16]; u32_to_dec(st.children, buf); console_writeln(buf);} }
-                else { console_writeln("stat: not found"); }
-            } else if (streq(line, "disk")) {
-#ifdef DISK_MODE_FLOPPY
-                console_writeln("disk: superfloppy 1.44MB, 512-byte sectors, 2880 sectors, no partition table");
-#else
-#ifdef DISK_SIZE_MB
-                console_write("disk: hdd ");
-                char num[16]; int n=0; uint32_t mb=DISK_SIZE_MB; char tmp[16]; if(mb==0){ num[n++]='0'; } else { int t=0; while(mb){ tmp[t++]=(char)('0'+(mb%10)); mb/=10; } while(t--) num[n++]=tmp[t]; } num[n]=0;
-                console_write(num); console_writeln("MB, 512-byte sectors");
-#else
-                console_writeln("disk: hdd, 512-byte sectors");
-#endif
-#endif
-            } else if (startswith(line, "disk ")) {
-                char* p = line+5; while(*p==' ') p++;
-#ifdef DISK_MODE_FLOPPY
-                console_writeln("not supported in floppy mode");
-#else
-                if (streq(p, "info")) {
-                    console_writeln("mode: hdd");
-#ifdef DISK_SIZE_MB
-                    console_write("size: "); char b[16]; u32_to_dec(DISK_SIZE_MB, b); console_write(b); console_writeln(" MB");
-#endif
-                    console_write("sectors: "); char b2[16]; u32_to_dec(DISK_SECTORS, b2); console_writeln(b2);
-                } else if (streq(p, "list")) {
-                    uint8_t m[512]; if (ata_available() && mbr_read(m)==0){ if (m[510]!=0x55||m[511]!=0xAA){ console_writeln("no MBR signature"); } else { for(int i=0;i<4;++i){ int o=446+i*16; uint8_t boot=m[o+0]; uint8_t type=m[o+4]; uint32_t s = (uint32_t)m[o+8] | ((uint32_t)m[o+9]<<8) | ((uint32_t)m[o+10]<<16) | ((uint32_t)m[o+11]<<24); uint32_t c = (uint32_t)m[o+12] | ((uint32_t)m[o+13]<<8) | ((uint32_t)m[o+14]<<16) | ((uint32_t)m[o+15]<<24); if(type!=0){ print_part(i,boot,type,s,c);} } } } else console_writeln("ata: no drive");
-                } else if (startswith(p, "mkpt ")) {
-                    char* q = p+5; while(*q==' ') q++; char* t1=q; while(*q && *q!=' ') q++; if(*q){ *q=0; q++; }
-                    uint32_t n=0; if(parse_u32_dec(t1,&n)!=0 || n==0 || n>4){ console_writeln("usage: disk mkpt N (1..4)"); }
-                    else if(!ata_available()){ console_writeln("ata: no drive"); }
-                    else {
-                        uint8_t m[512]; mbr_zero(m);
-                        uint32_t base = (PT_LBA_START?PT_LBA_START:2048);
-                        if (DISK_SECTORS<=base){ console_writeln("disk too small"); }
-                        else {
-                            uint32_t avail = DISK_SECTORS - base;
-                            uint32_t each = avail / n; if(each==0){ console_writeln("too many partitions"); }
-                            else {
-                                for(uint32_t i=0;i<n && i<4;i++){
-                                    uint32_t start = base + i*each;
-                                    uint32_t count = (i==n-1)? (avail - i*each) : each;
-                                    mbr_set_entry(m,(int)i, (i==0)?0x80:0x00, 0x83, start, count);
-                                }
-                                if (mbr_write(m)==0) console_writeln("ok"); else console_writeln("write failed");
-                            }
-                        }
-                    }
-                } else if (startswith(p, "mkpart ")) {
-                    // disk mkpart i start count typeHex
-                    char* q = p+7; while(*q==' ') q++;
-                    // token 1: index
-                    char* t1=q; while(*q && *q!=' ') q++; if(*q){ *q=0; q++; }
-                    while(*q==' ') q++;
-                    // token 2: start
-                    char* t2=q; while(*q && *q!=' ') q++; if(*q){ *q=0; q++; }
-                    while(*q==' ') q++;
-                    // token 3: count
-                    char* t3=q; while(*q && *q!=' ') q++; if(*q){ *q=0; q++; }
-                    while(*q==' ') q++;
-                    // token 4: type hex (e.g., 83)
-                    char* t4=q; while(*q && *q!=' ') q++; *q=0;
-                    uint32_t idx=0,start=0,count=0; uint8_t type=0;
-                    if(parse_u32_dec(t1,&idx)!=0 || idx>3 || parse_u32_dec(t2,&start)!=0 || parse_u32_dec(t3,&count)!=0 || parse_hex8(t4,&type)!=0){ console_writeln("usage: disk mkpart i start count typeHex"); }
-                    else if(!ata_available()){ console_writeln("ata: no drive"); }
-                    else {
-                        uint8_t m[512]; if(mbr_read(m)!=0){ console_writeln("read failed"); }
-                        else { if (m[510]!=0x55||m[511]!=0xAA) mbr_zero(m); mbr_set_entry(m,(int)idx,(idx==0)?0x80:0x00,type,start,count); if(mbr_write(m)==0) console_writeln("ok"); else console_writeln("write failed"); }
-                    }
-                } else if (streq(p, "clear")) {
-                    if(!ata_available()){ console_writeln("ata: no drive"); }
-                    else { uint8_t m[512]; mbr_zero(m); if(mbr_write(m)==0) console_writeln("ok"); else console_writeln("write failed"); }
-                } else {
-                    console_writeln("usage: disk info|list|mkpt N|mkpart i start count type|clear");
-                }
-#endif
-            } else if (startswith(line, "render ")) {
-                char path[128]; path_resolve(path, cwd, line+7);
-                if (render_file(path)==0) console_writeln("render ok"); else console_writeln("render failed");
-            } else if (streq(line, "gui demo")) {
-#ifdef ENABLE_GUI
-                if (!g_fb.present){ console_writeln("no framebuffer"); }
-                else {
-                    GuiWindow w; gui_window_init(&w, 40, 30, 320, 200, "foxos GUI");
-                    gui_window_draw(&w);
-                    gui_window_fill_text(&w, "Hello GUI!\nThis is a stub per-pixel window.");
-                    console_writeln("gui ok");
-                }
-#else
-                console_writeln("gui disabled");
-#endif
-            } else if (streq(line, "reboot")) {
-                serial_writeln("[sys] reboot requested");
-                console_writeln("rebooting...");
-                reboot_machine();
-            } else if (streq(line, "restart")) {
-                serial_writeln("[sys] restart requested (BIOS)");
-                console_writeln("restarting (BIOS)...");
-                do_reboot_realmode();
-            } else if (streq(line, "shutdown") || streq(line, "poweroff")) {
-                serial_writeln("[sys] shutdown requested");
-                console_writeln("powering off...");
-                poweroff_machine();
-            }
+            shell_exec(line);
             len = 0;
             console_write("foxos> ");
+            console_batch_end();
         } else if (ch == '\b') {
             if (len > 0) { len--; console_putc('\b'); }
         } else if (ch >= 32 && ch <= 126) {
@@ -594,7 +693,7 @@ extern void pm_to_rm_reboot(void);
 // Copy stub to 0x00070000 and jump to real-mode reboot
 static void do_reboot_realmode(void){
     __asm__ __volatile__("cli");
-    serial_writeln("[sys] reboot: switching to real mode (warm KBC)");
+    serial_writeln("[sys] reboot: switching to real mode (warm KBC)"); serial_flush();
 
     volatile uint8_t* dst = (volatile uint8_t*)0x00070000;
     for (unsigned i=0;i<sizeof(REBOOT16_STUB);++i) dst[i] = REBOOT16_STUB[i];
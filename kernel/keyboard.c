@@ -1,13 +1,22 @@
 #include <stdint.h>
 #include "io.h"
 #include "keyboard.h"
+#include "idt.h"
+#include "workqueue.h"
 
 #define KBD_DATA 0x60
 #define KBD_STATUS 0x64
+#define KBD_BUF_LEN 128   // decoded keys; power of two, indices are masked with it
 
-static volatile char buf[128];
+static volatile int buf[KBD_BUF_LEN];
 static volatile unsigned head = 0, tail = 0;
 
+// Raw scancodes captured by the IRQ1 top half, decoded by kbd_work
+static volatile uint8_t raw[64];
+static volatile unsigned raw_head = 0, raw_tail = 0;
+static work_t kbd_work;
+static int kbd_irq_mode = 0;
+
 static inline void kbd_wait_input_empty(void) { while (inb(KBD_STATUS) & 0x02) { } }
 static inline int kbd_output_full(void) { return (inb(KBD_STATUS) & 0x01) != 0; }
 
@@ -16,14 +25,14 @@ static uint8_t shift_down = 0;   // either LSHIFT (0x2A) or RSHIFT (0x36)
 static uint8_t caps_lock = 0;    // toggled by 0x3A
 static uint8_t e0_prefix = 0;    // track 0xE0 extended scancodes
 
-static void buf_put(char c) {
-    unsigned n = (head + 1) & (sizeof(buf)-1);
+static void buf_put(int c) {
+    unsigned n = (head + 1) & (KBD_BUF_LEN-1);
     if (n != tail) { head = n; buf[head] = c; }
 }
 
 static int buf_get(void) {
     if (head == tail) return -1;
-    tail = (tail + 1) & (sizeof(buf)-1);
+    tail = (tail + 1) & (KBD_BUF_LEN-1);
     return buf[tail];
 }
 
@@ -57,41 +66,40 @@ void keyboard_init(void) {
     if (kbd_output_full()) (void)inb(KBD_DATA); // ack
 }
 
-// Polling read with modifier handling and arrow detection
-int keyboard_getchar(void) {
-    if (!kbd_output_full()) return buf_get();
-
-    uint8_t sc = inb(KBD_DATA);
-    if (sc == 0xE0) { e0_prefix = 1; return buf_get(); }
+// Scancode decoder with modifier handling and arrow detection; results go to buf
+static void kbd_decode(uint8_t sc) {
+    if (sc == 0xE0) { e0_prefix = 1; return; }
 
     if (sc & 0x80) {
         uint8_t make = sc & 0x7F;
         if (e0_prefix) {
             // Ignore key releases of extended keys for now
             e0_prefix = 0;
-            return buf_get();
+            return;
         }
         if (make == 0x2A || make == 0x36) shift_down = 0; // shift released
-        return buf_get();
+        return;
     }
 
     if (e0_prefix) {
         e0_prefix = 0;
-        // Handle extended arrows: Up=0x48, Down=0x50
-        if (sc == 0x48) return KBD_KEY_UP;
-        if (sc == 0x50) return KBD_KEY_DOWN;
+        // Handle extended arrows: Up=0x48, Down=0x50; PgUp=0x49, PgDn=0x51
+        if (sc == 0x48) buf_put(KBD_KEY_UP);
+        if (sc == 0x50) buf_put(KBD_KEY_DOWN);
+        if (sc == 0x49) buf_put(shift_down ? KBD_KEY_SHIFT_PGUP : KBD_KEY_PGUP);
+        if (sc == 0x51) buf_put(shift_down ? KBD_KEY_SHIFT_PGDN : KBD_KEY_PGDN);
         // Other extended keys ignored for now
-        return buf_get();
+        return;
     }
 
     // Make codes (key press)
     if (sc == 0x2A || sc == 0x36) { // shift pressed
         shift_down = 1;
-        return buf_get();
+        return;
     }
     if (sc == 0x3A) { // caps lock toggle
         caps_lock ^= 1;
-        return buf_get();
+        return;
     }
 
     char ch;
@@ -106,5 +114,41 @@ int keyboard_getchar(void) {
     }
 
     if (ch) buf_put(ch);
+}
+
+// Bottom half: decode every scancode the IRQ captured since the last run
+static void kbd_work_fn(void* arg) {
+    (void)arg;
+    while (raw_tail != raw_head) {
+        uint8_t sc = raw[raw_tail & (sizeof(raw)-1)];
+        raw_tail++;
+        kbd_decode(sc);
+    }
+}
+
+// Top half: read the byte to ack the controller, stash it, defer decoding
+static void kbd_irq(int irq) {
+    (void)irq;
+    uint8_t sc = inb(KBD_DATA);
+    if (raw_head - raw_tail < sizeof(raw)) { raw[raw_head & (sizeof(raw)-1)] = sc; raw_head++; }
+    work_queue(&kbd_work);
+}
+
+void keyboard_enable_irq(void) {
+    work_init(&kbd_work, kbd_work_fn, 0);
+    kbd_irq_mode = 1;
+    irq_register(1, kbd_irq);
+}
+
+// Returns the next decoded key; polls the controller until IRQ1 is in use
+int keyboard_getchar(void) {
+    if (kbd_irq_mode || !kbd_output_full()) return buf_get();
+    kbd_decode(inb(KBD_DATA));
     return buf_get();
 }
+
+// IRQ1 decodes at interrupt exit, so an idle loop must look again with
+// interrupts off before it halts
+int keyboard_has_char(void) {
+    return head != tail || (!kbd_irq_mode && kbd_output_full());
+}
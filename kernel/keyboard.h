@@ -3,7 +3,13 @@
 
 void keyboard_init(void);
 int keyboard_getchar(void); // returns -1 if no key
+int keyboard_has_char(void); // a key is buffered; safe with interrupts off
+void keyboard_enable_irq(void); // switch from polling to IRQ1 + deferred decode
 
 // Special keys (negative values)
 #define KBD_KEY_UP   (-1001)
 #define KBD_KEY_DOWN (-1002)
+#define KBD_KEY_PGUP (-1003)
+#define KBD_KEY_PGDN (-1004)
+#define KBD_KEY_SHIFT_PGUP (-1005)
+#define KBD_KEY_SHIFT_PGDN (-1006)
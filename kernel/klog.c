@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include "klog.h"
+#include "io.h"
+#include "console.h"
+#include "serial.h"
+#include "workqueue.h"
+#include "shell.h"
+
+static klog_rec_t ring[KLOG_RECORDS];
+static volatile uint32_t head = 0;     // next sequence to reserve
+static uint32_t sink_seq = 0;          // next sequence the sinks emit
+static uint32_t lost = 0;              // overwritten before the sinks ran
+static int console_level = KLOG_WARN;
+static int serial_level = KLOG_DEBUG;
+static work_t flush_work;
+
+static const char* const level_names[] = { "ERR", "WARN", "INFO", "DBG" };
+static const char* const subsys_names[KLOG_NSUBSYS] = {
+    "kern", "mem", "vfs", "ata", "kbd", "serial", "irq", "fb", "gui", "render", "shell"
+};
+
+static void flush_work_fn(void* arg){ (void)arg; klog_flush(); }
+
+static int cmd_dmesg(int argc, char** argv);
+static const shell_cmd_t dmesg_cmd = { "dmesg", cmd_dmesg, "dmesg [-l level]", "kernel log (err|warn|info|debug)", 0 };
+
+void klog_init(void){
+    head = 0; sink_seq = 0; lost = 0;
+    for (int i=0;i<KLOG_RECORDS;++i) ring[i].seq = 0;
+    work_init_thread(&flush_work, flush_work_fn, 0);
+    shell_register(&dmesg_cmd);
+}
+
+void klog(int level, int subsys, const char* msg){
+    uint32_t s = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    klog_rec_t* r = &ring[s & (KLOG_RECORDS-1)];
+    r->seq = 0;   // readers treat the slot as torn until republished
+    __atomic_signal_fence(__ATOMIC_RELEASE);
+    r->tsc = rdtsc();
+    r->level = (uint8_t)level; r->cpu = 0; r->subsys = (uint8_t)subsys;
+    int n = 0; while (msg[n] && n < KLOG_MSG-1) { r->msg[n] = msg[n]; n++; }
+    r->msg[n] = 0; r->len = (uint8_t)n;
+    __atomic_store_n(&r->seq, s + 1, __ATOMIC_RELEASE);
+    if (flush_work.fn && !flush_work.pending) work_queue(&flush_work);
+}
+
+// Copy the record with sequence s; 1 = ok, 0 = not yet published, -1 = overwritten
+static int read_rec(uint32_t s, klog_rec_t* out){
+    const klog_rec_t* r = &ring[s & (KLOG_RECORDS-1)];
+    uint32_t q = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    if (q != s + 1) return (q == 0 || (int32_t)(q - (s + 1)) < 0) ? 0 : -1;
+    out->level = r->level; out->cpu = r->cpu; out->subsys = r->subsys; out->len = r->len; out->tsc = r->tsc;
+    for (int i=0;i<=r->len;++i) out->msg[i] = r->msg[i];
+    __atomic_signal_fence(__ATOMIC_ACQUIRE);
+    if (r->seq != s + 1) return -1;   // a producer lapped us mid-copy
+    out->seq = q;
+    return 1;
+}
+
+int klog_next(uint32_t* cursor, klog_rec_t* out){
+    uint32_t h = head;
+    uint32_t oldest = h > KLOG_RECORDS ? h - KLOG_RECORDS : 0;
+    if (*cursor < oldest) *cursor = oldest;
+    while (*cursor < h) {
+        int r = read_rec(*cursor, out);
+        if (r == 0) return 0;
+        (*cursor)++;
+        if (r > 0) return 1;
+    }
+    return 0;
+}
+
+const char* klog_level_name(int level){ return (level>=0 && level<=KLOG_DEBUG) ? level_names[level] : "?"; }
+const char* klog_subsys_name(int subsys){ return (subsys>=0 && subsys<KLOG_NSUBSYS) ? subsys_names[subsys] : "?"; }
+
+void klog_set_sink_levels(int console_lvl, int serial_lvl){ console_level = console_lvl; serial_level = serial_lvl; }
+
+uint32_t klog_lost(void){ return lost; }
+
+static void u32_dec(uint32_t v, char* buf){ char t[12]; int n=0; do { t[n++]=(char)('0'+v%10); v/=10; } while(v); int i=0; while(n) buf[i++]=t[--n]; buf[i]=0; }
+
+void klog_flush(void){
+    klog_rec_t rec;
+    char num[12];
+    while (sink_seq != head) {
+        if (head - sink_seq > KLOG_RECORDS) { lost += head - sink_seq - KLOG_RECORDS; sink_seq = head - KLOG_RECORDS; }
+        int r = read_rec(sink_seq, &rec);
+        if (r == 0) break;
+        sink_seq++;
+        if (r < 0) { lost++; continue; }
+        if (rec.level <= serial_level) {
+            // "[<kcycles>] LEVEL subsys: message"
+            u32_dec((uint32_t)(rec.tsc >> 10), num);
+            serial_write("["); serial_write(num); serial_write("] ");
+            serial_write(level_names[rec.level]); serial_write(" ");
+            serial_write(klog_subsys_name(rec.subsys)); serial_write(": ");
+            serial_writeln(rec.msg);
+        }
+        if (rec.level <= console_level) {
+            console_write(klog_subsys_name(rec.subsys)); console_write(": ");
+            console_writeln(rec.msg);
+        }
+    }
+}
+
+static int cmd_dmesg(int argc, char** argv){
+    int maxlvl = KLOG_DEBUG;
+    if (argc == 3 && shell_streq(argv[1], "-l")) {
+        const char* a = argv[2];
+        if (shell_streq(a,"err")) maxlvl = KLOG_ERR; else if (shell_streq(a,"warn")) maxlvl = KLOG_WARN;
+        else if (shell_streq(a,"info")) maxlvl = KLOG_INFO; else if (shell_streq(a,"debug")) maxlvl = KLOG_DEBUG;
+        else if (*a>='0' && *a<='3' && !a[1]) maxlvl = *a-'0';
+        else argc = 0;
+    }
+    if (argc != 1 && argc != 3) { console_writeln("usage: dmesg [-l err|warn|info|debug]"); return -1; }
+    uint32_t cur = 0; klog_rec_t rec; char b[16];
+    while (klog_next(&cur, &rec)) {
+        if (rec.level > maxlvl) continue;
+        sh_write("["); u32_dec((uint32_t)(rec.tsc >> 10), b); sh_write(b); sh_write("] ");
+        sh_write(klog_level_name(rec.level)); sh_write(" ");
+        sh_write(klog_subsys_name(rec.subsys)); sh_write(": ");
+        sh_writeln(rec.msg);
+    }
+    if (klog_lost()) { sh_write("(sinks lost "); u32_dec(klog_lost(), b); sh_write(b); sh_writeln(" records)"); }
+    return 0;
+}
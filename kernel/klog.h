@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+// Kernel log: fixed-size binary records in a lock-free multi-producer ring.
+// klog() reserves a slot with one atomic add, copies the message and
+// publishes the slot; formatting and output to the console/serial sinks
+// happen later from the worker. Old records are overwritten when the ring
+// wraps; `dmesg` shows whatever is still retained.
+
+#define KLOG_RECORDS 256         // power of two
+#define KLOG_MSG 112             // bytes of message per record (NUL incl.)
+
+enum { KLOG_ERR = 0, KLOG_WARN, KLOG_INFO, KLOG_DEBUG };
+
+enum {
+    KLOG_KERN = 0, KLOG_MEM, KLOG_VFS, KLOG_ATA, KLOG_KBD, KLOG_SERIAL,
+    KLOG_IRQ, KLOG_FB, KLOG_GUI, KLOG_RENDER, KLOG_SHELL, KLOG_NSUBSYS
+};
+
+typedef struct {
+    volatile uint32_t seq;   // sequence + 1 once published, 0 while writing
+    uint8_t level;
+    uint8_t cpu;
+    uint8_t subsys;
+    uint8_t len;
+    uint64_t tsc;
+    char msg[KLOG_MSG];
+} klog_rec_t;
+
+void klog_init(void);
+void klog(int level, int subsys, const char* msg);
+// Output threshold per sink (records at or below the level are emitted)
+void klog_set_sink_levels(int console_level, int serial_level);
+// Drain new records to the sinks; runs from the worker
+void klog_flush(void);
+
+const char* klog_level_name(int level);
+const char* klog_subsys_name(int subsys);
+// Copy retained records oldest-first; returns 0 when there are no more.
+// *cursor starts at 0.
+int klog_next(uint32_t* cursor, klog_rec_t* out);
+uint32_t klog_lost(void);
@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include "lz4.h"
+
+typedef uint32_t __attribute__((may_alias, aligned(1))) u32u_t;   // unaligned word
+
+#define MIN_MATCH    4
+#define LAST_LITERALS 5      // the block always ends in at least this many literals
+#define MF_LIMIT     12      // and the last match starts this far from the end
+#define MAX_OFFSET   65535
+#define HASH_BITS    15
+#define CHAIN_DEPTH  64
+
+// Literals and matches move 8 bytes (two words) per step when there are 7
+// bytes of slack after the run; the copy may then touch those bytes but
+// never goes past the buffers. A match closer than 8 bytes repeats with
+// its offset as period, so after the first 8 bytes it is copied from a
+// multiple of the offset that is at least 8 back.
+#define SLACK 7
+
+static void copy_wild(uint8_t* d, const uint8_t* s, uint32_t n){
+    uint8_t* e = d + n;
+    do {
+        ((u32u_t*)d)[0] = ((const u32u_t*)s)[0];
+        ((u32u_t*)d)[1] = ((const u32u_t*)s)[1];
+        d += 8; s += 8;
+    } while (d < e);
+}
+
+static void copy_bytes(uint8_t* d, const uint8_t* s, uint32_t n){ while (n--) *d++ = *s++; }
+
+static const uint8_t period8[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };    // smallest multiple of off >= 8
+
+int lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap){
+    const uint8_t* ip = src; const uint8_t* iend = src + src_len;
+    uint8_t* op = dst; uint8_t* oend = dst + dst_cap;
+    for (;;){
+        if (ip >= iend) return LZ4_ERR_CORRUPT;
+        uint32_t token = *ip++;
+        uint32_t len = token >> 4;
+        if (len == 15){
+            uint32_t b;
+            do { if (ip >= iend) return LZ4_ERR_CORRUPT; b = *ip++; len += b; } while (b == 255);
+        }
+        if ((uint32_t)(iend - ip) < len) return LZ4_ERR_CORRUPT;
+        if ((uint32_t)(oend - op) < len) return LZ4_ERR_OVERFLOW;
+        if (len){
+            if ((uint32_t)(iend - ip) >= len + SLACK && (uint32_t)(oend - op) >= len + SLACK) copy_wild(op, ip, len);
+            else copy_bytes(op, ip, len);
+        }
+        op += len; ip += len;
+        if (ip == iend) break;          // last sequence: literals only
+
+        if (iend - ip < 2) return LZ4_ERR_CORRUPT;
+        uint32_t off = ip[0] | (uint32_t)ip[1] << 8; ip += 2;
+        if (off == 0 || off > (uint32_t)(op - dst)) return LZ4_ERR_CORRUPT;
+        len = token & 15;
+        if (len == 15){
+            uint32_t b;
+            do { if (ip >= iend) return LZ4_ERR_CORRUPT; b = *ip++; len += b; } while (b == 255);
+        }
+        len += MIN_MATCH;
+        if ((uint32_t)(oend - op) < len) return LZ4_ERR_OVERFLOW;
+        if ((uint32_t)(oend - op) < len + SLACK) copy_bytes(op, op - off, len);
+        else if (off >= 8) copy_wild(op, op - off, len);
+        else {
+            copy_bytes(op, op - off, 8);
+            if (len > 8) copy_wild(op + 8, op + 8 - period8[off], len - 8);
+        }
+        op += len;
+    }
+    return (int)(op - dst);
+}
+
+static uint32_t hash4(const uint8_t* p){ return (*(const u32u_t*)p * 2654435761u) >> (32 - HASH_BITS); }
+
+static uint8_t* put_len(uint8_t* op, uint32_t n){
+    for (; n >= 255; n -= 255) *op++ = 255;
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+// One sequence: literals [lit, lit+nlit) then a match (mlen 0 = none)
+static uint8_t* put_seq(uint8_t* op, uint8_t* oend, const uint8_t* lit, uint32_t nlit, uint32_t off, uint32_t mlen){
+    // token + literal length + literals + offset + match length
+    if ((uint32_t)(oend - op) < 1 + nlit / 255 + 1 + nlit + 2 + mlen / 255 + 1) return 0;
+    uint8_t* token = op++;
+    *token = (uint8_t)((nlit >= 15 ? 15 : nlit) << 4);
+    if (nlit >= 15) op = put_len(op, nlit - 15);
+    copy_bytes(op, lit, nlit); op += nlit;
+    if (!mlen) return op;
+    *op++ = (uint8_t)off; *op++ = (uint8_t)(off >> 8);
+    mlen -= MIN_MATCH;
+    *token |= (uint8_t)(mlen >= 15 ? 15 : mlen);
+    if (mlen >= 15) op = put_len(op, mlen - 15);
+    return op;
+}
+
+int lz4_compress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap, void* work){
+    uint32_t* chain = (uint32_t*)work;                  // previous position + 1, by pos & 0xFFFF
+    uint32_t* head = chain + (1u << 16);                // latest position + 1, by hash
+    for (uint32_t i = 0; i < (1u << HASH_BITS); ++i) head[i] = 0;
+    uint8_t* op = dst; uint8_t* oend = dst + dst_cap;
+    uint32_t anchor = 0, ip = 0, next = 0;
+
+    if (src_len > MF_LIMIT){
+        uint32_t limit = src_len - MF_LIMIT;
+        while (ip < limit){
+            for (; next <= ip; ++next){
+                uint32_t h = hash4(src + next);
+                chain[next & 0xFFFF] = head[h]; head[h] = next + 1;
+            }
+            uint32_t best = 0, best_off = 0, max = src_len - LAST_LITERALS - ip;
+            uint32_t cand = chain[ip & 0xFFFF];
+            for (int depth = 0; cand && depth < CHAIN_DEPTH; ++depth){
+                uint32_t c = cand - 1;
+                if (ip - c > MAX_OFFSET) break;
+                if (src[c + best] == src[ip + best] && *(const u32u_t*)(src + c) == *(const u32u_t*)(src + ip)){
+                    uint32_t n = MIN_MATCH;
+                    while (n < max && src[c + n] == src[ip + n]) n++;
+                    if (n > best) { best = n; best_off = ip - c; if (n == max) break; }
+                }
+                cand = chain[c & 0xFFFF];
+            }
+            if (best < MIN_MATCH) { ip++; continue; }
+            op = put_seq(op, oend, src + anchor, ip - anchor, best_off, best);
+            if (!op) return LZ4_ERR_OVERFLOW;
+            ip += best; anchor = ip;
+        }
+    }
+    op = put_seq(op, oend, src + anchor, src_len - anchor, 0, 0);
+    if (!op) return LZ4_ERR_OVERFLOW;
+    return (int)(op - dst);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+// LZ4 block format (no frame): a run of sequences, each a token byte
+// (literal count << 4 | match length - 4), the literals, a 16-bit match
+// offset and the extra length bytes; the last sequence is literals only.
+// The decompressor runs in the boot stub (kernel/stub.c); the compressor
+// is for tools/lz4pack and the host tests.
+
+#define LZ4_ERR_CORRUPT  -1     // truncated input or an offset before the output start
+#define LZ4_ERR_OVERFLOW -2     // output does not fit
+
+// Decompress exactly src_len bytes into at most dst_cap bytes. Returns the
+// decompressed size or a negative LZ4_ERR_*
+int lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap);
+
+// Worst case for n input bytes, and the scratch space lz4_compress needs
+#define LZ4_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+#define LZ4_WORK_SIZE ((1u << 16) * 4 + (1u << 15) * 4)
+
+// Greedy hash-chain compressor. Returns the compressed size or LZ4_ERR_OVERFLOW
+int lz4_compress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap, void* work);
+
+// Header tools/lz4pack writes in front of the compressed kernel; the stub
+// finds it at the start of its .payload section
+typedef struct {
+    uint32_t magic;         // LZ4_IMAGE_MAGIC
+    uint32_t raw_size;      // kernel.bin bytes
+    uint32_t packed_size;   // LZ4 block bytes after this header
+    uint32_t reserved;
+} lz4_image_t;
+
+#define LZ4_IMAGE_MAGIC 0x4B5A4C46u  // "FLZK"
@@ -1,6 +1,9 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "memory.h"
+#include "console.h"
+#include "shell.h"
+#include "io.h"
 
 // Simple bump allocator over a fixed pool of chunks (identity-mapped physical)
 static uint8_t pool[POOL_CHUNKS * CHUNK_SIZE];
@@ -20,9 +23,56 @@ static ucdesc_t uc_table[MAX_UC];
 static uint32_t rng_state = 0xC0FFEE01;
 static uint32_t rnd32(void){ rng_state = rng_state*1664525u + 1013904223u; return rng_state; }
 
+static int cmd_mem(int argc, char** argv){
+    (void)argc; (void)argv;
+    uint32_t chunks = 0, handles = 0; char b[16];
+    for (uint32_t i = 0; i < POOL_CHUNKS; ++i) chunks += chunk_used[i];
+    for (uint32_t i = 0; i < MAX_UC; ++i) handles += uc_table[i].magic != 0;
+    sh_write("pool: "); u32_to_dec(chunks, b); sh_write(b);
+    sh_write("/"); u32_to_dec(POOL_CHUNKS, b); sh_write(b);
+    sh_write(" chunks of "); u32_to_dec(CHUNK_SIZE, b); sh_write(b);
+    sh_write(" B, handles "); u32_to_dec(handles, b); sh_write(b);
+    sh_write("/"); u32_to_dec(MAX_UC, b); sh_writeln(b);
+    return 0;
+}
+static const shell_cmd_t mem_cmd = { "mem", cmd_mem, 0, "chunk pool usage", 0 };
+
+static uint32_t phys_top = 0;
+
+#ifdef FOXOS_HOST
+// tests/host maps the fixed arenas itself
+static uint32_t probe_phys_top(void) { return 0xFFFFFFFFu; }
+#else
+static uint8_t cmos_read(uint8_t reg) {
+    uint8_t nmi = inb(0x70) & 0x80;     // keep the NMI-disable bit as it was
+    outb(0x70, (uint8_t)(nmi | reg));
+    return inb(0x71);
+}
+
+// CMOS 0x34/0x35: 64 KiB blocks above 16 MiB; 0x30/0x31: KiB above 1 MiB,
+// which saturates at 64 MiB
+static uint32_t probe_phys_top(void) {
+    uint32_t hi = cmos_read(0x34) | (uint32_t)cmos_read(0x35) << 8;
+    if (hi) {
+        uint64_t top = 0x01000000ull + ((uint64_t)hi << 16);
+        return top > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)top;
+    }
+    uint32_t ext = cmos_read(0x30) | (uint32_t)cmos_read(0x31) << 8;
+    return 0x00100000u + ext * 1024u;
+}
+#endif
+
+uint32_t mem_phys_top(void) { return phys_top; }
+
+int mem_phys_fits(uint32_t addr, uint32_t size) {
+    return addr <= phys_top && size <= phys_top - addr;
+}
+
 void mem_init(void) {
+    phys_top = probe_phys_top();
     for (uint32_t i = 0; i < POOL_CHUNKS; ++i) chunk_used[i] = 0;
     for (uint32_t i = 0; i < MAX_UC; ++i) uc_table[i].magic = 0;
+    shell_register(&mem_cmd);
 }
 
 static int alloc_chunk(void) {
@@ -61,8 +111,8 @@ uchandle_t uc_alloc(uint32_t bytes) {
     }
     d->total_chunks = need;
     d->used_bytes = 0;
-    // generate capability handle
-    uint32_t h = rnd32() | 1u;
+    // generate capability handle; the low bits name the slot get_uc() checks
+    uint32_t h = ((rnd32() | MAX_UC) & ~(uint32_t)(MAX_UC - 1)) | slot;
     d->magic = h;
     return h;
 }
@@ -107,6 +157,26 @@ int uc_write(uchandle_t h, const void* src, uint32_t len) {
     return 0;
 }
 
+int uc_pwrite(uchandle_t h, uint32_t offset, const void* src, uint32_t len) {
+    ucdesc_t* d = get_uc(h);
+    if (!d) return -1;
+    uint32_t cap = d->total_chunks * CHUNK_SIZE;
+    if (offset > cap || len > cap - offset) return -2;
+    const uint8_t* s = (const uint8_t*)src;
+    uint32_t pos = offset;
+    while (len) {
+        uint32_t cidx = pos / CHUNK_SIZE;
+        uint32_t off  = pos % CHUNK_SIZE;
+        uint32_t space = CHUNK_SIZE - off;
+        uint32_t n = (len < space) ? len : space;
+        uint8_t* dst = chunk_ptr(d->chunk_idx[cidx]) + off;
+        for (uint32_t i = 0; i < n; ++i) dst[i] = s[i];
+        s += n; pos += n; len -= n;
+    }
+    if (pos > d->used_bytes) d->used_bytes = pos;
+    return 0;
+}
+
 int uc_read(uchandle_t h, uint32_t offset, void* dst, uint32_t len) {
     ucdesc_t* d = get_uc(h);
     if (!d) return -1;
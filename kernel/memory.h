@@ -6,6 +6,13 @@
 
 void mem_init(void);
 
+// Installed RAM: the end of the block that starts at 1 MiB, from the sizes
+// the BIOS leaves in CMOS (read by mem_init). Arenas at fixed physical
+// addresses (fb back buffer, glyph cache, surfaces, renderer) check
+// against it and stay off if they do not fit.
+uint32_t mem_phys_top(void);
+int mem_phys_fits(uint32_t addr, uint32_t size);   // 1 if [addr, addr+size) is RAM
+
 // Unified-chunk handle (capability). 0 means invalid.
 typedef uint32_t uchandle_t;
 
@@ -15,6 +22,9 @@ int uc_free(uchandle_t h);
 // Append write: fills current chunk before using next
 int uc_write(uchandle_t h, const void* src, uint32_t len);
 
+// Random-access write within capacity; extends the used size if needed
+int uc_pwrite(uchandle_t h, uint32_t offset, const void* src, uint32_t len);
+
 // Random-access read
 int uc_read(uchandle_t h, uint32_t offset, void* dst, uint32_t len);
 
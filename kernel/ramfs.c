@@ -17,13 +17,19 @@ void ramfs_init(void){
 
 ramfs_node_t* ramfs_root(void){ return &root; }
 
+// Nodes come from a fixed pool; removed ones are chained through
+// nextSibling on a free list and reused first
+static ramfs_node_t* free_nodes = NULL;
+
 static ramfs_node_t* add_child(ramfs_node_t* dir, const char* name, int isDir){
     static ramfs_node_t nodes[256];
     static uint32_t used = 0;
-    if (used >= 256) return NULL;
-    ramfs_node_t* n = &nodes[used++];
+    ramfs_node_t* n;
+    if (free_nodes) { n = free_nodes; free_nodes = n->nextSibling; }
+    else if (used < 256) n = &nodes[used++];
+    else return NULL;
     strncpyz(n->name, name, sizeof(n->name));
-    n->isDir = isDir; n->parent = dir; n->firstChild = NULL; n->nextSibling = dir->firstChild; dir->firstChild = n; n->data = 0; n->size=0;
+    n->isDir = isDir; n->parent = dir; n->firstChild = NULL; n->nextSibling = dir->firstChild; dir->firstChild = n; n->data = 0; n->size=0; n->gen=0;
     return n;
 }
 
@@ -71,6 +77,8 @@ ramfs_node_t* ramfs_find(const char* path){
 
 ramfs_node_t* ramfs_mkdir(const char* path){ return ensure_dir_path(path); }
 
+static uint32_t write_gen = 0;
+
 int ramfs_write(const char* path, const char* data, uint32_t len){
     // split path into dir + name
     const char* p = path; const char* last = p; for(; *p; ++p) if(*p=='/') last=p+1; const char* name = last;
@@ -85,7 +93,32 @@ int ramfs_write(const char* path, const char* data, uint32_t len){
     uchandle_t h = uc_alloc(len ? len : 1);
     if(!h) return -3;
     if(len){ uc_write(h, data, len); }
-    c->data = h; c->size = len;
+    c->data = h; c->size = len; c->gen = ++write_gen;
+    return 0;
+}
+
+// Grow the handle geometrically so a stream of small appends copies each
+// byte O(1) times on average
+int ramfs_append(const char* path, const char* data, uint32_t len){
+    ramfs_node_t* c = ramfs_find(path);
+    if(!c){ return ramfs_write(path, data, len); }
+    if(c->isDir) return -1;
+    if(!len) return 0;
+    if(!c->data || uc_size(c->data) < c->size + len){
+        uint32_t cap = c->data ? uc_size(c->data) : 0;
+        while(cap < c->size + len) cap = cap ? cap * 2 : CHUNK_SIZE;
+        uchandle_t h = uc_alloc(cap);
+        if(!h) return -3;
+        char tmp[512];
+        for(uint32_t off=0; off<c->size; off+=sizeof(tmp)){
+            uint32_t n = c->size - off < sizeof(tmp) ? c->size - off : sizeof(tmp);
+            uc_read(c->data, off, tmp, n); uc_write(h, tmp, n);
+        }
+        if(c->data) uc_free(c->data);
+        c->data = h;
+    }
+    if(uc_pwrite(c->data, c->size, data, len) != 0) return -3;
+    c->size += len; c->gen = ++write_gen;
     return 0;
 }
 
@@ -98,6 +131,16 @@ int ramfs_read(const char* path, char* out, uint32_t max, uint32_t* outLen){
     return 0;
 }
 
+int ramfs_read_at(const char* path, uint32_t offset, char* out, uint32_t max, uint32_t* outLen){
+    ramfs_node_t* n = ramfs_find(path);
+    if(!n || n->isDir) return -1;
+    uint32_t to = (offset < n->size) ? n->size - offset : 0;
+    if (to > max) to = max;
+    if(to && n->data) uc_read(n->data, offset, out, to);
+    if(outLen) *outLen = to;
+    return 0;
+}
+
 int ramfs_rm(const char* path){
     ramfs_node_t* n = ramfs_find(path);
     if(!n || n==&root) return -1;
@@ -105,6 +148,7 @@ int ramfs_rm(const char* path){
     ramfs_node_t* p = n->parent; if(!p) return -1;
     ramfs_node_t** cur = &p->firstChild; while(*cur && *cur!=n) cur=&(*cur)->nextSibling; if(*cur) *cur = n->nextSibling;
     if(n->data) uc_free(n->data);
+    n->data = 0; n->nextSibling = free_nodes; free_nodes = n;
     return 0;
 }
 
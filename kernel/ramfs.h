@@ -10,6 +10,7 @@ typedef struct ramfs_node {
     struct ramfs_node* nextSibling;
     uchandle_t data;     // for files: unified chunk handle
     uint32_t size;       // file size in bytes
+    uint32_t gen;        // bumped from a global counter on every write
 } ramfs_node_t;
 
 void ramfs_init(void);
@@ -17,7 +18,9 @@ ramfs_node_t* ramfs_root(void);
 ramfs_node_t* ramfs_find(const char* path);
 ramfs_node_t* ramfs_mkdir(const char* path);
 int ramfs_write(const char* path, const char* data, uint32_t len);
+int ramfs_append(const char* path, const char* data, uint32_t len);   // creates the file if needed
 int ramfs_read(const char* path, char* out, uint32_t max, uint32_t* outLen);
+int ramfs_read_at(const char* path, uint32_t offset, char* out, uint32_t max, uint32_t* outLen);
 int ramfs_rm(const char* path);
 int ramfs_ls(const char* path, void (*cb)(const char*, int));
 int ramfs_stat(const char* path, int* isDir, uint32_t* size, uint32_t* children);
@@ -0,0 +1,36 @@
+#pragma once
+#include "fb.h"
+
+// Small rectangle helpers shared by the framebuffer, surfaces and the WM
+
+static inline int rect_empty(const fb_rect_t* r){ return r->w <= 0 || r->h <= 0; }
+static inline int rect_area(const fb_rect_t* r){ return r->w * r->h; }
+
+static inline fb_rect_t rect_union(const fb_rect_t* a, const fb_rect_t* b){
+    int x0 = a->x < b->x ? a->x : b->x, y0 = a->y < b->y ? a->y : b->y;
+    int x1 = a->x+a->w > b->x+b->w ? a->x+a->w : b->x+b->w;
+    int y1 = a->y+a->h > b->y+b->h ? a->y+a->h : b->y+b->h;
+    fb_rect_t u = { x0, y0, x1-x0, y1-y0 };
+    return u;
+}
+
+static inline fb_rect_t rect_intersect(const fb_rect_t* a, const fb_rect_t* b){
+    int x0 = a->x > b->x ? a->x : b->x, y0 = a->y > b->y ? a->y : b->y;
+    int x1 = a->x+a->w < b->x+b->w ? a->x+a->w : b->x+b->w;
+    int y1 = a->y+a->h < b->y+b->h ? a->y+a->h : b->y+b->h;
+    fb_rect_t r = { x0, y0, x1-x0, y1-y0 };
+    return r;
+}
+
+// a minus b as up to 4 disjoint pieces (top, bottom, left, right bands);
+// returns the count written to out
+static inline int rect_subtract(const fb_rect_t* a, const fb_rect_t* b, fb_rect_t out[4]){
+    fb_rect_t i = rect_intersect(a, b);
+    if (rect_empty(&i)) { out[0] = *a; return 1; }
+    int n = 0;
+    if (i.y > a->y) { fb_rect_t t = { a->x, a->y, a->w, i.y - a->y }; out[n++] = t; }
+    if (i.y + i.h < a->y + a->h) { fb_rect_t t = { a->x, i.y + i.h, a->w, a->y + a->h - (i.y + i.h) }; out[n++] = t; }
+    if (i.x > a->x) { fb_rect_t t = { a->x, i.y, i.x - a->x, i.h }; out[n++] = t; }
+    if (i.x + i.w < a->x + a->w) { fb_rect_t t = { i.x + i.w, i.y, a->x + a->w - (i.x + i.w), i.h }; out[n++] = t; }
+    return n;
+}
@@ -3,119 +3,274 @@
 #include "vfs.h"
 #include "render.h"
 #include "window.h"
+#include "dom.h"
+#include "io.h"
+#include "tsc.h"
+#include "script.h"
+#include "css.h"
+#include "memory.h"
 
 // Simple parser helpers
 static int isspace_c(char c){ return c==' '||c=='\t'||c=='\r'||c=='\n'; }
-static int streq(const char* a,const char* b){ while(*a&&*b){ if(*a!=*b) return 0; ++a; ++b;} return *a==0&&*b==0; }
-static int startswith(const char* s,const char* p){ while(*p){ if(*s++!=*p++) return 0; } return 1; }
-static char tolower_c(char c){ return (c>='A'&&c<='Z')?(char)(c+32):c; }
-
-static uint8_t color_from_name(const char* s){
-    // simple VGA 0..15 mapping by name or number
-    if (!s||!*s) return 7;
-    if (startswith(s,"black")) return 0;
-    if (startswith(s,"blue")) return 1;
-    if (startswith(s,"green")) return 2;
-    if (startswith(s,"cyan")) return 3;
-    if (startswith(s,"red")) return 4;
-    if (startswith(s,"magenta")) return 5;
-    if (startswith(s,"brown")||startswith(s,"yellow")) return 6;
-    if (startswith(s,"lightgray")||startswith(s,"grey")) return 7;
-    if (startswith(s,"darkgray")) return 8;
-    if (startswith(s,"lightblue")) return 9;
-    if (startswith(s,"lightgreen")) return 10;
-    if (startswith(s,"lightcyan")) return 11;
-    if (startswith(s,"lightred")) return 12;
-    if (startswith(s,"lightmagenta")) return 13;
-    if (startswith(s,"lightyellow")) return 14;
-    if (startswith(s,"white")) return 15;
-    // numeric 0..15
-    uint32_t v=0; for (int i=0;s[i];++i){ if (s[i]<'0'||s[i]>'9') return 7; v = v*10 + (uint32_t)(s[i]-'0'); if (v>15) return 7; }
-    return (uint8_t)v;
-}
-
-static void trim(char* s){ int i=0,j=0; while(s[i]&&isspace_c(s[i])) i++; while(s[i]) s[j++]=s[i++]; s[j]=0; while(j>0 && isspace_c(s[j-1])) s[--j]=0; }
-
-static void write_text(const char* s){ for(int i=0; s[i]; ++i){ console_putc(s[i]); } }
-
-// Very tiny style parser: style="color: X; background: Y"
-typedef struct { uint8_t fg; uint8_t bg; } style_t;
-static style_t parse_style(const char* s, style_t base){
-    style_t st = base;
-    if(!s) return st;
-    char buf[128]; int bi=0;
-    for(int i=0; s[i] && bi<(int)sizeof(buf)-1; ++i){ char c=s[i]; buf[bi++]=tolower_c(c); }
-    buf[bi]=0;
-    // find color
-    const char* p=buf;
-    while(*p){
-        while(*p && isspace_c(*p)) p++;
-        if(startswith(p,"color:")){
-            p+=6; while(*p==':'||isspace_c(*p)) p++; const char* v=p; while(*p && *p!=';' ) p++; char save=*p; *((char*)p)=0; st.fg=color_from_name(v); *((char*)p)=save; if(*p==';') p++; continue;
-        }
-        if(startswith(p,"background:")){
-            p+=10; while(*p==':'||isspace_c(*p)) p++; const char* v=p; while(*p && *p!=';' ) p++; char save=*p; *((char*)p)=0; st.bg=color_from_name(v); *((char*)p)=save; if(*p==';') p++; continue;
-        }
-        while(*p && *p!=';') p++; if(*p==';') p++;
+
+// ---- layout ----
+// Line boxes: each laid-out line is a run of resolved cells (attr<<8 | ch).
+// Cells grow up from the start of the layout arena and the line table grows
+// down from its end, so neither needs a size guess.
+
+typedef struct { uint32_t off; uint32_t len; } line_box_t;
+
+typedef struct {
+    uint8_t* base;
+    uint32_t size;
+    uint32_t ncells, nlines;
+    uint32_t line_start;        // first cell of the line being built
+    int width;
+    int oom;
+} layout_t;
+
+static uint16_t* lay_cells(layout_t* L){ return (uint16_t*)L->base; }
+static line_box_t* lay_line(layout_t* L, uint32_t i){ return (line_box_t*)(L->base + L->size) - (i + 1); }
+
+static int lay_room(layout_t* L, uint32_t cells, uint32_t lines){
+    uint32_t need = (L->ncells + cells) * 2u + (L->nlines + lines) * (uint32_t)sizeof(line_box_t);
+    if (need <= L->size) return 1;
+    L->oom = 1;
+    return 0;
+}
+
+static void lay_end_line_at(layout_t* L, uint32_t end, uint32_t next){
+    if (!lay_room(L, 0, 1)) return;
+    line_box_t* b = lay_line(L, L->nlines++);
+    b->off = L->line_start; b->len = end - L->line_start;
+    L->line_start = next;
+}
+
+static void lay_end_line(layout_t* L){ lay_end_line_at(L, L->ncells, L->ncells); }
+
+static void lay_put(layout_t* L, uint16_t cell){
+    if (L->ncells - L->line_start == (uint32_t)L->width){
+        // Full: break after the last space if there is one, else mid-word.
+        // The words after it are already in place as the next line's start.
+        uint16_t* c = lay_cells(L);
+        uint32_t k = L->ncells;
+        while (k > L->line_start && (c[k-1] & 0xFF) != ' ') k--;
+        if (k > L->line_start + 1) lay_end_line_at(L, k - 1, k);
+        else lay_end_line(L);
+    }
+    if (!lay_room(L, 1, 1)) return;
+    lay_cells(L)[L->ncells++] = cell;
+}
+
+// ---- DOM walk ----
+
+typedef struct {
+    layout_t* L;
+    uint8_t fg, bg;
+    int line_start, space;      // whitespace collapsing state
+    // interned names, compared by pointer
+    const char *h1, *br, *script, *style;
+} rctx_t;
+
+static void out_raw(rctx_t* r, char c){
+    lay_put(r->L, (uint16_t)(((r->bg << 4) | (r->fg & 0x0F)) << 8) | (uint8_t)c);
+    r->line_start = 0;
+}
+
+static void out_char(rctx_t* r, char c){
+    if (isspace_c(c)) { r->space = !r->line_start; return; }
+    if (r->space) out_raw(r, ' ');
+    out_raw(r, c);
+    r->space = 0;
+}
+
+static void out_str(rctx_t* r, const char* s){ while (*s) out_char(r, *s++); }
+
+static void out_newline(rctx_t* r){
+    if (!r->line_start) lay_end_line(r->L);
+    r->line_start = 1; r->space = 0;
+}
+
+// Script output goes on lines of its own, in document order
+static void script_sink(void* ctx, const char* s, int len){
+    rctx_t* r = (rctx_t*)ctx;
+    out_newline(r);
+    for (int i = 0; i < len; ++i) out_raw(r, s[i] == '\n' || s[i] == '\t' ? ' ' : s[i]);
+    out_newline(r);
+}
+
+// Text content of a <script> or <style> element; -1 if it does not fit
+static int element_text(const dom_node_t* n, char* buf, int cap){
+    int len = 0;
+    for (const dom_node_t* c = n->first_child; c; c = c->next){
+        if (c->type != DOM_TEXT) continue;
+        if (len + c->len > cap) return -1;
+        for (int i = 0; i < c->len; ++i) buf[len++] = c->name[i];
+    }
+    return len;
+}
+
+static char src_buf[SCRIPT_CODE_MAX];
+
+// Compiled and run once per layout, so the output is part of the cached
+// line boxes and scrolling never re-runs it
+static void run_script(rctx_t* r, const dom_node_t* n){
+    int len = element_text(n, src_buf, sizeof(src_buf));
+    if (len < 0) { script_sink(r, "script error: script too long", 29); return; }
+    script_exec(src_buf, len);
+}
+
+// Style sheets apply to the whole document wherever they appear, so gather
+// them before layout. Iterative pre-order walk over the parent links
+static void load_sheets(const rctx_t* r, const dom_node_t* root){
+    const dom_node_t* n = root->first_child;
+    while (n){
+        if (n->type == DOM_ELEMENT && n->name == r->style){
+            int len = element_text(n, src_buf, sizeof(src_buf));
+            if (len > 0) css_add_sheet(src_buf, len);
+        } else if (n->first_child) { n = n->first_child; continue; }
+        while (n && !n->next) { n = n->parent; if (n == root) n = 0; }
+        if (n) n = n->next;
     }
-    return st;
+}
+
+static void layout_node(rctx_t* r, const dom_node_t* n){
+    if (n->type == DOM_TEXT) { for (int i = 0; i < n->len; ++i) out_char(r, n->name[i]); return; }
+    if (n->name == r->br) { lay_end_line(r->L); r->line_start = 1; r->space = 0; return; }
+    if (n->name == r->style) return;
+    if (n->name == r->script) { run_script(r, n); return; }
+    uint8_t fg = r->fg, bg = r->bg;
+    css_style_t st = css_compute(n, (css_style_t){fg, bg, CSS_INLINE});
+    if (st.display == CSS_NONE) return;
+    r->fg = st.fg; r->bg = st.bg;
+    int block = st.display == CSS_BLOCK;
+    if (block) out_newline(r);
+    if (n->name == r->h1) out_str(r, "# ");
+    for (const dom_node_t* c = n->first_child; c; c = c->next) layout_node(r, c);
+    if (block) out_newline(r);
+    r->fg = fg; r->bg = bg;
+}
+
+// ---- cache and view ----
+
+#define VIEW_X 4
+#define VIEW_Y 2
+#define VIEW_W 72
+#define VIEW_H 20
+#define VIEW_ROWS (VIEW_H - 2)
+
+static render_stats_t g_stats;
+static dom_doc_t doc;
+static dom_parser_t parser;
+static layout_t lay;
+static Window win;          // backing store is too big for the stack
+static int win_open = 0;
+static int view_top = 0;
+
+// Layout cache key: one document, valid while its path, size, write
+// generation and layout width are unchanged
+static struct { int valid; char path[128]; uint32_t size, gen; int width; } cache;
+
+const render_stats_t* render_stats(void){ return &g_stats; }
+
+static int parse_and_layout(const char* path, const vfs_stat_t* vst){
+    if (!mem_phys_fits(RENDER_DOM_ADDR, RENDER_DOM_SIZE + RENDER_LAYOUT_SIZE)){
+        console_writeln("render: not enough RAM for the DOM and layout arenas");
+        return -1;
+    }
+    if (dom_init(&doc, (void*)(uintptr_t)RENDER_DOM_ADDR, RENDER_DOM_SIZE) != 0) return -1;
+
+    // Stream the file through the tokenizer a block at a time
+    uint64_t t0 = rdtsc();
+    dom_parse_begin(&parser, &doc);
+    char block[RENDER_BLOCK];
+    uint32_t off = 0, n = 0;
+    while (off < vst->size && vfs_read_at(path, off, block, sizeof(block), &n) == 0 && n){
+        dom_parse_feed(&parser, block, n);
+        off += n;
+    }
+    dom_parse_end(&parser);
+    uint64_t t1 = rdtsc();
+
+    layout_t z = { (uint8_t*)(uintptr_t)RENDER_LAYOUT_ADDR, RENDER_LAYOUT_SIZE, 0, 0, 0, VIEW_W - 2, 0 };
+    lay = z;
+    rctx_t r = { &lay, 15, 0, 1, 0,
+        dom_intern(&doc, "h1", 2), dom_intern(&doc, "br", 2),
+        dom_intern(&doc, "script", 6), dom_intern(&doc, "style", 5) };
+    css_begin(&doc);
+    load_sheets(&r, doc.root);
+    script_begin(script_sink, &r);
+    for (const dom_node_t* c = doc.root->first_child; c; c = c->next) layout_node(&r, c);
+    out_newline(&r);
+    uint64_t t2 = rdtsc();
+
+    g_stats.dom = doc.stats;
+    g_stats.truncated = doc.oom || lay.oom;
+    g_stats.lines = lay.nlines;
+    g_stats.parse_us = (uint32_t)tsc_to_us(t1 - t0);
+    g_stats.layout_us = (uint32_t)tsc_to_us(t2 - t1);
+    g_stats.script = *script_stats();
+    g_stats.css = *css_stats();
+
+    int i = 0; for (; path[i] && i < (int)sizeof(cache.path)-1; ++i) cache.path[i] = path[i]; cache.path[i] = 0;
+    cache.size = vst->size; cache.gen = vst->gen; cache.width = lay.width;
+    cache.valid = 1;
+    return 0;
+}
+
+static int cache_hit(const char* path, const vfs_stat_t* vst){
+    if (!cache.valid || cache.size != vst->size || cache.gen != vst->gen || cache.width != VIEW_W - 2) return 0;
+    int i = 0; while (path[i] && path[i] == cache.path[i]) i++;
+    return path[i] == 0 && cache.path[i] == 0;
+}
+
+static void draw_line(int cy){
+    uint32_t l = (uint32_t)(view_top + cy);
+    if (l < lay.nlines) { line_box_t* b = lay_line(&lay, l); window_set_row(&win, cy, lay_cells(&lay) + b->off, (int)b->len); }
+    else window_set_row(&win, cy, 0, 0);
 }
 
 int render_file(const char* path){
-    char buf[2048];
-    uint32_t n=0; if (vfs_read(path, buf, sizeof(buf)-1, &n)!=0){ console_writeln("render: file not found"); return -1; }
-    buf[n]=0;
+    vfs_stat_t vst;
+    if (vfs_stat(path, &vst) != 0 || vst.isDir){ console_writeln("render: file not found"); return -1; }
+    g_stats.cached = cache_hit(path, &vst);
+    if (!g_stats.cached){
+        cache.valid = 0;
+        if (parse_and_layout(path, &vst) != 0) return -1;
+    }
 
-    // Clear and draw a window for rendering
+    uint64_t t0 = rdtsc();
     console_clear();
-    Window win; window_init(&win, 4, 2, 72, 20, "Renderer", 15, 0);
+    window_init(&win, VIEW_X, VIEW_Y, VIEW_W, VIEW_H, "Renderer", 15, 0);
     window_draw(&win);
-    window_clear_client(&win);
-
-    // set starting color
-    uint8_t cur_fg = 15, cur_bg = 0;
-
-    // scan through very simply
-    for (int i=0; buf[i]; ){
-        if (buf[i] == '<'){
-            int j=i+1; while(buf[j] && buf[j] != '>') j++;
-            if(!buf[j]) break; // malformed
-            char tag[128]; int tlen= j-(i+1); if(tlen>120) tlen=120; int k=0; for(;k<tlen;++k) tag[k]=buf[i+1+k]; tag[k]=0;
-            for(int q=0; tag[q]; ++q) tag[q]=tolower_c(tag[q]);
-
-            if (startswith(tag,"br")) {
-                window_putc(&win,'\n');
-            } else if (startswith(tag,"h1")) {
-                // style
-                const char* sattr = 0; char* a = tag; while(*a){ if(startswith(a,"style=")){ sattr=a+6; break; } a++; }
-                if(sattr && (*sattr=='"' || *sattr=='\'')) { char qch=*sattr++; char tmp[96]; int ti=0; while(*sattr && *sattr!=qch && ti<95) tmp[ti++]=*sattr++; tmp[ti]=0; style_t st = parse_style(tmp,(style_t){cur_fg,cur_bg}); cur_fg=st.fg; cur_bg=st.bg; }
-                window_write(&win, "# ");
-                int p=j+1; while(buf[p] && buf[p]!='<') p++; char txt[256]; int ti=0; for(int z=j+1; z<p && ti<255; ++z) txt[ti++]=buf[z]; txt[ti]=0; trim(txt); window_writeln(&win, txt);
-            } else if (startswith(tag,"p")) {
-                const char* sattr = 0; char* a = tag; while(*a){ if(startswith(a,"style=")){ sattr=a+6; break; } a++; }
-                if(sattr && (*sattr=='"' || *sattr=='\'')) { char qch=*sattr++; char tmp[96]; int ti=0; while(*sattr && *sattr!=qch && ti<95) tmp[ti++]=*sattr++; tmp[ti]=0; style_t st = parse_style(tmp,(style_t){cur_fg,cur_bg}); cur_fg=st.fg; cur_bg=st.bg; }
-                int p=j+1; while(buf[p] && buf[p]!='<') p++; char txt[512]; int ti=0; for(int z=j+1; z<p && ti<511; ++z) txt[ti++]=buf[z]; txt[ti]=0; trim(txt); window_writeln(&win, txt);
-            } else if (startswith(tag,"span")) {
-                const char* sattr = 0; char* a = tag; while(*a){ if(startswith(a,"style=")){ sattr=a+6; break; } a++; }
-                if(sattr && (*sattr=='"' || *sattr=='\'')) { char qch=*sattr++; char tmp[96]; int ti=0; while(*sattr && *sattr!=qch && ti<95) tmp[ti++]=*sattr++; tmp[ti]=0; style_t st = parse_style(tmp,(style_t){cur_fg,cur_bg}); cur_fg=st.fg; cur_bg=st.bg; }
-                int p=j+1; while(buf[p] && !(buf[p]=='<' && (buf[p+1]=='/'||buf[p+1]==0))) p++; char txt[256]; int ti=0; for(int z=j+1; z<p && ti<255; ++z) txt[ti++]=buf[z]; txt[ti]=0; trim(txt);
-                window_write(&win, txt);
-            } else if (startswith(tag,"script")) {
-                int p=j+1; while(buf[p] && !(buf[p]=='<' && startswith(&buf[p+1],"/script"))) p++;
-                char js[256]; int ti=0; for(int z=j+1; z<p && ti<255; ++z) js[ti++]=buf[z]; js[ti]=0;
-                if (js[0]){
-                    const char* m=js;
-                    const char* a1 = "alert('"; const char* c1 = "console.log('";
-                    for(int x=0; m[x]; ++x){ int ok=1; for(int y=0; a1[y]; ++y){ if(!m[x+y]||m[x+y]!=a1[y]){ ok=0; break; } } if(ok){ int s=x+7; char t[128]; int ti2=0; while(m[s] && !(m[s]=='\''&&m[s+1]==')') && ti2<127) t[ti2++]=m[s++]; t[ti2]=0; window_writeln(&win, t); break; } }
-                    for(int x=0; m[x]; ++x){ int ok=1; for(int y=0; c1[y]; ++y){ if(!m[x+y]||m[x+y]!=c1[y]){ ok=0; break; } } if(ok){ int s=x+13; char t[128]; int ti2=0; while(m[s] && !(m[s]=='\''&&m[s+1]==')') && ti2<127) t[ti2++]=m[s++]; t[ti2]=0; window_writeln(&win, t); break; } }
-                }
-            }
-            i = j+1;
-        } else {
-            window_putc(&win, buf[i++]);
-        }
-    }
-
-    window_putc(&win,'\n');
+    win_open = 1;
+    view_top = 0;
+    for (int y = 0; y < VIEW_ROWS; ++y) draw_line(y);
+    window_flush(&win);
+    g_stats.blit_us = (uint32_t)tsc_to_us(rdtsc() - t0);
     return 0;
 }
+
+int render_scroll(int lines){
+    if (!win_open) return -1;
+    int max = (int)lay.nlines - VIEW_ROWS;
+    if (max < 0) max = 0;
+    int top = view_top + lines;
+    if (top < 0) top = 0;
+    if (top > max) top = max;
+    int d = top - view_top;
+    if (!d) return view_top;
+    // Rotate the window's rows and draw only the lines that scrolled in
+    window_scroll(&win, d);
+    view_top = top;
+    if (d > 0) { for (int y = (d < VIEW_ROWS ? VIEW_ROWS - d : 0); y < VIEW_ROWS; ++y) draw_line(y); }
+    else { for (int y = 0; y < -d && y < VIEW_ROWS; ++y) draw_line(y); }
+    window_flush(&win);
+    return view_top;
+}
+
+void render_close(void){
+    if (!win_open) return;
+    window_close(&win);
+    win_open = 0;
+}
@@ -1,9 +1,44 @@
 #pragma once
+#include <stdint.h>
+#include "dom.h"
+#include "script.h"
+#include "css.h"
+
 // Minimal text-mode HTML/CSS/JS renderer
 // Renders a tiny subset of HTML to the VGA text console.
 // Supported:
-//  - <h1>, <p>, <br>, <span style="color:..; background:.."> ... </span>
-//  - <script> with alert('...') or console.log('...')
-//  - Inline style only; colors are basic VGA names or 0..15
-// Returns 0 on success, <0 on error
+//  - <h1>, <p>, <div>, <br>, <span> and any other inline element
+//  - <style> sheets and style="" attributes (css.h)
+//  - <script> in the JavaScript subset of script.h; output from
+//    console.log/alert becomes lines of the document
+//  - colors are basic VGA names or 0..15
+// The file is streamed through the DOM tokenizer (dom.h) in RENDER_BLOCK
+// reads, so its size is bounded only by the DOM arena. Layout turns the
+// tree into line boxes of styled cells; it is cached for the last file
+// (keyed by path, size and write generation), so re-rendering or
+// scrolling only copies the visible lines into the window.
+
+#define RENDER_DOM_ADDR 0x03000000u     // after the surface arena
+#define RENDER_DOM_SIZE (4u*1024u*1024u)
+#define RENDER_LAYOUT_ADDR (RENDER_DOM_ADDR + RENDER_DOM_SIZE)
+#define RENDER_LAYOUT_SIZE (4u*1024u*1024u)
+#define RENDER_BLOCK 512
+
+typedef struct {
+    dom_stats_t dom;
+    int truncated;          // DOM or layout arena ran out; the tail was dropped
+    int cached;             // layout reused; parse/layout figures are from when it was built
+    uint32_t lines;
+    uint32_t parse_us;
+    uint32_t layout_us;
+    uint32_t blit_us;
+    script_stats_t script;  // scripts run while building the layout
+    css_stats_t css;
+} render_stats_t;
+
+// Draws the top of the document in the renderer window, which stays open
+// for render_scroll until render_close. Returns 0 on success, <0 on error
 int render_file(const char* path);
+int render_scroll(int lines);   // >0 scrolls down; returns the new top line, <0 if no document
+void render_close(void);
+const render_stats_t* render_stats(void);   // of the last successful render_file
@@ -0,0 +1,707 @@
+#include <stdint.h>
+#include "script.h"
+
+// ---- values and per-document state ----
+
+enum { V_UNDEF, V_INT, V_STR, V_FN };
+typedef struct { uint8_t t; int32_t i; const char* s; } value_t;
+
+enum {
+    OP_HALT, OP_PUSH_INT, OP_PUSH_STR, OP_PUSH_UNDEF, OP_POP, OP_DUP,
+    OP_LOAD_G, OP_STORE_G, OP_LOAD_L, OP_STORE_L,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_NEG, OP_NOT,
+    OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
+    OP_JMP, OP_JZ, OP_JNZ, OP_CALL, OP_RET, OP_LOG, OP_ALERT
+};
+
+static script_out_fn g_out;
+static void* g_ctx;
+static script_stats_t stats;
+
+static uint8_t code[SCRIPT_CODE_MAX];
+static uint32_t ncode;
+static char pool[SCRIPT_POOL_MAX];     // names and string literals
+static uint32_t npool;
+static char heap[SCRIPT_HEAP_MAX];     // strings made by concatenation
+static uint32_t nheap;
+
+static struct { const char* name; value_t v; } globals[SCRIPT_GLOBALS];
+static int nglobals;
+static struct { uint32_t entry; uint8_t nparams, nlocals; } funcs[SCRIPT_FUNCS];
+static int nfuncs;
+
+static int str_eq(const char* a, const char* b){ while (*a && *a == *b) { a++; b++; } return *a == *b; }
+static int str_cmp(const char* a, const char* b){ while (*a && *a == *b) { a++; b++; } return (unsigned char)*a - (unsigned char)*b; }
+static int str_len(const char* s){ int n = 0; while (s[n]) n++; return n; }
+
+static int itoa_s(int32_t v, char* buf){
+    char tmp[12]; int t = 0, n = 0;
+    uint32_t u = v < 0 ? (uint32_t)0 - (uint32_t)v : (uint32_t)v;
+    do { tmp[t++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) buf[n++] = '-';
+    while (t) buf[n++] = tmp[--t];
+    buf[n] = 0;
+    return n;
+}
+
+static void emit_line(const char* a, const char* b){
+    char line[160]; int n = 0;
+    while (*a && n < (int)sizeof(line)) line[n++] = *a++;
+    while (b && *b && n < (int)sizeof(line)) line[n++] = *b++;
+    g_out(g_ctx, line, n);
+}
+
+void script_begin(script_out_fn out, void* ctx){
+    g_out = out; g_ctx = ctx;
+    ncode = npool = nheap = 0;
+    nglobals = nfuncs = 0;
+    script_stats_t z = {0}; stats = z;
+}
+
+const script_stats_t* script_stats(void){ return &stats; }
+
+// ---- lexer ----
+
+enum {
+    T_EOF = 256, T_NUM, T_STR, T_IDENT, T_EQ, T_NE, T_LE, T_GE, T_AND, T_OR,
+    T_INC, T_DEC, T_PLUSEQ, T_MINUSEQ, T_VAR, T_IF, T_ELSE, T_WHILE, T_FOR,
+    T_FUNCTION, T_RETURN, T_BREAK, T_CONTINUE, T_TRUE, T_FALSE, T_NULL, T_BAD
+};
+
+typedef struct { int t; int32_t num; int len; char text[128]; } token_t;
+
+#define MAX_LOCALS 32
+#define MAX_LOOPS 8
+#define MAX_BREAKS 16
+#define MAX_DEPTH 64        // nested expressions and statements; each level costs kernel stack
+
+typedef struct {
+    const char* src; int len, pos, line;
+    token_t tk;
+    const char* err; int err_line;
+    int in_func;
+    int depth;
+    const char* locals[MAX_LOCALS]; int nlocals;
+    int nloops, loop_base;   // loops[loop_base..nloops) are visible to break/continue
+    struct { uint32_t cont; uint32_t breaks[MAX_BREAKS]; int nbreaks; } loops[MAX_LOOPS];
+} comp_t;
+
+static void error(comp_t* c, const char* msg){ if (!c->err) { c->err = msg; c->err_line = c->line; } }
+
+// Recursion guard for the descent; pair a successful call with c->depth--
+static int nest_in(comp_t* c){
+    if (c->depth == MAX_DEPTH) { error(c, "nested too deeply"); return 0; }
+    c->depth++;
+    return 1;
+}
+
+static int is_alpha(char ch){ return (ch>='a'&&ch<='z')||(ch>='A'&&ch<='Z')||ch=='_'||ch=='$'; }
+static int is_digit(char ch){ return ch>='0'&&ch<='9'; }
+
+static const struct { const char* s; int t; } keywords[] = {
+    {"var",T_VAR},{"let",T_VAR},{"const",T_VAR},{"if",T_IF},{"else",T_ELSE},{"while",T_WHILE},
+    {"for",T_FOR},{"function",T_FUNCTION},{"return",T_RETURN},{"break",T_BREAK},
+    {"continue",T_CONTINUE},{"true",T_TRUE},{"false",T_FALSE},{"null",T_NULL},{"undefined",T_NULL}
+};
+
+static void lex(comp_t* c, token_t* t){
+    const char* s = c->src;
+    for (;;){
+        while (c->pos < c->len && (s[c->pos]==' '||s[c->pos]=='\t'||s[c->pos]=='\r'||s[c->pos]=='\n'))
+            if (s[c->pos++] == '\n') c->line++;
+        if (c->pos+1 < c->len && s[c->pos]=='/' && s[c->pos+1]=='/'){
+            while (c->pos < c->len && s[c->pos] != '\n') c->pos++;
+            continue;
+        }
+        if (c->pos+1 < c->len && s[c->pos]=='/' && s[c->pos+1]=='*'){
+            c->pos += 2;
+            while (c->pos+1 < c->len && !(s[c->pos]=='*' && s[c->pos+1]=='/')) if (s[c->pos++] == '\n') c->line++;
+            c->pos += 2;
+            continue;
+        }
+        break;
+    }
+    t->len = 0; t->text[0] = 0;
+    if (c->pos >= c->len) { t->t = T_EOF; return; }
+    char ch = s[c->pos];
+    if (is_digit(ch)){
+        uint32_t v = 0;
+        while (c->pos < c->len && is_digit(s[c->pos])) v = v*10u + (uint32_t)(s[c->pos++] - '0');
+        t->t = T_NUM; t->num = (int32_t)v;
+        return;
+    }
+    if (is_alpha(ch)){
+        while (c->pos < c->len && (is_alpha(s[c->pos]) || is_digit(s[c->pos]))){
+            if (t->len < (int)sizeof(t->text)-1) t->text[t->len++] = s[c->pos];
+            c->pos++;
+        }
+        t->text[t->len] = 0;
+        t->t = T_IDENT;
+        for (unsigned i=0; i<sizeof(keywords)/sizeof(keywords[0]); ++i)
+            if (str_eq(t->text, keywords[i].s)) t->t = keywords[i].t;
+        return;
+    }
+    if (ch == '\'' || ch == '"'){
+        c->pos++;
+        while (c->pos < c->len && s[c->pos] != ch && s[c->pos] != '\n'){
+            char v = s[c->pos++];
+            if (v == '\\' && c->pos < c->len){
+                v = s[c->pos++];
+                if (v == 'n') v = '\n'; else if (v == 't') v = '\t';
+            }
+            if (t->len < (int)sizeof(t->text)-1) t->text[t->len++] = v;
+        }
+        if (c->pos >= c->len || s[c->pos] != ch) { t->t = T_BAD; return; }
+        c->pos++;
+        t->text[t->len] = 0;
+        t->t = T_STR;
+        return;
+    }
+    // operators; === and !== are treated as == and !=
+    char n1 = c->pos+1 < c->len ? s[c->pos+1] : 0;
+    c->pos++;
+    t->t = ch;
+    if (ch=='=' && n1=='=') { t->t = T_EQ; c->pos++; if (c->pos < c->len && s[c->pos]=='=') c->pos++; }
+    else if (ch=='!' && n1=='=') { t->t = T_NE; c->pos++; if (c->pos < c->len && s[c->pos]=='=') c->pos++; }
+    else if (ch=='<' && n1=='=') { t->t = T_LE; c->pos++; }
+    else if (ch=='>' && n1=='=') { t->t = T_GE; c->pos++; }
+    else if (ch=='&' && n1=='&') { t->t = T_AND; c->pos++; }
+    else if (ch=='|' && n1=='|') { t->t = T_OR; c->pos++; }
+    else if (ch=='+' && n1=='+') { t->t = T_INC; c->pos++; }
+    else if (ch=='-' && n1=='-') { t->t = T_DEC; c->pos++; }
+    else if (ch=='+' && n1=='=') { t->t = T_PLUSEQ; c->pos++; }
+    else if (ch=='-' && n1=='=') { t->t = T_MINUSEQ; c->pos++; }
+}
+
+static void next(comp_t* c){ lex(c, &c->tk); if (c->tk.t == T_BAD) error(c, "unterminated string"); }
+
+static int peek(comp_t* c){
+    int pos = c->pos, line = c->line;
+    token_t t; lex(c, &t);
+    c->pos = pos; c->line = line;
+    return t.t;
+}
+
+static void expect(comp_t* c, int t, const char* msg){
+    if (c->tk.t != t) { error(c, msg); return; }
+    next(c);
+}
+
+// ---- emission ----
+
+static void emit(comp_t* c, uint8_t b){
+    if (ncode >= SCRIPT_CODE_MAX) { error(c, "program too large"); return; }
+    code[ncode++] = b;
+}
+static void emit32(comp_t* c, uint32_t v){ for (int i=0;i<4;++i) emit(c, (uint8_t)(v >> (i*8))); }
+static uint32_t emit_jump(comp_t* c, uint8_t op){ emit(c, op); uint32_t at = ncode; emit32(c, 0); return at; }
+static void patch(uint32_t at, uint32_t target){ if (at + 4 <= ncode) for (int i=0;i<4;++i) code[at+i] = (uint8_t)(target >> (i*8)); }
+static void emit_jump_to(comp_t* c, uint8_t op, uint32_t target){ emit(c, op); emit32(c, target); }
+
+static const char* pool_str(comp_t* c, const char* s, int len){
+    if (npool + (uint32_t)len + 1 > SCRIPT_POOL_MAX) { error(c, "too many strings"); return ""; }
+    char* p = pool + npool;
+    for (int i=0;i<len;++i) p[i] = s[i];
+    p[len] = 0;
+    npool += (uint32_t)len + 1;
+    return p;
+}
+
+static int global_slot(comp_t* c, const char* name){
+    for (int i=0;i<nglobals;++i) if (str_eq(globals[i].name, name)) return i;
+    if (nglobals == SCRIPT_GLOBALS) { error(c, "too many globals"); return 0; }
+    globals[nglobals].name = pool_str(c, name, str_len(name));
+    globals[nglobals].v.t = V_UNDEF;
+    return nglobals++;
+}
+
+static int find_local(comp_t* c, const char* name){
+    if (!c->in_func) return -1;
+    for (int i=0;i<c->nlocals;++i) if (str_eq(c->locals[i], name)) return i;
+    return -1;
+}
+
+static int add_local(comp_t* c, const char* name){
+    int i = find_local(c, name);
+    if (i >= 0) return i;
+    if (c->nlocals == MAX_LOCALS) { error(c, "too many locals"); return 0; }
+    c->locals[c->nlocals] = pool_str(c, name, str_len(name));
+    return c->nlocals++;
+}
+
+static void emit_load(comp_t* c, const char* name){
+    int l = find_local(c, name);
+    if (l >= 0) { emit(c, OP_LOAD_L); emit(c, (uint8_t)l); }
+    else { emit(c, OP_LOAD_G); emit(c, (uint8_t)global_slot(c, name)); }
+}
+
+static void emit_store(comp_t* c, const char* name){
+    int l = find_local(c, name);
+    if (l >= 0) { emit(c, OP_STORE_L); emit(c, (uint8_t)l); }
+    else { emit(c, OP_STORE_G); emit(c, (uint8_t)global_slot(c, name)); }
+}
+
+// ---- expressions ----
+
+static void expr(comp_t* c);
+
+static int args(comp_t* c){
+    int n = 0;
+    expect(c, '(', "'(' expected");
+    if (c->tk.t != ')'){
+        do { if (n) next(c); expr(c); n++; } while (c->tk.t == ',' && !c->err);
+    }
+    expect(c, ')', "')' expected");
+    if (n > 255) error(c, "too many arguments");
+    return n;
+}
+
+static void primary(comp_t* c){
+    token_t t = c->tk;
+    switch (t.t){
+    case T_NUM: next(c); emit(c, OP_PUSH_INT); emit32(c, (uint32_t)t.num); return;
+    case T_STR: next(c); emit(c, OP_PUSH_STR); emit32(c, (uint32_t)(pool_str(c, t.text, t.len) - pool)); return;
+    case T_TRUE: case T_FALSE: next(c); emit(c, OP_PUSH_INT); emit32(c, t.t == T_TRUE); return;
+    case T_NULL: next(c); emit(c, OP_PUSH_UNDEF); return;
+    case '(': next(c); expr(c); expect(c, ')', "')' expected"); return;
+    case T_IDENT: break;
+    default: error(c, "expression expected"); return;
+    }
+    next(c);
+    if (str_eq(t.text, "console") && c->tk.t == '.'){
+        next(c);
+        if (c->tk.t != T_IDENT || !str_eq(c->tk.text, "log")) { error(c, "only console.log is supported"); return; }
+        next(c);
+        int n = args(c); emit(c, OP_LOG); emit(c, (uint8_t)n);
+        return;
+    }
+    if (str_eq(t.text, "alert") && c->tk.t == '('){
+        int n = args(c); emit(c, OP_ALERT); emit(c, (uint8_t)n);
+        return;
+    }
+    emit_load(c, t.text);
+    if (c->tk.t == T_INC || c->tk.t == T_DEC){
+        // x++ leaves the old value
+        int op = c->tk.t; next(c);
+        emit_load(c, t.text);
+        emit(c, OP_PUSH_INT); emit32(c, 1);
+        emit(c, op == T_INC ? OP_ADD : OP_SUB);
+        emit_store(c, t.text);
+    }
+}
+
+static void postfix(comp_t* c){
+    primary(c);
+    while (c->tk.t == '(' && !c->err){ int n = args(c); emit(c, OP_CALL); emit(c, (uint8_t)n); }
+}
+
+static void unary(comp_t* c){
+    int t = c->tk.t;
+    if (t == '-' || t == '!' || t == '+'){
+        next(c);
+        if (!nest_in(c)) return;
+        unary(c);
+        c->depth--;
+        if (t == '-') emit(c, OP_NEG); else if (t == '!') emit(c, OP_NOT);
+        return;
+    }
+    if (t == T_INC || t == T_DEC){
+        next(c);
+        if (c->tk.t != T_IDENT) { error(c, "name expected after ++/--"); return; }
+        token_t v = c->tk; next(c);
+        emit_load(c, v.text);
+        emit(c, OP_PUSH_INT); emit32(c, 1);
+        emit(c, t == T_INC ? OP_ADD : OP_SUB);
+        emit(c, OP_DUP);
+        emit_store(c, v.text);
+        return;
+    }
+    postfix(c);
+}
+
+static void binary(comp_t* c, int level);
+
+// Precedence levels, loosest first; each entry maps a token to its opcode
+static const struct { int t; uint8_t op; } ops[][4] = {
+    { {T_EQ,OP_EQ}, {T_NE,OP_NE}, {0,0}, {0,0} },
+    { {'<',OP_LT}, {T_LE,OP_LE}, {'>',OP_GT}, {T_GE,OP_GE} },
+    { {'+',OP_ADD}, {'-',OP_SUB}, {0,0}, {0,0} },
+    { {'*',OP_MUL}, {'/',OP_DIV}, {'%',OP_MOD}, {0,0} },
+};
+#define NLEVELS (int)(sizeof(ops)/sizeof(ops[0]))
+
+static void binary(comp_t* c, int level){
+    if (level == NLEVELS) { unary(c); return; }
+    binary(c, level+1);
+    for (;;){
+        uint8_t op = 0;
+        for (int i=0;i<4;++i) if (ops[level][i].t && ops[level][i].t == c->tk.t) op = ops[level][i].op;
+        if (!op || c->err) return;
+        next(c);
+        binary(c, level+1);
+        emit(c, op);
+    }
+}
+
+static void and_expr(comp_t* c){
+    binary(c, 0);
+    while (c->tk.t == T_AND && !c->err){
+        next(c);
+        emit(c, OP_DUP); uint32_t j = emit_jump(c, OP_JZ); emit(c, OP_POP);
+        binary(c, 0);
+        patch(j, ncode);
+    }
+}
+
+static void or_expr(comp_t* c){
+    and_expr(c);
+    while (c->tk.t == T_OR && !c->err){
+        next(c);
+        emit(c, OP_DUP); uint32_t j = emit_jump(c, OP_JNZ); emit(c, OP_POP);
+        and_expr(c);
+        patch(j, ncode);
+    }
+}
+
+static void assign_expr(comp_t* c){
+    if (c->tk.t == T_IDENT){
+        int p = peek(c);
+        if (p == '=' || p == T_PLUSEQ || p == T_MINUSEQ){
+            token_t v = c->tk; next(c); next(c);
+            if (p != '=') emit_load(c, v.text);
+            expr(c);
+            if (p == T_PLUSEQ) emit(c, OP_ADD); else if (p == T_MINUSEQ) emit(c, OP_SUB);
+            emit(c, OP_DUP);
+            emit_store(c, v.text);
+            return;
+        }
+    }
+    or_expr(c);
+}
+
+static void expr(comp_t* c){
+    if (!nest_in(c)) return;
+    assign_expr(c);
+    c->depth--;
+}
+
+// ---- statements ----
+
+static void statement(comp_t* c);
+
+static void semi(comp_t* c){ if (c->tk.t == ';') next(c); }
+
+static void var_decl(comp_t* c){
+    next(c);
+    for (;;){
+        if (c->tk.t != T_IDENT) { error(c, "name expected"); return; }
+        token_t v = c->tk; next(c);
+        if (c->in_func) add_local(c, v.text); else global_slot(c, v.text);
+        if (c->tk.t == '='){ next(c); expr(c); emit_store(c, v.text); }
+        if (c->tk.t != ',' || c->err) return;
+        next(c);
+    }
+}
+
+static void loop_body(comp_t* c, uint32_t cont){
+    if (c->nloops == MAX_LOOPS) { error(c, "loops nested too deeply"); return; }
+    c->loops[c->nloops].cont = cont;
+    c->loops[c->nloops].nbreaks = 0;
+    c->nloops++;
+    statement(c);
+    emit_jump_to(c, OP_JMP, cont);
+}
+
+static void loop_end(comp_t* c){
+    c->nloops--;
+    for (int i=0;i<c->loops[c->nloops].nbreaks;++i) patch(c->loops[c->nloops].breaks[i], ncode);
+}
+
+static void function_decl(comp_t* c){
+    if (c->in_func) { error(c, "nested functions are not supported"); return; }
+    next(c);
+    if (c->tk.t != T_IDENT) { error(c, "function name expected"); return; }
+    if (nfuncs == SCRIPT_FUNCS) { error(c, "too many functions"); return; }
+    int fn = nfuncs++;
+    // hoisted: the name is bound before any code runs
+    int g = global_slot(c, c->tk.text);
+    globals[g].v.t = V_FN; globals[g].v.i = fn;
+    next(c);
+    uint32_t skip = emit_jump(c, OP_JMP);
+    funcs[fn].entry = ncode;
+    // break/continue in the body must not reach a loop around the
+    // declaration; the body's own loops stack above the outer ones
+    int outer_base = c->loop_base;
+    c->in_func = 1; c->nlocals = 0; c->loop_base = c->nloops;
+    expect(c, '(', "'(' expected");
+    while (c->tk.t == T_IDENT && !c->err){
+        add_local(c, c->tk.text); next(c);
+        if (c->tk.t == ',') next(c);
+    }
+    funcs[fn].nparams = (uint8_t)c->nlocals;
+    expect(c, ')', "')' expected");
+    if (c->tk.t != '{') error(c, "'{' expected");
+    statement(c);
+    emit(c, OP_PUSH_UNDEF); emit(c, OP_RET);
+    funcs[fn].nlocals = (uint8_t)c->nlocals;
+    c->in_func = 0; c->loop_base = outer_base;
+    patch(skip, ncode);
+}
+
+static void statement_body(comp_t* c){
+    switch (c->tk.t){
+    case '{':
+        next(c);
+        while (c->tk.t != '}' && c->tk.t != T_EOF && !c->err) statement(c);
+        expect(c, '}', "'}' expected");
+        return;
+    case ';': next(c); return;
+    case T_VAR: var_decl(c); semi(c); return;
+    case T_FUNCTION: function_decl(c); return;
+    case T_IF: {
+        next(c); expect(c, '(', "'(' expected"); expr(c); expect(c, ')', "')' expected");
+        uint32_t jelse = emit_jump(c, OP_JZ);
+        statement(c);
+        if (c->tk.t == T_ELSE){
+            uint32_t jend = emit_jump(c, OP_JMP);
+            patch(jelse, ncode);
+            next(c); statement(c);
+            patch(jend, ncode);
+        } else patch(jelse, ncode);
+        return;
+    }
+    case T_WHILE: {
+        next(c); expect(c, '(', "'(' expected");
+        uint32_t top = ncode;
+        expr(c); expect(c, ')', "')' expected");
+        uint32_t jend = emit_jump(c, OP_JZ);
+        loop_body(c, top);
+        patch(jend, ncode);
+        loop_end(c);
+        return;
+    }
+    case T_FOR: {
+        // init; cond: JZ end, JMP body; step: JMP cond; body: JMP step
+        next(c); expect(c, '(', "'(' expected");
+        if (c->tk.t == T_VAR) var_decl(c);
+        else if (c->tk.t != ';') { expr(c); emit(c, OP_POP); }
+        expect(c, ';', "';' expected");
+        uint32_t cond = ncode;
+        if (c->tk.t != ';') expr(c); else { emit(c, OP_PUSH_INT); emit32(c, 1); }
+        expect(c, ';', "';' expected");
+        uint32_t jend = emit_jump(c, OP_JZ);
+        uint32_t jbody = emit_jump(c, OP_JMP);
+        uint32_t step = ncode;
+        if (c->tk.t != ')') { expr(c); emit(c, OP_POP); }
+        expect(c, ')', "')' expected");
+        emit_jump_to(c, OP_JMP, cond);
+        patch(jbody, ncode);
+        loop_body(c, step);
+        patch(jend, ncode);
+        loop_end(c);
+        return;
+    }
+    case T_BREAK: case T_CONTINUE: {
+        int brk = c->tk.t == T_BREAK;
+        next(c); semi(c);
+        if (c->nloops == c->loop_base) { error(c, brk ? "break outside a loop" : "continue outside a loop"); return; }
+        if (!brk) { emit_jump_to(c, OP_JMP, c->loops[c->nloops-1].cont); return; }
+        if (c->loops[c->nloops-1].nbreaks == MAX_BREAKS) { error(c, "too many breaks in one loop"); return; }
+        c->loops[c->nloops-1].breaks[c->loops[c->nloops-1].nbreaks++] = emit_jump(c, OP_JMP);
+        return;
+    }
+    case T_RETURN:
+        if (!c->in_func) { error(c, "return outside a function"); return; }
+        next(c);
+        if (c->tk.t == ';' || c->tk.t == '}' || c->tk.t == T_EOF) emit(c, OP_PUSH_UNDEF); else expr(c);
+        emit(c, OP_RET);
+        semi(c);
+        return;
+    default:
+        expr(c); emit(c, OP_POP); semi(c);
+        return;
+    }
+}
+
+static void statement(comp_t* c){
+    if (c->err || !nest_in(c)) return;
+    statement_body(c);
+    c->depth--;
+}
+
+// ---- VM ----
+
+static int truthy(const value_t* v){
+    switch (v->t){
+    case V_INT: return v->i != 0;
+    case V_STR: return v->s[0] != 0;
+    case V_FN:  return 1;
+    default:    return 0;
+    }
+}
+
+static const char* to_str(const value_t* v, char* buf){
+    switch (v->t){
+    case V_INT: itoa_s(v->i, buf); return buf;
+    case V_STR: return v->s;
+    case V_FN:  return "function";
+    default:    return "undefined";
+    }
+}
+
+static int rt_error(const char* msg){
+    emit_line("script error: ", msg);
+    stats.errors++;
+    return -1;
+}
+
+static int print_args(value_t* a, int n){
+    char line[160]; int len = 0; char nb[12];
+    for (int i=0;i<n;++i){
+        const char* s = to_str(&a[i], nb);
+        if (i && len < (int)sizeof(line)) line[len++] = ' ';
+        while (*s && len < (int)sizeof(line)) line[len++] = *s++;
+    }
+    g_out(g_ctx, line, len);
+    return 0;
+}
+
+static int run(uint32_t pc){
+    static value_t st[SCRIPT_STACK];
+    static struct { uint32_t ret; int bp; } frames[SCRIPT_FRAMES];
+    int sp = 0, fp = 0, bp = 0;
+    uint32_t budget = SCRIPT_BUDGET;
+#define NEED(n) do { if (sp < (n)) return rt_error("stack underflow"); } while (0)
+#define ROOM(n) do { if (sp + (n) > SCRIPT_STACK) return rt_error("stack overflow"); } while (0)
+#define ARG32() (uint32_t)(code[pc] | code[pc+1] << 8 | code[pc+2] << 16 | (uint32_t)code[pc+3] << 24)
+    for (;;){
+        if (!budget--) return rt_error("instruction budget exhausted");
+        stats.insns++;
+        uint8_t op = code[pc++];
+        switch (op){
+        case OP_HALT: return 0;
+        case OP_PUSH_INT: ROOM(1); st[sp].t = V_INT; st[sp].i = (int32_t)ARG32(); sp++; pc += 4; break;
+        case OP_PUSH_STR: ROOM(1); st[sp].t = V_STR; st[sp].s = pool + ARG32(); sp++; pc += 4; break;
+        case OP_PUSH_UNDEF: ROOM(1); st[sp++].t = V_UNDEF; break;
+        case OP_POP: NEED(1); sp--; break;
+        case OP_DUP: NEED(1); ROOM(1); st[sp] = st[sp-1]; sp++; break;
+        case OP_LOAD_G: ROOM(1); st[sp++] = globals[code[pc++]].v; break;
+        case OP_STORE_G: NEED(1); globals[code[pc++]].v = st[--sp]; break;
+        case OP_LOAD_L: ROOM(1); st[sp++] = st[bp + code[pc++]]; break;
+        case OP_STORE_L: NEED(1); st[bp + code[pc++]] = st[--sp]; break;
+        case OP_ADD: {
+            NEED(2);
+            value_t* a = &st[sp-2]; value_t* b = &st[sp-1];
+            if (a->t == V_INT && b->t == V_INT) { a->i = (int32_t)((uint32_t)a->i + (uint32_t)b->i); sp--; break; }
+            // either side a string (or undefined): concatenate
+            char n1[12], n2[12];
+            const char* x = to_str(a, n1); const char* y = to_str(b, n2);
+            int lx = str_len(x), ly = str_len(y);
+            if (nheap + (uint32_t)(lx + ly + 1) > SCRIPT_HEAP_MAX) return rt_error("out of string memory");
+            char* r = heap + nheap;
+            for (int i=0;i<lx;++i) r[i] = x[i];
+            for (int i=0;i<ly;++i) r[lx+i] = y[i];
+            r[lx+ly] = 0;
+            nheap += (uint32_t)(lx + ly + 1);
+            a->t = V_STR; a->s = r; sp--;
+            break;
+        }
+        case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: {
+            NEED(2);
+            value_t* a = &st[sp-2]; value_t* b = &st[sp-1];
+            if (a->t != V_INT || b->t != V_INT) return rt_error("number expected");
+            if ((op == OP_DIV || op == OP_MOD) && b->i == 0) return rt_error("division by zero");
+            if ((op == OP_DIV || op == OP_MOD) && b->i == -1) a->i = op == OP_DIV ? (int32_t)(0u - (uint32_t)a->i) : 0;
+            else if (op == OP_SUB) a->i = (int32_t)((uint32_t)a->i - (uint32_t)b->i);
+            else if (op == OP_MUL) a->i = (int32_t)((uint32_t)a->i * (uint32_t)b->i);
+            else if (op == OP_DIV) a->i /= b->i;
+            else a->i %= b->i;
+            sp--;
+            break;
+        }
+        case OP_NEG: NEED(1); if (st[sp-1].t != V_INT) return rt_error("number expected"); st[sp-1].i = (int32_t)(0u - (uint32_t)st[sp-1].i); break;
+        case OP_NOT: NEED(1); st[sp-1].i = !truthy(&st[sp-1]); st[sp-1].t = V_INT; break;
+        case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE: {
+            NEED(2);
+            value_t* a = &st[sp-2]; value_t* b = &st[sp-1];
+            int r;
+            if (a->t == V_INT && b->t == V_INT) r = a->i < b->i ? -1 : a->i > b->i;
+            else if (a->t == V_STR && b->t == V_STR) r = str_cmp(a->s, b->s);
+            else if (op == OP_EQ || op == OP_NE) r = !(a->t == b->t && (a->t == V_UNDEF || a->i == b->i));
+            else return rt_error("cannot compare");
+            switch (op){
+            case OP_EQ: r = r == 0; break; case OP_NE: r = r != 0; break;
+            case OP_LT: r = r < 0; break;  case OP_LE: r = r <= 0; break;
+            case OP_GT: r = r > 0; break;  default: r = r >= 0; break;
+            }
+            a->t = V_INT; a->i = r; sp--;
+            break;
+        }
+        case OP_JMP: pc = ARG32(); break;
+        case OP_JZ: NEED(1); pc = truthy(&st[--sp]) ? pc + 4 : ARG32(); break;
+        case OP_JNZ: NEED(1); pc = truthy(&st[--sp]) ? ARG32() : pc + 4; break;
+        case OP_CALL: {
+            int argc = code[pc++];
+            NEED(argc + 1);
+            value_t* f = &st[sp - argc - 1];
+            if (f->t != V_FN) return rt_error("not a function");
+            if (fp == SCRIPT_FRAMES) return rt_error("call depth exceeded");
+            int np = funcs[f->i].nparams, nl = funcs[f->i].nlocals;
+            // arguments become the first locals; pad or drop to nparams
+            while (argc > np) { sp--; argc--; }
+            ROOM(nl - argc);
+            while (argc < nl) { st[sp++].t = V_UNDEF; argc++; }
+            frames[fp].ret = pc; frames[fp].bp = bp; fp++;
+            bp = sp - nl;
+            pc = funcs[f->i].entry;
+            break;
+        }
+        case OP_RET: {
+            NEED(1);
+            if (!fp) return rt_error("return outside a function");
+            value_t r = st[sp-1];
+            sp = bp - 1;          // drop locals and the callee
+            st[sp++] = r;
+            fp--; pc = frames[fp].ret; bp = frames[fp].bp;
+            break;
+        }
+        case OP_LOG: case OP_ALERT: {
+            int argc = code[pc++];
+            NEED(argc);
+            print_args(&st[sp - argc], argc);
+            sp -= argc;
+            st[sp++].t = V_UNDEF;
+            break;
+        }
+        default: return rt_error("bad opcode");
+        }
+    }
+#undef NEED
+#undef ROOM
+#undef ARG32
+}
+
+int script_exec(const char* src, int len){
+    comp_t c;
+    c.src = src; c.len = len; c.pos = 0; c.line = 1;
+    c.err = 0; c.err_line = 0; c.in_func = 0; c.depth = 0; c.nlocals = 0; c.nloops = 0; c.loop_base = 0;
+    stats.scripts++;
+    uint32_t start = ncode;
+    int funcs_before = nfuncs;
+    next(&c);
+    while (c.tk.t != T_EOF && !c.err) statement(&c);
+    emit(&c, OP_HALT);
+    stats.code_bytes = ncode;
+    if (c.err){
+        // unbind functions whose bodies may be incomplete
+        for (int g=0; g<nglobals; ++g)
+            if (globals[g].v.t == V_FN && globals[g].v.i >= funcs_before) globals[g].v.t = V_UNDEF;
+        char msg[96] = "script error: line "; int n = str_len(msg);
+        n += itoa_s(c.err_line, msg + n);
+        msg[n++] = ':'; msg[n++] = ' '; msg[n] = 0;
+        emit_line(msg, c.err);
+        stats.errors++;
+        return -1;
+    }
+    return run(start);
+}
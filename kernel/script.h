@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+// Tiny scripting engine for <script> in rendered documents. A single-pass
+// compiler turns a JavaScript subset into bytecode for a stack VM:
+//   var/let/const, = += -= ++ --, + - * / % (32-bit ints), string
+//   concatenation with +, == != < <= > >= && || !, if/else, while, for,
+//   break/continue, function declarations (hoisted) with locals and return,
+//   console.log(...) and alert(...).
+// Scripts of one document share globals: script_begin resets them, then each
+// <script> block is compiled once by script_exec and run. Execution stops
+// after SCRIPT_BUDGET instructions so a runaway loop cannot hang the kernel.
+
+#define SCRIPT_BUDGET     1000000u   // instructions per script_exec
+#define SCRIPT_CODE_MAX   16384      // bytecode bytes per document
+#define SCRIPT_POOL_MAX   8192       // names and string constants per document
+#define SCRIPT_HEAP_MAX   32768      // strings built at run time per document
+#define SCRIPT_GLOBALS    128
+#define SCRIPT_FUNCS      64
+#define SCRIPT_STACK      256
+#define SCRIPT_FRAMES     32
+
+// Output sink for console.log/alert: one call per printed line
+typedef void (*script_out_fn)(void* ctx, const char* s, int len);
+
+typedef struct {
+    uint32_t scripts;       // script_exec calls since script_begin
+    uint32_t errors;
+    uint32_t code_bytes;
+    uint32_t insns;         // instructions executed
+} script_stats_t;
+
+void script_begin(script_out_fn out, void* ctx);
+// Compile and run one script. 0 ok; <0 compile or runtime error (a
+// "script error: ..." line has been written to the sink)
+int script_exec(const char* src, int len);
+const script_stats_t* script_stats(void);
@@ -1,12 +1,52 @@
 #include "serial.h"
 #include "io.h"
+#include "idt.h"
 
 #define COM1_BASE 0x3F8
+#define COM1_IRQ 4
+#define UART_FIFO 16
+
+static volatile char tx_ring[SERIAL_TX_RING];
+static volatile uint32_t tx_head = 0, tx_tail = 0; // head = next write
+static volatile int tx_busy = 0;  // FIFO loaded; THRE interrupt will refill
+static int tx_irq = 0;
+static uint32_t tx_dropped = 0;
 
 static inline void com1_wait_tx_empty(void){
     while ((inb(COM1_BASE + 5) & 0x20) == 0) { }
 }
 
+static inline int com1_tx_empty(void){ return (inb(COM1_BASE + 5) & 0x20) != 0; }
+
+// Move up to one FIFO load from the ring to the UART. Interrupts off.
+static void tx_fill_fifo(void){
+    int n = 0;
+    while (n < UART_FIFO && tx_tail != tx_head) {
+        outb(COM1_BASE, (uint8_t)tx_ring[tx_tail & (SERIAL_TX_RING-1)]);
+        tx_tail++; n++;
+    }
+    tx_busy = (n > 0);
+}
+
+static void tx_enqueue(char c){
+    if (tx_head - tx_tail >= SERIAL_TX_RING) { tx_dropped++; return; }
+    tx_ring[tx_head & (SERIAL_TX_RING-1)] = c;
+    tx_head++;
+}
+
+static void com1_irq(int irq){
+    (void)irq;
+    uint8_t iir;
+    while (((iir = inb(COM1_BASE + 2)) & 0x01) == 0) {
+        switch ((iir >> 1) & 0x07) {
+        case 1: tx_fill_fifo(); break;          // THR empty
+        case 2: case 6: (void)inb(COM1_BASE); break; // RX data / timeout
+        case 3: (void)inb(COM1_BASE + 5); break; // line status
+        default: (void)inb(COM1_BASE + 6); break; // modem status
+        }
+    }
+}
+
 void serial_init(void){
     // Disable interrupts
     outb(COM1_BASE + 1, 0x00);
@@ -19,23 +59,67 @@ void serial_init(void){
     outb(COM1_BASE + 3, 0x03);
     // Enable FIFO, clear them, 14-byte threshold
     outb(COM1_BASE + 2, 0xC7);
-    // Modem control: RTS/DSR set
+    // Modem control: DTR, RTS, OUT2 (routes the UART interrupt to the PIC)
     outb(COM1_BASE + 4, 0x0B);
+    tx_head = tx_tail = 0; tx_busy = 0; tx_irq = 0;
+}
+
+void serial_enable_irq(void){
+    uint32_t f = irq_save();
+    tx_irq = 1;
+    irq_register(COM1_IRQ, com1_irq);
+    outb(COM1_BASE + 1, 0x02); // THRE interrupt only
+    if (com1_tx_empty()) tx_fill_fifo(); else tx_busy = 1;
+    irq_restore(f);
 }
 
 void serial_putc(char c){
-    if (c == '\n') {
-        com1_wait_tx_empty(); outb(COM1_BASE, '\r');
-    }
-    com1_wait_tx_empty();
-    outb(COM1_BASE, (uint8_t)c);
+    uint32_t f = irq_save();
+    if (c == '\n') tx_enqueue('\r');
+    tx_enqueue(c);
+    // Before IRQ4 is live, top up the FIFO whenever it has drained; leftovers
+    // wait in the ring for serial_enable_irq or serial_flush
+    if (tx_irq ? !tx_busy : com1_tx_empty()) tx_fill_fifo();
+    irq_restore(f);
+}
+
+void serial_putc_wait(char c){
+    uint32_t f = irq_save();
+    // Room for "\r\n"; push a FIFO load by hand, the IRQ may be masked here
+    while (SERIAL_TX_RING - (tx_head - tx_tail) < 2) { com1_wait_tx_empty(); tx_fill_fifo(); }
+    irq_restore(f);
+    serial_putc(c);
 }
 
 void serial_write(const char* s){
     while (*s) serial_putc(*s++);
 }
 
+void serial_write_wait(const char* s){
+    while (*s) serial_putc_wait(*s++);
+}
+
 void serial_writeln(const char* s){
     serial_write(s);
     serial_putc('\n');
 }
+
+void serial_flush(void){
+    uint32_t f = irq_save();
+    while (tx_tail != tx_head) { com1_wait_tx_empty(); tx_fill_fifo(); }
+    com1_wait_tx_empty();
+    irq_restore(f);
+}
+
+void serial_write_sync(const char* s){
+    uint32_t f = irq_save();
+    serial_flush();
+    for (; *s; ++s) {
+        if (*s == '\n') { com1_wait_tx_empty(); outb(COM1_BASE, '\r'); }
+        com1_wait_tx_empty(); outb(COM1_BASE, (uint8_t)*s);
+    }
+    com1_wait_tx_empty();
+    irq_restore(f);
+}
+
+uint32_t serial_tx_dropped(void){ return tx_dropped; }
@@ -1,7 +1,22 @@
 #pragma once
 #include <stdint.h>
 
+// COM1 output is buffered in a TX ring and drained by the UART's THRE
+// interrupt, 16 bytes (one FIFO load) at a time. Writers never spin; when
+// the ring is full new bytes are dropped and counted.
+#define SERIAL_TX_RING 4096
+
 void serial_init(void);
+void serial_enable_irq(void);   // after idt_init: drain via IRQ4
 void serial_putc(char c);
+// Like serial_putc, but waits for ring space instead of dropping
+void serial_putc_wait(char c);
 void serial_write(const char* s);
+void serial_write_wait(const char* s);   // serial_putc_wait per byte
 void serial_writeln(const char* s);
+
+// Synchronous paths for panic/reboot: interrupts off, spin until sent
+void serial_flush(void);
+void serial_write_sync(const char* s);
+
+uint32_t serial_tx_dropped(void);
@@ -0,0 +1,343 @@
+#include <stdint.h>
+#include "shell.h"
+#include "console.h"
+#include "vfs.h"
+
+// Sorted by name for binary search; registration is an insertion
+static const shell_cmd_t* cmds[SHELL_MAX_CMDS];
+static int ncmds = 0;
+static char cwd[SHELL_PATH_MAX] = "/";
+
+static int str_cmp(const char* a, const char* b){ while (*a && *a == *b) { a++; b++; } return (unsigned char)*a - (unsigned char)*b; }
+int shell_streq(const char* a, const char* b){ return str_cmp(a, b) == 0; }
+
+void u32_to_dec(uint32_t v, char* buf){ int n=0; if(v==0){ buf[n++]='0'; buf[n]=0; return; } char tmp[16]; int t=0; while(v){ tmp[t++] = (char)('0'+(v%10)); v/=10; } while(t--) buf[n++]=tmp[t]; buf[n]=0; }
+
+// Parse decimal uint32 from token (null-terminated)
+int parse_u32_dec(const char* s, uint32_t* out){ if(!s||!*s) return -1; uint32_t v=0; for(int i=0; s[i]; ++i){ char c=s[i]; if(c<'0'||c>'9') return -2; uint32_t d=(uint32_t)(c-'0'); uint32_t nv = v*10u + d; if (nv < v) return -3; v = nv; } *out=v; return 0; }
+// Parse hex byte from 1-2 hex digits
+int parse_hex8(const char* s, uint8_t* out){ if(!s||!*s) return -1; uint32_t v=0; int i=0; for(; s[i] && i<2; ++i){ char c=s[i]; if(c>='0'&&c<='9') v = (v<<4) | (uint32_t)(c-'0'); else { char lc = (c>='A'&&c<='Z')?(c+32):c; if(lc>='a'&&lc<='f') v = (v<<4) | (uint32_t)(10 + lc-'a'); else return -2; } } if(s[i]) return -3; *out=(uint8_t)v; return 0; }
+
+static const shell_cmd_t* lookup(const char* name){
+    int lo = 0, hi = ncmds - 1;
+    while (lo <= hi){
+        int mid = (lo + hi) / 2;
+        int c = str_cmp(name, cmds[mid]->name);
+        if (c == 0) return cmds[mid];
+        if (c < 0) hi = mid - 1; else lo = mid + 1;
+    }
+    return 0;
+}
+
+int shell_register(const shell_cmd_t* cmd){
+    if (lookup(cmd->name)) return -2;       // before shifting anything
+    if (ncmds == SHELL_MAX_CMDS) return -1;
+    int i = ncmds;
+    while (i > 0 && str_cmp(cmds[i-1]->name, cmd->name) > 0){
+        cmds[i] = cmds[i-1];
+        i--;
+    }
+    cmds[i] = cmd;
+    ncmds++;
+    return 0;
+}
+
+// ---- pipeline state ----
+
+typedef struct {
+    const shell_cmd_t* cmd;
+    int argc;
+    char* argv[SHELL_MAX_ARGS + 1];
+    int filter;                             // fed from the previous stage or '<'
+    uint64_t state[SHELL_FILTER_STATE / 8];
+    char ring[SHELL_PIPE_BYTES];            // this stage's output, ahead of its reader
+    uint32_t rd, wr;                        // free-running; wr - rd bytes queued
+} stage_t;
+
+static stage_t stages[SHELL_MAX_STAGES];
+static int nstages = 0;                     // 0: no pipeline, output goes to the console
+static int cur = 0;                         // stage whose output sh_write* receives
+static const char* out_path = 0;            // '>'/'>>' target of the last stage
+static int out_failed = 0;
+
+// Hand everything queued in stage i's ring to its reader, one contiguous
+// span at a time, without copying it out of the ring
+static void drain(int i){
+    stage_t* s = &stages[i];
+    while (s->wr != s->rd){
+        uint32_t off = s->rd % SHELL_PIPE_BYTES;
+        uint32_t n = s->wr - s->rd;
+        if (n > SHELL_PIPE_BYTES - off) n = SHELL_PIPE_BYTES - off;
+        if (i + 1 < nstages){
+            int prev = cur; cur = i + 1;
+            stages[i+1].cmd->filter->feed(stages[i+1].state, s->ring + off, (int)n);
+            cur = prev;
+        } else if (!out_failed && vfs_append(out_path, s->ring + off, n) != 0){
+            out_failed = 1;
+        }
+        s->rd += n;
+    }
+}
+
+void sh_write_n(const char* p, int n){
+    // The last stage writes straight to the console unless redirected
+    if (!nstages || (cur == nstages - 1 && !out_path)){ for (int i = 0; i < n; ++i) console_putc(p[i]); return; }
+    stage_t* s = &stages[cur];
+    while (n > 0){
+        if (s->wr - s->rd == SHELL_PIPE_BYTES) drain(cur);
+        uint32_t off = s->wr % SHELL_PIPE_BYTES;
+        uint32_t room = SHELL_PIPE_BYTES - (s->wr - s->rd);
+        uint32_t k = SHELL_PIPE_BYTES - off < room ? SHELL_PIPE_BYTES - off : room;
+        if (k > (uint32_t)n) k = (uint32_t)n;
+        for (uint32_t i = 0; i < k; ++i) s->ring[off + i] = p[i];
+        s->wr += k; p += k; n -= (int)k;
+    }
+}
+
+void sh_write(const char* s){ int n = 0; while (s[n]) n++; sh_write_n(s, n); }
+void sh_writeln(const char* s){ sh_write(s); sh_write_n("\n", 1); }
+void sh_putc(char c){ sh_write_n(&c, 1); }
+
+void sh_put_col(const char* s, int width, int right){
+    int n = 0; while (s[n]) n++;
+    if (!right) sh_write(s);
+    for (; n < width; ++n) sh_putc(' ');
+    if (right) sh_write(s);
+}
+
+// ---- parsing ----
+
+// Operator tokens are these exact arrays, so a quoted "|" stays a word
+static char op_pipe[] = "|", op_in[] = "<", op_out[] = ">", op_app[] = ">>";
+
+// Split on blanks in place; '...' and "..." group words, and unquoted
+// | < > >> are tokens of their own. Returns the token count
+static int tokenize(char* s, char** argv, int max){
+    int argc = 0;
+    char* w = s;                // write cursor; trails s by the quotes dropped
+    char pend = 0;              // operator whose char a terminator overwrote
+    for (;;){
+        if (!pend) while (*s == ' ' || *s == '\t') s++;
+        if (argc == max) break;
+        char op = pend ? pend : (*s == '|' || *s == '<' || *s == '>') ? *s++ : 0;
+        pend = 0;
+        if (op){
+            if (op == '>' && *s == '>') { argv[argc++] = op_app; s++; }
+            else argv[argc++] = op == '|' ? op_pipe : op == '<' ? op_in : op_out;
+            w = s;
+            continue;
+        }
+        if (!*s) break;
+        char* start = w;
+        while (*s && *s != ' ' && *s != '\t' && *s != '|' && *s != '<' && *s != '>'){
+            if (*s == '"' || *s == '\''){
+                char q = *s++;
+                while (*s && *s != q) *w++ = *s++;
+                if (*s) s++;
+            } else *w++ = *s++;
+        }
+        char next = *s;
+        if (next) s++;
+        if (next == '|' || next == '<' || next == '>') pend = next;
+        *w++ = 0;
+        argv[argc++] = start;
+    }
+    argv[argc] = 0;
+    return argc;
+}
+
+static int pipeline_error(const char* msg){ console_writeln(msg); return -2; }
+
+static void lower(char* p){ for (; *p; ++p) if (*p >= 'A' && *p <= 'Z') *p = (char)(*p + 32); }
+
+int shell_exec(char* line){
+    // One pipeline at a time: the stages are static
+    if (nstages) return pipeline_error("shell: cannot run commands from inside a pipeline");
+    char* tok[SHELL_MAX_STAGES * (SHELL_MAX_ARGS + 2) + 1];
+    int ntok = tokenize(line, tok, (int)(sizeof(tok)/sizeof(tok[0])) - 1);
+    if (!ntok) return 0;
+
+    // Split into stages and pull out the redirects
+    const char* in_path = 0; const char* outp = 0; int append = 0;
+    int n = 0;
+    stage_t* st = &stages[0];
+    st->argc = 0;
+    for (int i = 0; i < ntok; ++i){
+        char* t = tok[i];
+        if (t == op_pipe){
+            if (!st->argc || outp) return pipeline_error("shell: bad pipeline");
+            if (++n == SHELL_MAX_STAGES) return pipeline_error("shell: too many pipeline stages");
+            st = &stages[n]; st->argc = 0;
+        } else if (t == op_in || t == op_out || t == op_app){
+            char* f = i + 1 < ntok ? tok[i+1] : 0;
+            if (!f || f == op_pipe || f == op_in || f == op_out || f == op_app) return pipeline_error("shell: redirect needs a file name");
+            if (t == op_in){ if (n || in_path) return pipeline_error("shell: '<' only applies to the first command"); in_path = f; }
+            else { if (outp) return pipeline_error("shell: only one output redirect"); outp = f; append = t == op_app; }
+            i++;
+        } else {
+            if (st->argc == SHELL_MAX_ARGS) return pipeline_error("shell: too many arguments");
+            st->argv[st->argc++] = t;
+        }
+    }
+    if (!st->argc) return pipeline_error("shell: bad pipeline");
+    int count = n + 1;
+
+    for (int i = 0; i < count; ++i){
+        stage_t* s = &stages[i];
+        s->argv[s->argc] = 0;
+        lower(s->argv[0]);
+        s->cmd = lookup(s->argv[0]);
+        if (!s->cmd){ console_write(s->argv[0]); console_writeln(": unknown command (try help)"); return -127; }
+        s->filter = i > 0 || in_path || !s->cmd->fn;
+        if (s->filter && !s->cmd->filter){ console_write(s->argv[0]); console_writeln(": does not read input"); return -2; }
+        s->rd = s->wr = 0;
+        for (unsigned k = 0; k < sizeof(s->state)/sizeof(s->state[0]); ++k) s->state[k] = 0;
+    }
+
+    // Open the redirect target before anything runs
+    char inbuf[SHELL_PATH_MAX], outbuf[SHELL_PATH_MAX];
+    if (in_path){ vfs_stat_t vs; shell_path(inbuf, in_path); if (vfs_stat(inbuf, &vs) != 0 || vs.isDir) return pipeline_error("shell: input file not found"); }
+    if (outp){
+        shell_path(outbuf, outp);
+        if (!append && vfs_write(outbuf, "", 0) != 0) return pipeline_error("shell: cannot create output file");
+    }
+
+    // Single plain command: nothing to plumb
+    if (count == 1 && !stages[0].filter && !outp) return stages[0].cmd->fn(stages[0].argc, stages[0].argv);
+
+    nstages = count; cur = 0; out_path = outp ? outbuf : 0; out_failed = 0;
+    int rc = 0;
+    for (int i = 0; i < count && rc >= 0; ++i){
+        if (stages[i].filter && stages[i].cmd->filter->begin){
+            cur = i;
+            if (stages[i].cmd->filter->begin(stages[i].state, stages[i].argc, stages[i].argv) < 0) rc = -2;
+        }
+    }
+    if (rc >= 0){
+        cur = 0;
+        if (!stages[0].filter) rc = stages[0].cmd->fn(stages[0].argc, stages[0].argv);
+        else if (in_path){
+            char block[512]; uint32_t off = 0, got = 0;
+            while (vfs_read_at(inbuf, off, block, sizeof(block), &got) == 0 && got){
+                stages[0].cmd->filter->feed(stages[0].state, block, (int)got);
+                off += got;
+            }
+        }
+        // Flush front to back: each stage ends once its input is drained
+        for (int i = 0; i < count; ++i){
+            if (stages[i].filter && stages[i].cmd->filter->end){ cur = i; stages[i].cmd->filter->end(stages[i].state); }
+            drain(i);
+        }
+    }
+    nstages = 0; cur = 0; out_path = 0;
+    if (out_failed) { console_writeln("shell: write to output file failed"); return -2; }
+    return rc;
+}
+
+static int run_depth = 0;
+
+static void run_line(char* line, int n, int* failed){
+    line[n] = 0;
+    int i = 0; while (line[i] == ' ' || line[i] == '\t') i++;
+    if (!line[i] || line[i] == '#') return;
+    sh_write("foxos> "); sh_writeln(line + i);
+    if (shell_exec(line + i) < 0) (*failed)++;
+}
+
+int shell_run_file(const char* path){
+    if (nstages) return pipeline_error("run: cannot run a script inside a pipeline");
+    if (run_depth == SHELL_RUN_DEPTH) return pipeline_error("run: scripts nested too deep");
+    char p[SHELL_PATH_MAX]; shell_path(p, path);
+    vfs_stat_t st;
+    if (vfs_stat(p, &st) != 0 || st.isDir) return -1;
+    run_depth++;
+    char block[512], line[SHELL_LINE_MAX]; uint32_t off = 0, got = 0; int n = 0, failed = 0;
+    while (vfs_read_at(p, off, block, sizeof(block), &got) == 0 && got){
+        off += got;
+        for (uint32_t i = 0; i < got; ++i){
+            char c = block[i];
+            if (c == '\n'){ run_line(line, n, &failed); n = 0; }
+            else if (c != '\r' && n < SHELL_LINE_MAX - 1) line[n++] = c;
+        }
+    }
+    if (n) run_line(line, n, &failed);
+    run_depth--;
+    return failed;
+}
+
+static void help_row(const char* u, int ul, const char* h, int hl){
+    char row[CONSOLE_COLS]; int n = 0;
+    row[n++] = ' '; row[n++] = ' ';
+    for (int i = 0; i < ul && n < CONSOLE_COLS - 1; ++i) row[n++] = u[i];
+    while (n < 23) row[n++] = ' ';
+    if (hl){ row[n++] = '-'; row[n++] = ' '; }
+    for (int i = 0; i < hl && n < CONSOLE_COLS - 1; ++i) row[n++] = h[i];
+    row[n] = 0;
+    sh_writeln(row);
+}
+
+void shell_help(void){
+    sh_writeln("commands:");
+    for (int i = 0; i < ncmds; ++i){
+        const char* u = cmds[i]->usage ? cmds[i]->usage : cmds[i]->name;
+        const char* h = cmds[i]->help ? cmds[i]->help : "";
+        while (*u || *h){
+            int ul = 0, hl = 0;
+            while (u[ul] && u[ul] != '\n') ul++;
+            while (h[hl] && h[hl] != '\n') hl++;
+            help_row(u, ul, h, hl);
+            u += ul; if (*u) u++;
+            h += hl; if (*h) h++;
+        }
+    }
+}
+
+const char* shell_cwd(void){ return cwd; }
+
+int shell_chdir(const char* path){
+    char p[SHELL_PATH_MAX]; shell_path(p, path);
+    vfs_stat_t st;
+    if (vfs_stat(p, &st) != 0 || !st.isDir) return -1;
+    int i = 0; while (p[i]) { cwd[i] = p[i]; i++; } cwd[i] = 0;
+    return 0;
+}
+
+// Simple path resolver relative to CWD. Supports '.' and '..'.
+void shell_path(char* out, const char* in){
+    // if absolute
+    if (in && *in=='/') {
+        int i=0; while(in[i] && i<SHELL_PATH_MAX-1){ out[i]=in[i]; i++; } out[i]=0;
+    } else {
+        // start with cwd
+        int k=0; while(cwd[k]){ out[k]=cwd[k]; k++; }
+        if (k==0) out[k++]='/';
+        if (in && *in){ if (out[k-1]!='/') out[k++]='/'; int i=0; while(in[i] && k<SHELL_PATH_MAX-1) out[k++]=in[i++]; }
+        out[k]=0;
+    }
+    // normalize: process segments, handling '.' and '..'
+    char tmp[SHELL_PATH_MAX]; int ti=1; int i=0;
+    tmp[0]='/';
+    while(out[i]){
+        // copy until next '/'
+        int j=i; while(out[j] && out[j]!='/') j++;
+        int segLen = j-i;
+        if (segLen==0) { i = j+1; continue; }
+        if (segLen==1 && out[i]=='.') {
+            // skip '.'
+        } else if (segLen==2 && out[i]=='.' && out[i+1]=='.') {
+            // pop last segment
+            if (ti>1){
+                if (tmp[ti-1]=='/') ti--;
+                while (ti>1 && tmp[ti-1]!='/') ti--;
+            }
+        } else {
+            if (tmp[ti-1] != '/') tmp[ti++]='/';
+            for (int k=0;k<segLen && ti<SHELL_PATH_MAX-1;k++) tmp[ti++]=out[i+k];
+        }
+        i = j;
+        if (out[i] == '/') i++;
+    }
+    if (ti>1 && tmp[ti-1]=='/') ti--;
+    tmp[ti]=0;
+    for (int k=0; k<=ti; ++k) out[k]=tmp[k];
+}
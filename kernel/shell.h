@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+
+// Command registry for the kernel shell. Subsystems register their commands
+// (usually from their init function); the shell tokenizes each line once
+// and finds the handler by binary search over the name-sorted table.
+// `help` is generated from the table.
+//
+// A line is a pipeline: cmd [< in] | filter | filter [> out | >> out].
+// Commands print through sh_write*, which goes to the console, into the
+// stage's pipe or to the redirect file. There are no threads, so stages
+// after the first are filters that are fed input as it is produced: each
+// pipe is a SHELL_PIPE_BYTES ring, and when it fills (or its writer
+// finishes) the queued spans are handed to the next stage's feed in place.
+// Output is therefore bounded in memory however much a stage prints.
+
+#define SHELL_MAX_CMDS 64
+#define SHELL_MAX_ARGS 16
+#define SHELL_PATH_MAX 128
+#define SHELL_MAX_STAGES 4
+#define SHELL_PIPE_BYTES 4096
+#define SHELL_FILTER_STATE 256    // per-stage scratch for a filter
+#define SHELL_LINE_MAX 256
+#define SHELL_RUN_DEPTH 4         // nested `run` scripts
+
+// argv[0] is the command name (lowercased); argv[argc] is NULL
+typedef int (*shell_fn)(int argc, char** argv);
+
+// Stream interface for commands that read input. st is SHELL_FILTER_STATE
+// zeroed bytes private to this stage; begin <0 aborts the pipeline
+typedef struct {
+    int (*begin)(void* st, int argc, char** argv);
+    void (*feed)(void* st, const char* data, int len);
+    void (*end)(void* st);
+} shell_filter_t;
+
+typedef struct {
+    const char* name;
+    shell_fn fn;                    // run when the command has no input; may be NULL for pure filters
+    // For help: one "usage - text" row per line; usage and text may hold
+    // several '\n'-separated lines that are paired up
+    const char* usage;
+    const char* help;
+    const shell_filter_t* filter;   // NULL if the command does not read input
+} shell_cmd_t;
+
+// The entry is kept by pointer. 0 ok, -1 table full, -2 duplicate name
+int shell_register(const shell_cmd_t* cmd);
+// Tokenize and run one line in place. Returns the first stage's result, 0
+// for an empty line, -127 for an unknown command and -2 for a bad pipeline
+// or redirect (after printing a message)
+int shell_exec(char* line);
+// Run a script file: one command line per line, blank lines and lines
+// starting with '#' skipped, each echoed after the prompt as if typed.
+// Returns the number of commands that failed (result < 0), -1 if the file
+// cannot be read, -2 if nested too deep or started inside a pipeline
+int shell_run_file(const char* path);
+void shell_help(void);
+
+// Command output
+void sh_write_n(const char* s, int n);
+void sh_write(const char* s);
+void sh_writeln(const char* s);
+void sh_putc(char c);
+// s padded with spaces to `width` columns, on the left if `right`
+void sh_put_col(const char* s, int width, int right);
+
+// Working directory and path helpers
+const char* shell_cwd(void);
+int shell_chdir(const char* path);               // 0 ok, -1 not a directory
+void shell_path(char* out, const char* in);      // resolve against cwd, normalize . and ..
+
+// Shared argument/number helpers for handlers
+void u32_to_dec(uint32_t v, char* buf);
+int parse_u32_dec(const char* s, uint32_t* out);
+int parse_hex8(const char* s, uint8_t* out);
+int shell_streq(const char* a, const char* b);
@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "lz4.h"
+#include "io.h"
+#include "bootprof.h"
+
+// Boot stub of the compressed image: the bootloader reads the small packed
+// image instead of the whole kernel, and this unpacks it in memory, which
+// is far faster than the BIOS disk reads it replaces.
+
+#define KERNEL_LINK_ADDR 0x00100000u    // kernel/kernel.ld; kernel_entry is first
+
+extern const uint8_t __payload[];       // lz4_image_t + block (kernel/stub.ld)
+
+static void fail(const char* msg){
+    volatile uint16_t* vga = (volatile uint16_t*)0xB8000;
+    for (int i = 0; *msg; ++i) vga[i] = (uint16_t)(0x4F00 | (uint8_t)*msg++);
+    for (;;) __asm__ __volatile__("cli; hlt");
+}
+
+uint32_t stub_main(void){
+    const lz4_image_t* h = (const lz4_image_t*)__payload;
+    if (h->magic != LZ4_IMAGE_MAGIC) fail("stub: no kernel payload");
+    int n = lz4_decompress(__payload + sizeof(*h), h->packed_size, (uint8_t*)KERNEL_LINK_ADDR, h->raw_size);
+    if (n != (int)h->raw_size) fail("stub: kernel decompression failed");
+    volatile bootinfo_tsc_t* bi = (volatile bootinfo_tsc_t*)(uintptr_t)BOOTINFO_TSC_ADDR;
+    if (bi->magic == BOOTINFO_TSC_MAGIC) bi->unpacked_tsc = rdtsc();
+    return KERNEL_LINK_ADDR;
+}
@@ -0,0 +1,12 @@
+; 32-bit entry of the compressed kernel image (build.sh, COMPRESS=1). The
+; bootloader jumps here with flat segments and esp = 0x90000; stub_main
+; unpacks the kernel to its link address and returns its entry point.
+[bits 32]
+
+global stub_entry
+extern stub_main
+
+section .text.entry
+stub_entry:
+    call stub_main
+    jmp eax
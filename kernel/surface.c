@@ -0,0 +1,241 @@
+#include <stdint.h>
+#include "surface.h"
+#include "cpu.h"
+#include "io.h"
+#include "memory.h"
+
+// Allocated blocks, kept sorted by offset so a first-fit scan walks the gaps
+static struct { uint32_t off, size; } blocks[SURFACE_MAX];
+static int nblocks = 0;
+
+static uint32_t arena_alloc(uint32_t size){
+    size = (size + 15u) & ~15u;
+    if (nblocks == SURFACE_MAX || !mem_phys_fits(SURFACE_ARENA_ADDR, SURFACE_ARENA_SIZE)) return 0xFFFFFFFFu;
+    uint32_t start = 0; int i = 0;
+    for (; i < nblocks; ++i){
+        if (blocks[i].off - start >= size) break;
+        start = blocks[i].off + blocks[i].size;
+    }
+    if (i == nblocks && SURFACE_ARENA_SIZE - start < size) return 0xFFFFFFFFu;
+    for (int j = nblocks; j > i; --j) blocks[j] = blocks[j-1];
+    blocks[i].off = start; blocks[i].size = size;
+    nblocks++;
+    return start;
+}
+
+static void arena_free(uint32_t off){
+    for (int i = 0; i < nblocks; ++i){
+        if (blocks[i].off != off) continue;
+        for (; i < nblocks-1; ++i) blocks[i] = blocks[i+1];
+        nblocks--;
+        return;
+    }
+}
+
+int surface_alloc(surface_t* s, int w, int h){
+    s->px = 0;
+    if (!g_fbops) return -1;
+    if (w <= 0 || h <= 0) return -2;
+    int pitch = (w * g_fbops->bytespp + 3) & ~3;
+    uint32_t off = arena_alloc((uint32_t)pitch * (uint32_t)h);
+    if (off == 0xFFFFFFFFu) return -2;
+    s->w = w; s->h = h; s->pitch = pitch; s->bpp = g_fbops->bpp; s->argb = 0;
+    s->px = (uint8_t*)(uintptr_t)(SURFACE_ARENA_ADDR + off);
+    return 0;
+}
+
+int surface_alloc_argb(surface_t* s, int w, int h){
+    s->px = 0;
+    if (w <= 0 || h <= 0) return -2;
+    uint32_t off = arena_alloc((uint32_t)w * 4u * (uint32_t)h);
+    if (off == 0xFFFFFFFFu) return -2;
+    s->w = w; s->h = h; s->pitch = w * 4; s->bpp = 32; s->argb = 1;
+    s->px = (uint8_t*)(uintptr_t)(SURFACE_ARENA_ADDR + off);
+    return 0;
+}
+
+void surface_free(surface_t* s){
+    if (!s->px) return;
+    arena_free((uint32_t)(uintptr_t)s->px - SURFACE_ARENA_ADDR);
+    s->px = 0;
+}
+
+void surface_of_backbuf(surface_t* s){
+    s->w = g_fb.width; s->h = g_fb.height; s->pitch = g_fb.pitch;
+    s->bpp = g_fb.bpp; s->px = g_fb.back; s->argb = 0;
+}
+
+// ARGB surfaces use the 32 bpp kernels whatever the screen format is
+static const fb_ops_t* ops_of(const surface_t* s){
+    return s->argb ? fb_ops_for(32) : g_fbops;
+}
+
+static int clip(const surface_t* s, int* x, int* y, int* w, int* h){
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > s->w) *w = s->w - *x;
+    if (*y + *h > s->h) *h = s->h - *y;
+    return *w > 0 && *h > 0;
+}
+
+void surf_fill_rect(surface_t* s, int x, int y, int w, int h, uint32_t color){
+    if (!s->px || !clip(s, &x, &y, &w, &h)) return;
+    const fb_ops_t* ops = ops_of(s);
+    ops->fill(s->px + y*s->pitch + x*ops->bytespp, s->pitch, w, h, s->argb ? color : ops->pack(color));
+}
+
+void surf_rect_border(surface_t* s, int x, int y, int w, int h, int t, uint32_t color){
+    surf_fill_rect(s, x, y, w, t, color);
+    surf_fill_rect(s, x, y+h-t, w, t, color);
+    surf_fill_rect(s, x, y, t, h, color);
+    surf_fill_rect(s, x+w-t, y, t, h, color);
+}
+
+void surf_copy(surface_t* dst, int dx, int dy, const surface_t* src, int sx, int sy, int w, int h){
+    if (!dst->px || !src->px) return;
+    // clip against the source, then the destination, shifting both origins
+    if (sx < 0) { dx -= sx; w += sx; sx = 0; }
+    if (sy < 0) { dy -= sy; h += sy; sy = 0; }
+    if (sx + w > src->w) w = src->w - sx;
+    if (sy + h > src->h) h = src->h - sy;
+    int ox = dx, oy = dy;
+    if (!clip(dst, &dx, &dy, &w, &h)) return;
+    sx += dx - ox; sy += dy - oy;
+    const fb_ops_t* ops = ops_of(dst);
+    ops->copy(dst->px + dy*dst->pitch + dx*ops->bytespp, dst->pitch,
+              src->px + sy*src->pitch + sx*ops->bytespp, src->pitch, w, h);
+}
+
+// ---- alpha blending ----
+
+// x*a/255, rounded, for x*a <= 255*255
+static inline uint32_t mul255(uint32_t x, uint32_t a){
+    x = x*a + 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static void blend_row32(uint32_t* d, const uint32_t* s, int n){
+    for (int i=0; i<n; ++i){
+        uint32_t c = s[i], a = c >> 24;
+        if (a == 255) { d[i] = c; continue; }
+        if (!c) continue;
+        // two channels per multiply: (r,b) and (a,g) in 16-bit lanes
+        uint32_t v = d[i], ia = 255 - a;
+        uint32_t rb = (v & 0x00FF00FFu) * ia + 0x00800080u;
+        rb = ((rb + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+        uint32_t ag = ((v >> 8) & 0x00FF00FFu) * ia + 0x00800080u;
+        ag = (ag + ((ag >> 8) & 0x00FF00FFu)) & 0xFF00FF00u;
+        d[i] = c + rb + ag;   // no carries: premultiplied channels are <= a
+    }
+}
+
+// 4 pixels per iteration: unpack to 16-bit lanes, multiply by 255-a,
+// divide by 255 with the same rounding as mul255, pack and add the source
+__attribute__((target("sse2")))
+static void blend_row_sse2(uint32_t* d, const uint32_t* s, int groups){
+    __asm__ __volatile__(
+        "pxor %%xmm6, %%xmm6\n\t"
+        "pcmpeqd %%xmm5, %%xmm5\n\t" "psrld $24, %%xmm5\n\t"                           // 0x000000FF dwords
+        "pcmpeqw %%xmm7, %%xmm7\n\t" "psrlw $15, %%xmm7\n\t" "psllw $7, %%xmm7\n\t"   // 0x0080 words
+        "1:\n\t"
+        "movdqu (%0), %%xmm0\n\t"
+        "movdqu (%1), %%xmm1\n\t"
+        "movdqa %%xmm0, %%xmm2\n\t" "psrld $24, %%xmm2\n\t" "pxor %%xmm5, %%xmm2\n\t"  // 255-a per pixel
+        "movdqa %%xmm2, %%xmm3\n\t" "pslld $16, %%xmm3\n\t" "por %%xmm3, %%xmm2\n\t"
+        "movdqa %%xmm2, %%xmm3\n\t" "punpckldq %%xmm2, %%xmm2\n\t" "punpckhdq %%xmm3, %%xmm3\n\t"
+        "movdqa %%xmm1, %%xmm4\n\t" "punpcklbw %%xmm6, %%xmm1\n\t" "punpckhbw %%xmm6, %%xmm4\n\t"
+        "pmullw %%xmm2, %%xmm1\n\t" "pmullw %%xmm3, %%xmm4\n\t"
+        "paddw %%xmm7, %%xmm1\n\t" "paddw %%xmm7, %%xmm4\n\t"
+        "movdqa %%xmm1, %%xmm2\n\t" "psrlw $8, %%xmm2\n\t" "paddw %%xmm2, %%xmm1\n\t" "psrlw $8, %%xmm1\n\t"
+        "movdqa %%xmm4, %%xmm3\n\t" "psrlw $8, %%xmm3\n\t" "paddw %%xmm3, %%xmm4\n\t" "psrlw $8, %%xmm4\n\t"
+        "packuswb %%xmm4, %%xmm1\n\t"
+        "paddusb %%xmm0, %%xmm1\n\t"
+        "movdqu %%xmm1, (%1)\n\t"
+        "add $16, %0\n\t" "add $16, %1\n\t"
+        "dec %2\n\t" "jnz 1b"
+        : "+r"(s), "+r"(d), "+r"(groups)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+static void blend_row565(uint16_t* d, const uint32_t* s, int n){
+    for (int i=0; i<n; ++i){
+        uint32_t c = s[i], a = c >> 24;
+        if (!c) continue;
+        uint32_t r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+        if (a != 255){
+            uint32_t v = d[i], ia = 255 - a;
+            uint32_t dr = (v >> 11) & 0x1F, dg = (v >> 5) & 0x3F, db = v & 0x1F;
+            r += mul255((dr << 3) | (dr >> 2), ia);
+            g += mul255((dg << 2) | (dg >> 4), ia);
+            b += mul255((db << 3) | (db >> 2), ia);
+        }
+        d[i] = (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+    }
+}
+
+static void blend_row24(uint8_t* d, const uint32_t* s, int n){
+    for (int i=0; i<n; ++i, d += 3){
+        uint32_t c = s[i], ia = 255 - (c >> 24);
+        if (!c) continue;
+        d[0] = (uint8_t)((c & 0xFF) + mul255(d[0], ia));
+        d[1] = (uint8_t)(((c >> 8) & 0xFF) + mul255(d[1], ia));
+        d[2] = (uint8_t)(((c >> 16) & 0xFF) + mul255(d[2], ia));
+    }
+}
+
+static void blend_rect(const surface_t* src, surface_t* dst, const fb_rect_t* r, int simd){
+    int sx = 0, sy = 0, dx = r->x, dy = r->y;
+    int w = r->w < src->w ? r->w : src->w, h = r->h < src->h ? r->h : src->h;
+    if (!src->px || !dst->px || !src->argb) return;
+    int ox = dx, oy = dy;
+    if (!clip(dst, &dx, &dy, &w, &h)) return;
+    sx += dx - ox; sy += dy - oy;
+    int bytespp = (dst->bpp + 7) / 8;
+    const uint8_t* sp = src->px + sy*src->pitch + sx*4;
+    uint8_t* dp = dst->px + dy*dst->pitch + dx*bytespp;
+    for (int y=0; y<h; ++y, sp += src->pitch, dp += dst->pitch){
+        const uint32_t* s = (const uint32_t*)sp;
+        switch (dst->bpp){
+        case 32: {
+            int g = simd ? w >> 2 : 0;
+            if (g) blend_row_sse2((uint32_t*)dp, s, g);
+            blend_row32((uint32_t*)dp + g*4, s + g*4, w - g*4);
+            break;
+        }
+        case 16: blend_row565((uint16_t*)dp, s, w); break;
+        case 24: blend_row24(dp, s, w); break;
+        default: return;
+        }
+    }
+}
+
+void blit_alpha(const surface_t* src, surface_t* dst, const fb_rect_t* r){
+    blend_rect(src, dst, r, cpu_has_sse2());
+}
+
+int surf_bench_alpha(int bpp, int simd, int w, int h, uint32_t* cycles){
+    enum { FRAMES = 20 };
+    if (!g_fb.present) return -1;   // the back buffer is only set up with an LFB
+    if (simd && !cpu_has_sse2()) return -1;
+    if (bpp != 16 && bpp != 24 && bpp != 32) return -1;
+    int pitch = (w * ((bpp + 7) / 8) + 3) & ~3;
+    if ((uint32_t)pitch * (uint32_t)h > FB_BACKBUF_MAX) return -1;
+    surface_t src, dst = { w, h, pitch, (uint8_t)bpp, (uint8_t*)(uintptr_t)FB_BACKBUF_ADDR, 0 };
+    if (surface_alloc_argb(&src, w, h) != 0) return -2;
+    // Alpha ramp across each row: mixes opaque, clear and blended pixels
+    for (int y=0; y<h; ++y){
+        uint32_t* row = (uint32_t*)(src.px + y*src.pitch);
+        for (int x=0; x<w; ++x){
+            uint32_t a = (uint32_t)(x * 255 / (w > 1 ? w-1 : 1));
+            row[x] = (a << 24) | (mul255(0xFF, a) << 16) | (mul255(0x80, a) << 8) | mul255((uint32_t)y & 0xFF, a);
+        }
+    }
+    fb_rect_t r = { 0, 0, w, h };
+    uint64_t t0 = rdtsc();
+    for (int i=0; i<FRAMES; ++i) blend_rect(&src, &dst, &r, simd);
+    uint64_t t1 = rdtsc();
+    surface_free(&src);
+    *cycles = (uint32_t)udiv64_32(t1 - t0, FRAMES);
+    return 0;
+}
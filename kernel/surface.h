@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include "fb.h"
+
+// Off-screen pixel surfaces, normally in the screen format (g_fbops). Window
+// contents and the framebuffer console live in surfaces; the window manager
+// composites them into the back buffer. ARGB surfaces hold premultiplied
+// ARGB8888 pixels (each color channel <= alpha) and are sources for
+// blit_alpha.
+typedef struct {
+    int w, h;
+    int pitch;      // bytes per row
+    uint8_t bpp;
+    uint8_t* px;
+    uint8_t argb;   // 1: premultiplied ARGB8888
+} surface_t;
+
+// Surface memory: a fixed arena after the glyph cache, first-fit allocated
+#define SURFACE_ARENA_ADDR 0x02000000u
+#define SURFACE_ARENA_SIZE (16u*1024u*1024u)
+#define SURFACE_MAX 32
+
+int surface_alloc(surface_t* s, int w, int h);   // 0 ok, -1 no fb, -2 no memory
+int surface_alloc_argb(surface_t* s, int w, int h);   // needs no fb
+void surface_free(surface_t* s);
+void surface_of_backbuf(surface_t* s);           // view of the fb back buffer
+
+// Drawing; all clip to the surface. Colors are 0x00RRGGBB, or the raw
+// premultiplied 0xAARRGGBB value on ARGB surfaces.
+void surf_fill_rect(surface_t* s, int x, int y, int w, int h, uint32_t color);
+void surf_rect_border(surface_t* s, int x, int y, int w, int h, int thickness, uint32_t color);
+// Opaque copy of a w*h block between surfaces of the same format
+void surf_copy(surface_t* dst, int dx, int dy, const surface_t* src, int sx, int sy, int w, int h);
+
+// Blend the ARGB surface src over dst with its origin at r->x,r->y, covering
+// at most r->w x r->h: dst = src + dst*(255-a)/255 per channel. dst may be a
+// 16, 24 or 32 bpp screen-format surface or another ARGB surface. 32 bpp
+// rows use SSE2 (4 pixels per op) when cpu_init enabled it, else scalar.
+void blit_alpha(const surface_t* src, surface_t* dst, const fb_rect_t* r);
+
+// Cycles per full w*h blit_alpha into back buffer memory laid out as `bpp`;
+// simd=0 forces the scalar path. <0 if unavailable or there is no LFB.
+int surf_bench_alpha(int bpp, int simd, int w, int h, uint32_t* cycles);
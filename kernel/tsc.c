@@ -0,0 +1,48 @@
+#include <stdint.h>
+#include "tsc.h"
+#include "io.h"
+
+#define PIT_HZ 1193182u
+#define CAL_MS 10
+
+static uint32_t g_khz = 0;
+
+void tsc_init(void){
+    uint32_t f = irq_save();
+    // PIT channel 2, mode 0 (OUT rises at terminal count), speaker off
+    uint8_t p61 = inb(0x61);
+    outb(0x61, (uint8_t)((p61 & ~0x02) | 0x01));
+    outb(0x43, 0xB0);
+    uint16_t count = (uint16_t)(PIT_HZ * CAL_MS / 1000);
+    outb(0x42, (uint8_t)(count & 0xFF));
+    outb(0x42, (uint8_t)(count >> 8));
+    // Pulse the gate to (re)start the count, then time until OUT goes high
+    uint8_t v = inb(0x61) & (uint8_t)~0x01;
+    outb(0x61, v);
+    outb(0x61, (uint8_t)(v | 0x01));
+    uint64_t t0 = rdtsc();
+    while (!(inb(0x61) & 0x20)) { }
+    uint64_t t1 = rdtsc();
+    outb(0x61, p61);
+    irq_restore(f);
+    g_khz = (uint32_t)udiv64_32(t1 - t0, CAL_MS);
+    if (g_khz == 0) g_khz = 1;
+}
+
+uint32_t tsc_khz(void){ return g_khz; }
+
+uint64_t tsc_to_us(uint64_t cycles){
+    return g_khz ? udiv64_32(cycles * 1000u, g_khz) : 0;
+}
+
+uint32_t tsc_per_sec(uint64_t count, uint64_t cycles){
+    if (!g_khz || !cycles) return 0;
+    // count * khz * 1000 / cycles, scaled down first if it would overflow
+    uint64_t num = count * g_khz;
+    while (num >> 54) { num >>= 1; cycles >>= 1; }
+    num *= 1000u;
+    while (cycles >> 32) { num >>= 1; cycles >>= 1; }
+    if (!cycles) return 0xFFFFFFFFu;
+    uint64_t r = udiv64_32(num, (uint32_t)cycles);
+    return (r >> 32) ? 0xFFFFFFFFu : (uint32_t)r;
+}
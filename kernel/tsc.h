@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+// TSC frequency, calibrated once against PIT channel 2
+void tsc_init(void);
+uint32_t tsc_khz(void);                 // 0 until tsc_init has run
+uint64_t tsc_to_us(uint64_t cycles);
+// rate = count per second over `cycles` (saturates at 0xFFFFFFFF)
+uint32_t tsc_per_sec(uint64_t count, uint64_t cycles);
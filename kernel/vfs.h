@@ -8,6 +8,7 @@ typedef struct {
     int isDir;
     uint32_t size;     // for files
     uint32_t children; // for directories
+    uint32_t gen;      // changes whenever the file is rewritten
 } vfs_stat_t;
 
 void vfs_init(void);
@@ -15,7 +16,9 @@ int vfs_mount_ramfs(void);
 
 int vfs_mkdir(const char* path);
 int vfs_write(const char* path, const char* data, uint32_t len); // create or truncate
+int vfs_append(const char* path, const char* data, uint32_t len); // create or extend
 int vfs_read(const char* path, char* out, uint32_t max, uint32_t* outLen);
+int vfs_read_at(const char* path, uint32_t offset, char* out, uint32_t max, uint32_t* outLen); // 0 bytes at EOF
 int vfs_rm(const char* path);
 int vfs_ls(const char* path, vfs_list_cb cb);
 int vfs_stat(const char* path, vfs_stat_t* st);
@@ -1,71 +1,177 @@
 #include <stdint.h>
 #include "window.h"
+#include "console.h"
 
-#define VGA_MEM ((volatile uint16_t*)0xB8000)
-#define VGA_COLS 80
-#define VGA_ROWS 25
+#define VGA_COLS CONSOLE_COLS
+#define VGA_ROWS CONSOLE_ROWS
 
 static inline uint16_t vga_cell(uint8_t fg, uint8_t bg, char c){ return (uint16_t)(((bg<<4)|(fg&0x0F))<<8) | (uint8_t)c; }
 
+// Open windows, bottom first
+static Window* zstack[WINDOW_MAX];
+static int nz = 0;
+
+// Outer row y. Rows 1..h-2 (the client area) are a ring rotated by `top`
+// so scrolling moves no cells; the border rows stay put.
+static uint16_t* row_at(Window* win, int y){
+    if (y > 0 && y < win->h-1){
+        int ch = win->h - 2;
+        y = 1 + (y - 1 + win->top) % ch;
+    }
+    return win->cells + y*win->w;
+}
+
+static void fill_row(uint16_t* row, int n, uint16_t cell){
+    for (int x=0; x<n; ++x) row[x] = cell;
+}
+
 void window_init(Window* win, int x, int y, int w, int h, const char* title, uint8_t fg, uint8_t bg){
+    // at most one screen's worth; keeps a row mask in 32 bits
+    if (w < 0) w = 0;
+    if (h < 0) h = 0;
+    if (w > VGA_COLS) w = VGA_COLS;
+    if (h > VGA_ROWS) h = VGA_ROWS;
     win->x=x; win->y=y; win->w=w; win->h=h; win->cx=0; win->cy=0; win->fg=fg; win->bg=bg;
+    win->top = 0;
     int i=0; for(; title && title[i] && i<(int)sizeof(win->title)-1; ++i) win->title[i]=title[i]; win->title[i]=0;
+    fill_row(win->cells, w*h, vga_cell(fg, bg, ' '));
+    win->dirty = 0;
+    window_close(win);
+    if (nz == WINDOW_MAX){   // forget the bottom one
+        for (int k=0; k<nz-1; ++k) zstack[k] = zstack[k+1];
+        nz--;
+    }
+    zstack[nz++] = win;
+}
+
+void window_close(Window* win){
+    for (int i=0; i<nz; ++i){
+        if (zstack[i] != win) continue;
+        for (; i<nz-1; ++i) zstack[i] = zstack[i+1];
+        nz--;
+        return;
+    }
+}
+
+void window_raise(Window* win){
+    window_close(win);
+    if (nz < WINDOW_MAX) zstack[nz++] = win;
+    win->dirty = (1u << win->h) - 1;
+    window_flush(win);
+}
+
+// First column >= gx on screen row gy that win shows, and the span length,
+// clipped to [gx, end) and to windows above it; returns 0 if none
+static int visible_span(const Window* win, int above, int gy, int* gx, int end){
+    while (*gx < end){
+        int x = *gx, stop = end;
+        int covered = 0;
+        for (int i=above; i<nz; ++i){
+            const Window* o = zstack[i];
+            if (gy < o->y || gy >= o->y + o->h) continue;
+            if (x >= o->x && x < o->x + o->w){ *gx = o->x + o->w; covered = 1; break; }
+            if (o->x > x && o->x < stop) stop = o->x;
+        }
+        if (!covered) return stop - x;
+    }
+    return 0;
+}
+
+void window_flush(Window* win){
+    if (!win->dirty) return;
+    int above = nz;
+    for (int i=0; i<nz; ++i) if (zstack[i] == win) { above = i+1; break; }
+    console_batch_begin();
+    for (int y=0; y<win->h; ++y){
+        if (!(win->dirty & (1u << y))) continue;
+        int gy = win->y + y;
+        if (gy < 0 || gy >= VGA_ROWS) continue;
+        int x0 = win->x < 0 ? 0 : win->x;
+        int x1 = win->x + win->w > VGA_COLS ? VGA_COLS : win->x + win->w;
+        const uint16_t* row = row_at(win, y);
+        int gx = x0, n;
+        while ((n = visible_span(win, above, gy, &gx, x1)) > 0){
+            console_put_cells(gx, gy, row + (gx - win->x), n);
+            gx += n;
+        }
+    }
+    win->dirty = 0;
+    console_batch_end();
 }
 
-void window_draw(const Window* win){
+void window_draw(Window* win){
     // border + title bar
     uint8_t tb_fg = 0x0F, tb_bg = 0x01; // white on blue title bar
     for(int yy=0; yy<win->h; ++yy){
-        int gy = win->y + yy; if (gy<0 || gy>=VGA_ROWS) continue;
-        for(int xx=0; xx<win->w; ++xx){
-            int gx = win->x + xx; if (gx<0 || gx>=VGA_COLS) continue;
-            uint8_t fg = win->fg, bg = win->bg; char ch=' ';
-            // top/bottom border
-            if (yy==0 || yy==win->h-1 || xx==0 || xx==win->w-1){ fg = 0x0F; bg = 0x00; ch = (yy==0||yy==win->h-1) ? '-' : '|'; }
-            // title bar overwrite top interior
-            if (yy==0){ bg = tb_bg; fg = tb_fg; ch=' '; }
-            VGA_MEM[gy*VGA_COLS + gx] = vga_cell(fg,bg,ch);
+        if (yy != 0 && yy != win->h-1){
+            uint16_t* row = row_at(win, yy);
+            row[0] = vga_cell(0x0F, 0x00, '|');
+            row[win->w-1] = vga_cell(0x0F, 0x00, '|');
+        } else {
+            // top row is the title bar
+            uint16_t c = yy==0 ? vga_cell(tb_fg, tb_bg, ' ') : vga_cell(0x0F, 0x00, '-');
+            fill_row(row_at(win, yy), win->w, c);
         }
+        win->dirty |= 1u << yy;
     }
     // write title centered on title bar
-    if (win->title[0]){
+    if (win->title[0] && win->h > 0){
         int len=0; while(win->title[len] && len<60) len++;
-        int start = win->x + (win->w - len)/2; if (start < win->x+1) start = win->x+1;
-        for (int i=0; i<len && (start+i) < (win->x + win->w - 1); ++i){
-            int gx = start + i; int gy = win->y + 0;
-            VGA_MEM[gy*VGA_COLS + gx] = vga_cell(0x0F, 0x01, win->title[i]);
-        }
+        int start = (win->w - len)/2; if (start < 1) start = 1;
+        uint16_t* row = row_at(win, 0);
+        for (int i=0; i<len && (start+i) < win->w-1; ++i) row[start+i] = vga_cell(tb_fg, tb_bg, win->title[i]);
     }
+    window_flush(win);
 }
 
-static void put_at(int gx, int gy, uint8_t fg, uint8_t bg, char c){
-    if (gx<0||gx>=VGA_COLS||gy<0||gy>=VGA_ROWS) return; VGA_MEM[gy*VGA_COLS + gx] = vga_cell(fg,bg,c);
-}
-
-void window_clear_client(const Window* win){
+void window_clear_client(Window* win){
     for(int yy=1; yy<win->h-1; ++yy){
-        for(int xx=1; xx<win->w-1; ++xx){ put_at(win->x+xx, win->y+yy, win->fg, win->bg, ' '); }
+        fill_row(row_at(win, yy) + 1, win->w-2, vga_cell(win->fg, win->bg, ' '));
+        win->dirty |= 1u << yy;
     }
+    window_flush(win);
+}
+
+static void put_at(Window* win, int cx, int cy, char c){
+    row_at(win, cy+1)[cx+1] = vga_cell(win->fg, win->bg, c);
+    win->dirty |= 1u << (cy+1);
 }
 
 void window_putc(Window* win, char c){
     int maxw = win->w - 2; int maxh = win->h - 2; if (maxw<=0||maxh<=0) return;
     if (c=='\n'){ win->cx=0; win->cy++; }
     else if (c=='\r'){ win->cx=0; }
-    else if (c=='\b'){ if (win->cx>0){ win->cx--; put_at(win->x+1+win->cx, win->y+1+win->cy, win->fg, win->bg, ' ');} }
-    else { put_at(win->x+1+win->cx, win->y+1+win->cy, win->fg, win->bg, c); if(++win->cx>=maxw){ win->cx=0; win->cy++; } }
-    if (win->cy>=maxh){ // simple scroll within window
-        for(int yy=0; yy<maxh-1; ++yy){
-            for(int xx=0; xx<maxw; ++xx){
-                int srcx=win->x+1+xx, srcy=win->y+1+yy+1;
-                int dstx=win->x+1+xx, dsty=win->y+1+yy;
-                VGA_MEM[dsty*VGA_COLS + dstx] = VGA_MEM[srcy*VGA_COLS + srcx];
-            }
-        }
-        for(int xx=0; xx<maxw; ++xx){ put_at(win->x+1+xx, win->y+1+maxh-1, win->fg, win->bg, ' '); }
+    else if (c=='\b'){ if (win->cx>0){ win->cx--; put_at(win, win->cx, win->cy, ' ');} }
+    else { put_at(win, win->cx, win->cy, c); if(++win->cx>=maxw){ win->cx=0; win->cy++; } }
+    if (win->cy>=maxh){
+        // scroll: rotate the client ring and blank the new bottom row
+        win->top = (win->top + 1) % maxh;
         win->cy = maxh-1;
+        fill_row(row_at(win, maxh) + 1, maxw, vga_cell(win->fg, win->bg, ' '));
+        for (int yy=1; yy<=maxh; ++yy) win->dirty |= 1u << yy;
     }
 }
 
-void window_write(Window* win, const char* s){ while(*s) window_putc(win, *s++); }
-void window_writeln(Window* win, const char* s){ window_write(win,s); window_putc(win,'\n'); }
+void window_set_row(Window* win, int cy, const uint16_t* cells, int n){
+    int maxw = win->w - 2;
+    if (cy < 0 || cy >= win->h - 2 || maxw <= 0) return;
+    uint16_t* row = row_at(win, cy+1) + 1;
+    if (n > maxw) n = maxw;
+    for (int x=0; x<n; ++x) row[x] = cells[x];
+    fill_row(row + n, maxw - n, vga_cell(win->fg, win->bg, ' '));
+    win->dirty |= 1u << (cy+1);
+}
+
+void window_scroll(Window* win, int n){
+    int maxw = win->w - 2, maxh = win->h - 2;
+    if (maxw <= 0 || maxh <= 0 || n == 0) return;
+    if (n >= maxh || -n >= maxh) n = n > 0 ? maxh : -maxh;
+    win->top = ((win->top + n) % maxh + maxh) % maxh;
+    // rows that scrolled in hold stale cells from the other end of the ring
+    int from = n > 0 ? maxh - n : 0, to = n > 0 ? maxh : -n;
+    for (int y = from; y < to; ++y) fill_row(row_at(win, y+1) + 1, maxw, vga_cell(win->fg, win->bg, ' '));
+    for (int yy=1; yy<=maxh; ++yy) win->dirty |= 1u << yy;
+}
+
+void window_write(Window* win, const char* s){ while(*s) window_putc(win, *s++); window_flush(win); }
+void window_writeln(Window* win, const char* s){ while(*s) window_putc(win, *s++); window_putc(win,'\n'); window_flush(win); }
@@ -1,16 +1,37 @@
 #pragma once
 #include <stdint.h>
+#include "console.h"
+
+// Text-mode windows with their own backing store. All drawing lands in the
+// window's cell buffer (outer rect, border included); window_flush copies
+// the changed rows to the console, skipping cells covered by windows above
+// it, so overlapping windows never overwrite each other.
+#define WINDOW_MAX_CELLS (CONSOLE_COLS * CONSOLE_ROWS)
+#define WINDOW_MAX 8      // open windows tracked for z-order
 
 typedef struct {
     int x, y, w, h;      // outer rect including border
     int cx, cy;          // cursor in client area (relative to client)
     uint8_t fg, bg;      // colors
     char title[64];
+    int top;             // ring offset of client row 0 (scrolling rotates it)
+    uint32_t dirty;      // bit per outer row not yet flushed
+    uint16_t cells[WINDOW_MAX_CELLS];   // h rows of w cells
 } Window;
 
+// Opens the window on top of the z-order; window_close forgets it (its last
+// flushed contents stay on screen until overdrawn)
 void window_init(Window* win, int x, int y, int w, int h, const char* title, uint8_t fg, uint8_t bg);
-void window_draw(const Window* win);
-void window_clear_client(const Window* win);
-void window_putc(Window* win, char c);
-void window_write(Window* win, const char* s);
+void window_close(Window* win);
+void window_raise(Window* win);
+void window_draw(Window* win);
+void window_clear_client(Window* win);
+void window_putc(Window* win, char c);          // buffer only; see window_flush
+void window_write(Window* win, const char* s);   // write + flush
 void window_writeln(Window* win, const char* s);
+void window_flush(Window* win);
+// Bulk client-area updates for pagers: replace client row cy with n cells
+// (padded with blanks), and scroll the client area by n rows (n > 0 moves
+// content up) blanking the rows that scroll in
+void window_set_row(Window* win, int cy, const uint16_t* cells, int n);
+void window_scroll(Window* win, int n);
@@ -0,0 +1,181 @@
+#include <stdint.h>
+#include "wm.h"
+#include "rect.h"
+#include "io.h"
+
+typedef struct {
+    uint8_t used;
+    fb_rect_t r;        // screen position and size
+    surface_t surf;
+} wm_window_t;
+
+static wm_window_t wins[WM_MAX_WINDOWS];
+static int zorder[WM_MAX_WINDOWS];   // window ids, bottom first
+static int nz = 0;
+static fb_rect_t damage[WM_MAX_DAMAGE];
+static int ndamage = 0;
+static wm_stats_t stats;
+
+static wm_window_t* get(int id){
+    if (id < 0 || id >= WM_MAX_WINDOWS || !wins[id].used) return 0;
+    return &wins[id];
+}
+
+void wm_damage_screen(int x, int y, int w, int h){
+    if (!g_fb.present) return;
+    fb_rect_t s = { 0, 0, g_fb.width, g_fb.height }, in = { x, y, w, h };
+    fb_rect_t r = rect_intersect(&in, &s);
+    if (rect_empty(&r)) return;
+    // Same policy as fb_damage: absorb into a rect when the union wastes
+    // little, collapse to one bounding box when the list is full
+    for (int i=0;i<ndamage;++i){
+        fb_rect_t u = rect_union(&damage[i], &r);
+        if (rect_area(&u) <= rect_area(&damage[i]) + rect_area(&r) + (rect_area(&u) >> 3)){
+            damage[i] = u;
+            return;
+        }
+    }
+    if (ndamage == WM_MAX_DAMAGE){
+        for (int i=1;i<ndamage;++i) damage[0] = rect_union(&damage[0], &damage[i]);
+        damage[0] = rect_union(&damage[0], &r);
+        ndamage = 1;
+        return;
+    }
+    damage[ndamage++] = r;
+}
+
+void wm_damage_window(int id, int x, int y, int w, int h){
+    wm_window_t* win = get(id);
+    if (!win) return;
+    fb_rect_t local = { 0, 0, win->r.w, win->r.h }, in = { x, y, w, h };
+    fb_rect_t r = rect_intersect(&in, &local);
+    if (!rect_empty(&r)) wm_damage_screen(win->r.x + r.x, win->r.y + r.y, r.w, r.h);
+}
+
+int wm_create(int x, int y, int w, int h){
+    if (!g_fb.present) return -1;
+    int id = 0;
+    while (id < WM_MAX_WINDOWS && wins[id].used) id++;
+    if (id == WM_MAX_WINDOWS) return -2;
+    wm_window_t* win = &wins[id];
+    if (surface_alloc(&win->surf, w, h) != 0) return -3;
+    surf_fill_rect(&win->surf, 0, 0, w, h, WM_DESKTOP_RGB);
+    win->used = 1;
+    win->r.x = x; win->r.y = y; win->r.w = w; win->r.h = h;
+    zorder[nz++] = id;
+    wm_damage_screen(x, y, w, h);
+    return id;
+}
+
+static int zpos(int id){
+    for (int i=0;i<nz;++i) if (zorder[i] == id) return i;
+    return -1;
+}
+
+void wm_destroy(int id){
+    wm_window_t* win = get(id);
+    if (!win) return;
+    for (int i = zpos(id); i < nz-1; ++i) zorder[i] = zorder[i+1];
+    nz--;
+    wm_damage_screen(win->r.x, win->r.y, win->r.w, win->r.h);
+    surface_free(&win->surf);
+    win->used = 0;
+}
+
+void wm_move(int id, int x, int y){
+    wm_window_t* win = get(id);
+    if (!win || (win->r.x == x && win->r.y == y)) return;
+    fb_rect_t old = win->r;
+    win->r.x = x; win->r.y = y;
+    // Uncovered strips of the old position, then the window at its new one
+    fb_rect_t exposed[4];
+    int n = rect_subtract(&old, &win->r, exposed);
+    for (int i=0;i<n;++i) wm_damage_screen(exposed[i].x, exposed[i].y, exposed[i].w, exposed[i].h);
+    wm_damage_screen(x, y, win->r.w, win->r.h);
+}
+
+void wm_raise(int id){
+    wm_window_t* win = get(id);
+    int p = zpos(id);
+    if (!win || p == nz-1) return;
+    for (int i = p; i < nz-1; ++i) zorder[i] = zorder[i+1];
+    zorder[nz-1] = id;
+    wm_damage_screen(win->r.x, win->r.y, win->r.w, win->r.h);
+}
+
+surface_t* wm_surface(int id){
+    wm_window_t* win = get(id);
+    return win ? &win->surf : 0;
+}
+
+int wm_rect(int id, fb_rect_t* out){
+    wm_window_t* win = get(id);
+    if (!win) return -1;
+    *out = win->r;
+    return 0;
+}
+
+// Copy the part of r covered by window z into the back buffer
+static void copy_from(surface_t* back, int z, const fb_rect_t* r){
+    wm_window_t* win = &wins[zorder[z]];
+    fb_rect_t in = rect_intersect(r, &win->r);
+    if (rect_empty(&in)) return;
+    surf_copy(back, in.x, in.y, &win->surf, in.x - win->r.x, in.y - win->r.y, in.w, in.h);
+    stats.last_px += (uint32_t)rect_area(&in);
+}
+
+static void fill_desktop(surface_t* back, const fb_rect_t* r){
+    surf_fill_rect(back, r->x, r->y, r->w, r->h, WM_DESKTOP_RGB);
+    stats.last_px += (uint32_t)rect_area(r);
+}
+
+// Painter's fallback for a fragment when the piece list is full: desktop,
+// then every window below ztop, bottom-up
+static void paint_under(surface_t* back, const fb_rect_t* r, int ztop){
+    fill_desktop(back, r);
+    for (int z = 0; z < ztop; ++z) copy_from(back, z, r);
+}
+
+static void compose_rect(surface_t* back, const fb_rect_t* d){
+    static fb_rect_t bufa[WM_MAX_PIECES], bufb[WM_MAX_PIECES];
+    fb_rect_t* cur = bufa; fb_rect_t* next = bufb;
+    int n = 1;
+    cur[0] = *d;
+    for (int z = nz-1; z >= 0 && n; --z){
+        const fb_rect_t* wr = &wins[zorder[z]].r;
+        int m = 0;
+        for (int i=0;i<n;++i){
+            fb_rect_t in = rect_intersect(&cur[i], wr);
+            if (rect_empty(&in)) { next[m++] = cur[i]; continue; }
+            copy_from(back, z, &cur[i]);
+            fb_rect_t rest[4];
+            int k = rect_subtract(&cur[i], wr, rest);
+            for (int j=0;j<k;++j){
+                if (m < WM_MAX_PIECES) next[m++] = rest[j];
+                else paint_under(back, &rest[j], z);
+            }
+        }
+        fb_rect_t* t = cur; cur = next; next = t;
+        n = m;
+    }
+    for (int i=0;i<n;++i) fill_desktop(back, &cur[i]);
+    fb_damage(d->x, d->y, d->w, d->h);
+}
+
+void wm_render(void){
+    if (!g_fb.present) return;
+    if (ndamage){
+        uint64_t t0 = rdtsc();
+        surface_t back;
+        surface_of_backbuf(&back);
+        stats.last_px = 0;
+        stats.last_rects = (uint32_t)ndamage;
+        for (int i=0;i<ndamage;++i) compose_rect(&back, &damage[i]);
+        ndamage = 0;
+        stats.frames++;
+        stats.last_cycles = (uint32_t)(rdtsc() - t0);
+    }
+    fb_present();
+}
+
+const wm_stats_t* wm_stats(void){ return &stats; }
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include "fb.h"
+#include "surface.h"
+
+// Compositing window manager. Every window owns a backing surface; clients
+// draw into it and report what changed with wm_damage_window. wm_render
+// recomposes only damaged screen areas, walking windows top-down and
+// subtracting each one from what is left, so every pixel is written once
+// and occluded parts of lower windows are never copied. Whatever no window
+// covers is filled with the desktop color.
+#define WM_MAX_WINDOWS 16
+#define WM_MAX_DAMAGE  32
+#define WM_MAX_PIECES  64   // uncovered fragments tracked per damage rect
+#define WM_DESKTOP_RGB 0x00202020
+
+typedef struct {
+    uint32_t frames;
+    uint32_t last_rects;    // damage rects composed by the last wm_render
+    uint32_t last_px;       // pixels it wrote to the back buffer
+    uint32_t last_cycles;   // TSC cycles spent composing (excluding present)
+} wm_stats_t;
+
+// New window on top of the z-order; returns its id, or <0 (no fb, no slot,
+// no surface memory). The surface is cleared to the desktop color.
+int wm_create(int x, int y, int w, int h);
+void wm_destroy(int id);
+void wm_move(int id, int x, int y);   // damages only the exposed area and the new position
+void wm_raise(int id);
+surface_t* wm_surface(int id);        // NULL for a bad id
+int wm_rect(int id, fb_rect_t* out);
+
+void wm_damage_window(int id, int x, int y, int w, int h);   // window coordinates
+void wm_damage_screen(int x, int y, int w, int h);
+void wm_render(void);                 // compose damage into the back buffer, then fb_present
+const wm_stats_t* wm_stats(void);
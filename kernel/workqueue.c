@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include "workqueue.h"
+#include "io.h"
+
+typedef struct {
+    work_t* ring[WQ_DEPTH];
+    volatile uint32_t head, tail;   // head = next write, tail = next read
+    volatile int running;           // drain in progress (no re-entry)
+} wq_ring_t;
+
+typedef struct {
+    wq_ring_t q[2];                 // indexed by work_t.ctx
+    wq_stat_t stat;
+} wq_cpu_t;
+
+static wq_cpu_t wq[WQ_NCPU];
+
+static inline wq_cpu_t* this_cpu(void){ return &wq[0]; }
+
+void work_init(work_t* w, work_fn_t fn, void* arg){
+    w->fn = fn; w->arg = arg; w->pending = 0; w->ctx = WORK_IRQEXIT; w->runs = 0;
+}
+
+void work_init_thread(work_t* w, work_fn_t fn, void* arg){
+    work_init(w, fn, arg); w->ctx = WORK_THREAD;
+}
+
+int work_queue(work_t* w){
+    wq_cpu_t* c = this_cpu();
+    wq_ring_t* q = &c->q[w->ctx];
+    uint32_t f = irq_save();
+    int r = 0;
+    if (w->pending) r = 1;
+    else if (q->head - q->tail >= WQ_DEPTH) { c->stat.dropped++; r = -1; }
+    else {
+        w->pending = 1;
+        q->ring[q->head & (WQ_DEPTH-1)] = w;
+        q->head++;
+        c->stat.queued++;
+    }
+    irq_restore(f);
+    return r;
+}
+
+int work_pending(void){
+    wq_cpu_t* c = this_cpu();
+    return c->q[0].head != c->q[0].tail || c->q[1].head != c->q[1].tail;
+}
+
+static int drain(wq_cpu_t* c, wq_ring_t* q){
+    work_t* batch[WQ_BATCH];
+    int total = 0;
+    uint32_t f = irq_save();
+    if (q->running) { irq_restore(f); return 0; }
+    q->running = 1;
+    for (;;) {
+        // Grab up to WQ_BATCH items with interrupts off, then run them with
+        // interrupts restored so new IRQs can keep queuing behind us
+        int n = 0;
+        while (n < WQ_BATCH && q->tail != q->head) {
+            work_t* w = q->ring[q->tail & (WQ_DEPTH-1)];
+            q->tail++;
+            w->pending = 0;   // may be re-queued while it runs
+            batch[n++] = w;
+        }
+        if (n == 0) break;
+        c->stat.batches++;
+        if ((uint32_t)n > c->stat.max_batch) c->stat.max_batch = (uint32_t)n;
+        irq_restore(f);
+        for (int i=0;i<n;++i){ batch[i]->runs++; batch[i]->fn(batch[i]->arg); }
+        f = irq_save();
+        c->stat.ran += (uint32_t)n;
+        total += n;
+    }
+    q->running = 0;
+    irq_restore(f);
+    return total;
+}
+
+int work_run_pending(void){
+    wq_cpu_t* c = this_cpu();
+    return drain(c, &c->q[WORK_IRQEXIT]);
+}
+
+int work_run_worker(void){
+    wq_cpu_t* c = this_cpu();
+    int n = drain(c, &c->q[WORK_IRQEXIT]);
+    return n + drain(c, &c->q[WORK_THREAD]);
+}
+
+const wq_stat_t* work_stats(void){ return &this_cpu()->stat; }
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+// Deferred work ("bottom halves"). IRQ top halves queue a work item and
+// return; the item runs later with interrupts enabled, either at interrupt
+// exit or from the idle loop. Queuing an item that is already pending is a
+// no-op, so a burst of interrupts collapses into one batched run.
+//
+// Items created with work_init_thread only run from the worker (the shell's
+// idle loop), never on top of interrupted code, so they may touch state
+// such as the console that is not interrupt-safe.
+
+#define WQ_NCPU 1          // uniprocessor for now; one queue per CPU
+#define WQ_DEPTH 64        // max pending items per CPU (power of two)
+#define WQ_BATCH 16        // items taken per interrupts-off dequeue
+
+#define WORK_IRQEXIT 0
+#define WORK_THREAD  1
+
+typedef void (*work_fn_t)(void* arg);
+
+typedef struct {
+    work_fn_t fn;
+    void* arg;
+    volatile uint8_t pending;
+    uint8_t ctx;           // WORK_IRQEXIT or WORK_THREAD
+    uint32_t runs;
+} work_t;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t dropped;     // queue full
+    uint32_t ran;
+    uint32_t batches;
+    uint32_t max_batch;
+} wq_stat_t;
+
+void work_init(work_t* w, work_fn_t fn, void* arg);
+void work_init_thread(work_t* w, work_fn_t fn, void* arg);
+// Safe from IRQ context. 0 = queued, 1 = already pending, <0 = queue full
+int work_queue(work_t* w);
+// Interrupt exit: drain WORK_IRQEXIT items; returns the number run
+int work_run_pending(void);
+// Worker/idle loop: drain both queues; returns the number run
+int work_run_worker(void);
+int work_pending(void);
+const wq_stat_t* work_stats(void);
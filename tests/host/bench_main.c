@@ -0,0 +1,291 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "memory.h"
+#include "ramfs.h"
+#include "vfs.h"
+#include "shell.h"
+#include "history.h"
+#include "render.h"
+#include "console.h"
+#include "lz4.h"
+
+// Microbenchmarks in the shape of Google Benchmark: each BENCHMARK body
+// loops `while (bench_next(st))`, timing starts at the first call, and the
+// runner grows the iteration count until a run takes BENCH_MIN_NS. Output
+// is the familiar Time / CPU / Iterations table (per iteration, in ns), so
+// `perf record build/host/host_bench <filter>` profiles one benchmark.
+
+#define BENCH_MIN_NS 200000000ull   // 0.2 s per benchmark
+#define MAX_BENCH 64
+
+typedef struct {
+    uint64_t max_iters, iters;
+    uint64_t t0, t1, c0, c1;        // wall and CPU ns
+    uint64_t bytes;                 // set by the body for a bytes/s column
+} bench_state_t;
+
+typedef void (*bench_fn)(bench_state_t* st);
+static struct { const char* name; bench_fn fn; } benches[MAX_BENCH];
+static int nbench;
+
+#define BENCHMARK(fn_) \
+    static void fn_(bench_state_t* st); \
+    __attribute__((constructor)) static void reg_##fn_(void){ \
+        if (nbench < MAX_BENCH) { benches[nbench].name = #fn_; benches[nbench].fn = fn_; nbench++; } } \
+    static void fn_(bench_state_t* st)
+
+static uint64_t cpu_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_next(bench_state_t* st){
+    if (st->iters == 0) { st->t0 = host_ns(); st->c0 = cpu_ns(); }
+    if (st->iters++ < st->max_iters) return 1;
+    st->t1 = host_ns(); st->c1 = cpu_ns();
+    return 0;
+}
+
+// Keeps the compiler from dropping a result
+static volatile uint32_t sink;
+
+static void boot(void){
+    console_init();
+    mem_init();
+    vfs_init();
+    vfs_mount_ramfs();
+    history_reset();
+}
+
+static void fmt_time(char* b, size_t n, double ns){
+    if (ns < 10000) snprintf(b, n, "%.1f ns", ns);
+    else if (ns < 10000000) snprintf(b, n, "%.1f us", ns / 1000);
+    else snprintf(b, n, "%.1f ms", ns / 1000000);
+}
+
+// Each benchmark runs in its own process so pools and ramfs nodes start
+// fresh, as at boot
+static void run_one(int i){
+    bench_state_t st;
+    uint64_t n = 1;
+    for (;;){
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            memset(&st, 0, sizeof(st));
+            st.max_iters = n;
+            boot();
+            host_output_reset();
+            benches[i].fn(&st);
+            double wall = (double)(st.t1 - st.t0), cpu = (double)(st.c1 - st.c0);
+            if (wall < BENCH_MIN_NS && n < (1ull << 40)) _exit(3);   // too short: grow n
+            char tw[32], tc[32];
+            fmt_time(tw, sizeof(tw), wall / (double)n);
+            fmt_time(tc, sizeof(tc), cpu / (double)n);
+            printf("%-32s %13s %13s %12llu", benches[i].name, tw, tc, (unsigned long long)n);
+            if (st.bytes) printf("   bytes_per_second=%.1fMi/s", (double)st.bytes / (wall / 1e9) / (1024.0 * 1024.0));
+            printf("\n");
+            fflush(stdout);
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 3) { n *= 4; continue; }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) printf("%-32s failed\n", benches[i].name);
+        return;
+    }
+}
+
+int main(int argc, char** argv){
+    host_init();
+    printf("%-32s %13s %13s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    printf("------------------------------------------------------------------------------\n");
+    for (int i = 0; i < nbench; ++i){
+        int want = argc < 2;
+        for (int a = 1; a < argc; ++a) if (strstr(benches[i].name, argv[a])) want = 1;
+        if (want) run_one(i);
+    }
+    return 0;
+}
+
+// ---- allocator ----
+
+BENCHMARK(BM_uc_alloc_free){
+    while (bench_next(st)) { uchandle_t h = uc_alloc(CHUNK_SIZE); uc_free(h); }
+}
+
+// Single free chunks scattered through the pool, so a 4-chunk handle has
+// to gather them from far apart
+BENCHMARK(BM_uc_alloc_free_fragmented){
+    uchandle_t hs[MAX_BENCH];
+    int n = 0;
+    for (int k = 0; k < 100; ++k) { uchandle_t h = uc_alloc(10u * CHUNK_SIZE); if (k % 2 && n < MAX_BENCH) hs[n++] = h; }
+    for (int k = 0; k < n; ++k) uc_free(hs[k]);
+    while (bench_next(st)) { uchandle_t h = uc_alloc(4u * CHUNK_SIZE); uc_free(h); }
+}
+
+BENCHMARK(BM_uc_pwrite_read_16k){
+    static uint8_t buf[16384];
+    uchandle_t h = uc_alloc(sizeof(buf));
+    while (bench_next(st)) {
+        uc_pwrite(h, 0, buf, sizeof(buf));
+        uc_read(h, 0, buf, sizeof(buf));
+    }
+    st->bytes = st->max_iters * 2 * sizeof(buf);
+}
+
+// ---- ramfs / vfs ----
+
+BENCHMARK(BM_ramfs_create_delete){
+    vfs_mkdir("/bench");
+    while (bench_next(st)) { vfs_write("/bench/f", "x", 1); vfs_rm("/bench/f"); }
+}
+
+BENCHMARK(BM_ramfs_lookup_deep){
+    char p[64];
+    for (int i = 0; i < 50; ++i) { snprintf(p, sizeof(p), "/a/b/c/d/e/f%d", i); vfs_write(p, "x", 1); }
+    vfs_stat_t vst;
+    while (bench_next(st)) { vfs_stat("/a/b/c/d/e/f0", &vst); sink += vst.size; }
+}
+
+BENCHMARK(BM_vfs_append_64){
+    char line[64];
+    memset(line, 'a', sizeof(line));
+    uint32_t size = 0;
+    while (bench_next(st)) {
+        if (size >= 512u * 1024u) { vfs_rm("/log"); size = 0; }
+        vfs_append("/log", line, sizeof(line));
+        size += sizeof(line);
+    }
+    st->bytes = st->max_iters * sizeof(line);
+}
+
+BENCHMARK(BM_vfs_read_at_512){
+    static char data[256 * 1024], out[512];
+    vfs_write("/data", data, sizeof(data));
+    uint32_t off = 0, n = 0;
+    while (bench_next(st)) {
+        vfs_read_at("/data", off, out, sizeof(out), &n);
+        off = (off + 512u) % sizeof(data);
+    }
+    st->bytes = st->max_iters * sizeof(out);
+}
+
+// Random create / append / rewrite / read / remove over 64 files
+BENCHMARK(BM_vfs_churn){
+    static char buf[4096];
+    char path[32];
+    uint32_t rng = 99, n = 0;
+    while (bench_next(st)) {
+        uint32_t r = host_rand(&rng), f = r % 64;
+        snprintf(path, sizeof(path), "/c%u/file%u", f % 8, f);
+        switch ((r >> 8) % 5){
+        case 0: vfs_write(path, buf, (r >> 12) % 2048); break;
+        case 1: vfs_append(path, buf, (r >> 12) % 256); break;
+        case 2: case 3: vfs_read(path, buf, sizeof(buf), &n); break;
+        default: vfs_rm(path); break;
+        }
+    }
+}
+
+// ---- shell ----
+
+static int cmd_spam(int argc, char** argv){
+    uint32_t n = 0; char b[16];
+    if (argc < 2 || parse_u32_dec(argv[1], &n) != 0) return -1;
+    for (uint32_t i = 0; i < n; ++i) { u32_to_dec(i, b); sh_writeln(b); }
+    return 0;
+}
+static int count_begin(void* s, int argc, char** argv){ (void)s; (void)argc; (void)argv; return 0; }
+static void count_feed(void* s, const char* d, int n){ for (int i = 0; i < n; ++i) *(uint32_t*)s += d[i] == '\n'; }
+static void count_end(void* s){ sink += *(uint32_t*)s; }
+static const shell_filter_t count_filter = { count_begin, count_feed, count_end };
+static const shell_cmd_t spam_cmd = { "spam", cmd_spam, "spam <n>", "print 0..n-1", 0 };
+static const shell_cmd_t count_cmd = { "count", 0, "count", "count lines", &count_filter };
+
+BENCHMARK(BM_shell_path){
+    char out[SHELL_PATH_MAX];
+    vfs_mkdir("/home/user/src");
+    shell_chdir("/home/user/src");
+    while (bench_next(st)) { shell_path(out, "../lib/./x/../y.c"); sink += (uint8_t)out[1]; }
+}
+
+BENCHMARK(BM_shell_pipeline_1k_lines){
+    shell_register(&spam_cmd);
+    shell_register(&count_cmd);
+    char line[32];
+    while (bench_next(st)) { strcpy(line, "spam 1000 | count"); shell_exec(line); }
+}
+
+BENCHMARK(BM_history_add){
+    char line[32];
+    uint32_t i = 0;
+    while (bench_next(st)) { snprintf(line, sizeof(line), "cmd %u", i++ & 31); history_add(line); }
+}
+
+// ---- renderer ----
+
+static uint32_t make_doc(const char* path, int paras){
+    static char doc[512 * 1024];
+    int len = snprintf(doc, sizeof(doc), "<style>p.x{color:green} .hl{background:blue} #t{color:red}</style><h1 id=t>Bench</h1>");
+    for (int i = 0; i < paras && len < (int)sizeof(doc) - 128; ++i)
+        len += snprintf(doc + len, sizeof(doc) - (size_t)len,
+                        "<p class=x>paragraph %d with <span class=hl>inline</span> text and <b>markup</b></p>\n", i);
+    vfs_write(path, doc, (uint32_t)len);
+    return (uint32_t)len;
+}
+
+// Alternates two files so every render misses the layout cache
+BENCHMARK(BM_render_cold_500p){
+    uint32_t len = make_doc("/a.html", 500);
+    make_doc("/b.html", 500);
+    uint64_t k = 0;
+    while (bench_next(st)) render_file(k++ & 1 ? "/b.html" : "/a.html");
+    st->bytes = st->max_iters * len;
+}
+
+BENCHMARK(BM_render_cached_500p){
+    make_doc("/a.html", 500);
+    render_file("/a.html");
+    while (bench_next(st)) render_file("/a.html");
+}
+
+BENCHMARK(BM_render_scroll){
+    make_doc("/a.html", 2000);
+    render_file("/a.html");
+    int dir = 1;
+    while (bench_next(st)) { if (render_scroll(dir * 20) == 0 || (dir > 0 && render_scroll(0) > 1900)) dir = -dir; }
+}
+
+// ---- lz4 (boot stub decompressor) ----
+
+// Machine code, like the kernel image the stub unpacks: this binary
+static uint32_t lz4_pack_self(uint8_t* raw, uint32_t* n, uint8_t* packed, uint32_t pcap){
+    static uint8_t work[LZ4_WORK_SIZE];
+    FILE* f = fopen("/proc/self/exe", "rb");
+    *n = f ? (uint32_t)fread(raw, 1, *n, f) : 0;
+    if (f) fclose(f);
+    return (uint32_t)lz4_compress(raw, *n, packed, pcap, work);
+}
+
+BENCHMARK(BM_lz4_decompress_256k){
+    static uint8_t raw[256 * 1024], packed[LZ4_COMPRESS_BOUND(256 * 1024)], out[256 * 1024];
+    uint32_t n = sizeof(raw), c = lz4_pack_self(raw, &n, packed, sizeof(packed));
+    while (bench_next(st)) sink = (uint32_t)lz4_decompress(packed, c, out, n);
+    st->bytes = st->max_iters * n;
+}
+
+BENCHMARK(BM_lz4_compress_256k){
+    static uint8_t raw[256 * 1024], packed[LZ4_COMPRESS_BOUND(256 * 1024)], work[LZ4_WORK_SIZE];
+    uint32_t n = sizeof(raw);
+    lz4_pack_self(raw, &n, packed, sizeof(packed));
+    while (bench_next(st)) sink = (uint32_t)lz4_compress(raw, n, packed, sizeof(packed), work);
+    st->bytes = st->max_iters * n;
+}
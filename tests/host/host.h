@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+// Host build of the portable kernel modules (memory, ramfs, vfs, shell,
+// history, dom/css/script/render, window, lz4). stubs.c stands in for the
+// console, TSC and serial; the rest is the kernel source compiled natively
+// with -DFOXOS_HOST.
+
+// Maps the fixed-address arenas the renderer expects; call first
+void host_init(void);
+
+// The console is a CONSOLE_COLS x CONSOLE_ROWS cell grid plus a capture of
+// everything written through console_write*/putc
+uint16_t host_cell(int x, int y);
+const char* host_output(void);          // captured text since the last reset
+void host_output_reset(void);
+int host_output_has(const char* s);     // substring of the captured text
+
+// Monotonic nanoseconds
+uint64_t host_ns(void);
+
+// Deterministic PRNG for the randomized tests and benchmarks
+uint32_t host_rand(uint32_t* state);
+
+// Minimal test framework. Each TEST runs in its own forked process, so
+// kernel state (pools, ramfs nodes, cwd) starts fresh and a crash only
+// fails that test.
+typedef void (*host_test_fn)(void);
+void host_add_test(const char* name, host_test_fn fn);
+void host_fail(const char* file, int line, const char* expr);
+
+#define TEST(name) \
+    static void name(void); \
+    __attribute__((constructor)) static void reg_##name(void){ host_add_test(#name, name); } \
+    static void name(void)
+
+#define CHECK(c) do { if (!(c)) { host_fail(__FILE__, __LINE__, #c); return; } } while (0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "host.h"
+#include "console.h"
+#include "render.h"
+#include "tsc.h"
+#include "io.h"
+
+static uint16_t cells[CONSOLE_ROWS][CONSOLE_COLS];
+static char out[1 << 16];
+static uint32_t out_len;
+static console_mirror_fn mirror;
+
+void host_init(void){
+    void* p = mmap((void*)(uintptr_t)RENDER_DOM_ADDR, RENDER_DOM_SIZE + RENDER_LAYOUT_SIZE, PROT_READ|PROT_WRITE,
+                   MAP_FIXED_NOREPLACE|MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p != (void*)(uintptr_t)RENDER_DOM_ADDR) { perror("host: mmap render arena"); exit(2); }
+    tsc_init();
+}
+
+uint64_t host_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t host_rand(uint32_t* s){ *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+// Console: a cell grid and a text capture (the last 64 KiB are kept)
+uint16_t host_cell(int x, int y){ return cells[y][x]; }
+const char* host_output(void){ return out; }
+void host_output_reset(void){ out_len = 0; out[0] = 0; }
+int host_output_has(const char* s){ return strstr(out, s) != 0; }
+
+void console_init(void){ console_clear(); }
+void console_clear(void){ memset(cells, 0, sizeof(cells)); }
+void console_set_color(uint8_t fg, uint8_t bg){ (void)fg; (void)bg; }
+void console_putc(char c){
+    if (out_len + 1 >= sizeof(out)) { memmove(out, out + sizeof(out)/2, sizeof(out)/2); out_len -= sizeof(out)/2; }
+    out[out_len++] = c; out[out_len] = 0;
+    if (mirror) mirror(c);
+}
+void console_write(const char* s){ while (*s) console_putc(*s++); }
+void console_writeln(const char* s){ console_write(s); console_putc('\n'); }
+console_mirror_fn console_set_mirror(console_mirror_fn fn){ console_mirror_fn old = mirror; mirror = fn; return old; }
+void console_batch_begin(void){}
+void console_batch_end(void){}
+void console_flush(void){}
+void console_redraw(void){}
+void console_put_cell(int x, int y, uint16_t cell){
+    if (x >= 0 && x < CONSOLE_COLS && y >= 0 && y < CONSOLE_ROWS) cells[y][x] = cell;
+}
+void console_put_cells(int x, int y, const uint16_t* c, int n){ for (int i = 0; i < n; ++i) console_put_cell(x + i, y, c[i]); }
+uint16_t console_get_cell(int x, int y){
+    return x >= 0 && x < CONSOLE_COLS && y >= 0 && y < CONSOLE_ROWS ? cells[y][x] : 0;
+}
+
+// TSC: calibrated once against CLOCK_MONOTONIC
+static uint32_t khz;
+
+void tsc_init(void){
+    uint64_t n0 = host_ns(), t0 = rdtsc();
+    while (host_ns() - n0 < 20000000u) {}
+    uint64_t n1 = host_ns(), t1 = rdtsc();
+    khz = (uint32_t)((t1 - t0) * 1000000u / (n1 - n0));
+}
+uint32_t tsc_khz(void){ return khz; }
+uint64_t tsc_to_us(uint64_t cycles){ return khz ? cycles * 1000u / khz : 0; }
+uint32_t tsc_per_sec(uint64_t count, uint64_t cycles){
+    if (!cycles) return 0xFFFFFFFFu;
+    unsigned __int128 r = (unsigned __int128)count * khz * 1000u / cycles;
+    return r > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)r;
+}
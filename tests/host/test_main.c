@@ -0,0 +1,593 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "memory.h"
+#include "ramfs.h"
+#include "vfs.h"
+#include "shell.h"
+#include "history.h"
+#include "render.h"
+#include "console.h"
+#include "lz4.h"
+
+// ---- runner ----
+
+#define MAX_TESTS 128
+static struct { const char* name; host_test_fn fn; } tests[MAX_TESTS];
+static int ntests;
+
+void host_add_test(const char* name, host_test_fn fn){
+    if (ntests < MAX_TESTS) { tests[ntests].name = name; tests[ntests].fn = fn; ntests++; }
+}
+
+void host_fail(const char* file, int line, const char* expr){
+    fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expr);
+    fflush(stderr);
+    _exit(1);
+}
+
+// Fresh kernel state for every test (each runs in a new process)
+static void boot(void){
+    console_init();
+    mem_init();
+    vfs_init();
+    vfs_mount_ramfs();
+    history_reset();
+}
+
+int main(int argc, char** argv){
+    host_init();
+    int failed = 0, run = 0;
+    for (int i = 0; i < ntests; ++i){
+        if (argc > 1) {
+            int want = 0;
+            for (int a = 1; a < argc; ++a) if (strstr(tests[i].name, argv[a])) want = 1;
+            if (!want) continue;
+        }
+        run++;
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) { boot(); tests[i].fn(); _exit(0); }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok && WIFSIGNALED(status)) fprintf(stderr, "  killed by signal %d\n", WTERMSIG(status));
+        printf("[%s] %s\n", ok ? " OK " : "FAIL", tests[i].name);
+        failed += !ok;
+    }
+    printf("%d/%d tests passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
+
+// ---- memory ----
+
+static void fill(uint8_t* b, uint32_t n, uint32_t seed){ for (uint32_t i = 0; i < n; ++i) b[i] = (uint8_t)(seed * 131u + i * 7u); }
+
+TEST(test_uc_roundtrip){
+    static uint8_t src[3 * CHUNK_SIZE], dst[3 * CHUNK_SIZE];
+    uchandle_t h = uc_alloc(sizeof(src));
+    CHECK(h != 0);
+    CHECK_EQ(uc_size(h), 3u * CHUNK_SIZE);
+    fill(src, sizeof(src), 1);
+    CHECK_EQ(uc_write(h, src, 100), 0);
+    CHECK_EQ(uc_write(h, src + 100, sizeof(src) - 100), 0);   // crosses both chunk boundaries
+    CHECK_EQ(uc_used(h), (uint32_t)sizeof(src));
+    CHECK_EQ(uc_write(h, src, 1), -2);                          // full
+    CHECK_EQ(uc_read(h, 0, dst, sizeof(dst)), 0);
+    CHECK(memcmp(src, dst, sizeof(src)) == 0);
+    CHECK_EQ(uc_pwrite(h, CHUNK_SIZE - 3, "abcdef", 6), 0);
+    CHECK_EQ(uc_read(h, CHUNK_SIZE - 3, dst, 6), 0);
+    CHECK(memcmp(dst, "abcdef", 6) == 0);
+    CHECK_EQ(uc_pwrite(h, 3 * CHUNK_SIZE - 2, "xyz", 3), -2);
+    CHECK_EQ(uc_free(h), 0);
+}
+
+TEST(test_uc_handles){
+    uchandle_t a = uc_alloc(10), b = uc_alloc(10);
+    CHECK(a && b && a != b);
+    CHECK_EQ(uc_free(a), 0);
+    CHECK_EQ(uc_free(a), -1);                   // stale
+    CHECK_EQ(uc_write(a, "x", 1), -1);
+    CHECK_EQ(uc_size(a), 0u);
+    CHECK_EQ(uc_free(0), -1);
+    uchandle_t c = uc_alloc(10);                // reuses a's slot with a new handle
+    CHECK(c && c != a);
+    CHECK_EQ(uc_free(a), -1);
+    CHECK_EQ(uc_free(b ^ 0x100), -1);           // right slot, wrong tag
+    CHECK_EQ(uc_alloc(257u * CHUNK_SIZE), 0u);  // over the per-handle limit
+}
+
+TEST(test_uc_exhaustion){
+    uchandle_t hs[8]; int n = 0;
+    while (n < 8 && (hs[n] = uc_alloc(256u * CHUNK_SIZE)) != 0) n++;
+    CHECK_EQ(n, POOL_CHUNKS / 256);
+    CHECK_EQ(uc_alloc(1), 0u);
+    CHECK_EQ(uc_free(hs[1]), 0);
+    uchandle_t h = uc_alloc(CHUNK_SIZE * 100);  // partial allocation rolls back cleanly
+    CHECK(h != 0);
+    CHECK_EQ(uc_alloc(CHUNK_SIZE * 200), 0u);
+    CHECK(uc_alloc(CHUNK_SIZE * 156) != 0);
+}
+
+// Random sizes and lifetimes; every live handle keeps its own pattern and
+// the pool must come back whole once everything is freed
+TEST(test_uc_fragmentation){
+    enum { LIVE = 96, STEPS = 20000 };
+    static uint8_t buf[64 * CHUNK_SIZE], chk[64 * CHUNK_SIZE];
+    uchandle_t h[LIVE] = {0}; uint32_t len[LIVE] = {0}, seed[LIVE] = {0};
+    uint32_t rng = 12345;
+    for (int s = 0; s < STEPS; ++s){
+        int i = (int)(host_rand(&rng) % LIVE);
+        if (h[i]) {
+            CHECK_EQ(uc_read(h[i], 0, chk, len[i]), 0);
+            fill(buf, len[i], seed[i]);
+            CHECK(memcmp(buf, chk, len[i]) == 0);
+            CHECK_EQ(uc_free(h[i]), 0);
+            h[i] = 0;
+        } else {
+            uint32_t r = host_rand(&rng);
+            uint32_t n = r % 8 ? 1 + r % (4 * CHUNK_SIZE) : 1 + r % sizeof(buf);
+            uchandle_t x = uc_alloc(n);
+            if (!x) continue;                   // pool full right now
+            seed[i] = r; len[i] = n; h[i] = x;
+            fill(buf, n, r);
+            CHECK_EQ(uc_write(x, buf, n), 0);
+        }
+    }
+    for (int i = 0; i < LIVE; ++i) if (h[i]) CHECK_EQ(uc_free(h[i]), 0);
+    for (int k = 0; k < POOL_CHUNKS / 256; ++k) CHECK(uc_alloc(256u * CHUNK_SIZE) != 0);
+    CHECK_EQ(uc_alloc(1), 0u);
+}
+
+// ---- ramfs / vfs ----
+
+static char ls_names[1024]; static int ls_count;
+static void ls_cb(const char* name, int isDir){
+    strcat(ls_names, name); strcat(ls_names, isDir ? "/ " : " ");
+    ls_count++;
+}
+
+TEST(test_vfs_basic){
+    char b[64]; uint32_t n = 0; vfs_stat_t st;
+    CHECK_EQ(vfs_write("/a/b/f.txt", "hello", 5), 0);       // parents are created
+    CHECK_EQ(vfs_stat("/a/b", &st), 0);
+    CHECK(st.exists && st.isDir && st.children == 1);
+    CHECK_EQ(vfs_read("/a/b/f.txt", b, sizeof(b), &n), 0);
+    CHECK(n == 5 && memcmp(b, "hello", 5) == 0);
+    CHECK_EQ(vfs_stat("/a/b/f.txt", &st), 0);
+    uint32_t gen = st.gen;
+    CHECK(st.size == 5 && !st.isDir);
+    CHECK_EQ(vfs_write("/a/b/f.txt", "bye", 3), 0);
+    CHECK_EQ(vfs_stat("/a/b/f.txt", &st), 0);
+    CHECK(st.size == 3 && st.gen != gen);
+    CHECK_EQ(vfs_mkdir("/a/c"), 0);
+    CHECK_EQ(vfs_ls("/a", ls_cb), 0);
+    CHECK(ls_count == 2 && strstr(ls_names, "b/") && strstr(ls_names, "c/"));
+    CHECK(vfs_ls("/a/b/f.txt", ls_cb) < 0);
+    CHECK(vfs_read("/a/b", b, sizeof(b), &n) < 0);
+    CHECK_EQ(vfs_rm("/a/b/f.txt"), 0);
+    CHECK(vfs_stat("/a/b/f.txt", &st) < 0 || !st.exists);
+    CHECK(vfs_rm("/a/b/f.txt") < 0);
+    CHECK(vfs_rm("/") < 0);
+}
+
+TEST(test_vfs_read_at){
+    char b[16]; uint32_t n = 99;
+    CHECK_EQ(vfs_write("/f", "0123456789", 10), 0);
+    CHECK_EQ(vfs_read_at("/f", 4, b, 3, &n), 0);
+    CHECK(n == 3 && memcmp(b, "456", 3) == 0);
+    CHECK_EQ(vfs_read_at("/f", 8, b, sizeof(b), &n), 0);
+    CHECK(n == 2 && memcmp(b, "89", 2) == 0);
+    CHECK_EQ(vfs_read_at("/f", 10, b, sizeof(b), &n), 0);
+    CHECK_EQ(n, 0u);
+    CHECK_EQ(vfs_read_at("/f", 1000, b, sizeof(b), &n), 0);
+    CHECK_EQ(n, 0u);
+    CHECK(vfs_read_at("/nope", 0, b, sizeof(b), &n) < 0);
+}
+
+TEST(test_vfs_append_stream){
+    static char want[200000], got[200000];
+    uint32_t len = 0, n = 0;
+    for (int i = 0; i < 20000; ++i){
+        char line[16]; int k = snprintf(line, sizeof(line), "%d\n", i);
+        CHECK_EQ(vfs_append("/log", line, (uint32_t)k), 0);
+        memcpy(want + len, line, (size_t)k); len += (uint32_t)k;
+    }
+    CHECK_EQ(vfs_read("/log", got, sizeof(got), &n), 0);
+    CHECK_EQ(n, len);
+    CHECK(memcmp(want, got, len) == 0);
+    CHECK_EQ(vfs_append("/log", "", 0), 0);
+    CHECK(vfs_append("/", "x", 1) < 0);
+}
+
+// Removed nodes go back on the free list; far more than the 256-node pool
+// must be creatable over time
+TEST(test_ramfs_node_reuse){
+    char p[32];
+    for (int i = 0; i < 5000; ++i){
+        snprintf(p, sizeof(p), "/d%d/f%d", i % 3, i);
+        CHECK_EQ(vfs_write(p, "x", 1), 0);
+        CHECK_EQ(vfs_rm(p), 0);
+    }
+    int made = 0;
+    for (;;){
+        snprintf(p, sizeof(p), "/n%d", made);
+        if (vfs_mkdir(p) != 0) break;
+        made++;
+        CHECK(made < 1000);
+    }
+    CHECK(made >= 250);
+}
+
+// Random create/append/rewrite/read/rm over a few directories, checked
+// against a model kept in host memory
+TEST(test_vfs_churn){
+    enum { FILES = 48, MAXLEN = 6000, STEPS = 20000 };
+    static char model[FILES][MAXLEN], buf[MAXLEN + 64];
+    static uint32_t mlen[FILES]; static int live[FILES];
+    uint32_t rng = 777;
+    char path[32];
+    for (int s = 0; s < STEPS; ++s){
+        int f = (int)(host_rand(&rng) % FILES);
+        snprintf(path, sizeof(path), "/c%d/s%d/file%d", f % 4, f % 3, f);
+        uint32_t op = host_rand(&rng) % 10, n = 0;
+        if (op < 3) {                               // rewrite
+            uint32_t len = host_rand(&rng) % 2000;
+            for (uint32_t i = 0; i < len; ++i) model[f][i] = (char)('a' + (s + i) % 26);
+            CHECK_EQ(vfs_write(path, model[f], len), 0);
+            mlen[f] = len; live[f] = 1;
+        } else if (op < 6) {                        // append
+            uint32_t len = host_rand(&rng) % 300;
+            if (mlen[f] + len > MAXLEN) len = MAXLEN - mlen[f];
+            char* at = model[f] + (live[f] ? mlen[f] : 0);
+            for (uint32_t i = 0; i < len; ++i) at[i] = (char)('A' + (s + i) % 26);
+            CHECK_EQ(vfs_append(path, at, len), 0);
+            mlen[f] = (live[f] ? mlen[f] : 0) + len; live[f] = 1;
+        } else if (op < 8) {                        // read a random window
+            if (!live[f]) { CHECK(vfs_read(path, buf, sizeof(buf), &n) < 0); continue; }
+            uint32_t off = mlen[f] ? host_rand(&rng) % (mlen[f] + 1) : 0;
+            CHECK_EQ(vfs_read_at(path, off, buf, sizeof(buf), &n), 0);
+            CHECK_EQ(n, mlen[f] - off);
+            CHECK(memcmp(buf, model[f] + off, n) == 0);
+        } else if (live[f]) {                       // remove
+            CHECK_EQ(vfs_rm(path), 0);
+            live[f] = 0; mlen[f] = 0;
+        }
+    }
+    for (int f = 0; f < FILES; ++f){
+        snprintf(path, sizeof(path), "/c%d/s%d/file%d", f % 4, f % 3, f);
+        vfs_stat_t st; uint32_t n = 0;
+        if (!live[f]) { CHECK(vfs_stat(path, &st) < 0 || !st.exists); continue; }
+        CHECK_EQ(vfs_stat(path, &st), 0);
+        CHECK_EQ(st.size, mlen[f]);
+        CHECK_EQ(vfs_read(path, buf, sizeof(buf), &n), 0);
+        CHECK(n == mlen[f] && memcmp(buf, model[f], n) == 0);
+        CHECK_EQ(vfs_rm(path), 0);
+    }
+    // Everything freed: the whole pool is allocatable again
+    for (int k = 0; k < POOL_CHUNKS / 256; ++k) CHECK(uc_alloc(256u * CHUNK_SIZE) != 0);
+}
+
+// ---- shell ----
+
+static int cmd_emit(int argc, char** argv){ for (int i = 1; i < argc; ++i) sh_writeln(argv[i]); return 0; }
+
+static int cmd_spam(int argc, char** argv){
+    uint32_t n = 0; char b[16];
+    if (argc < 2 || parse_u32_dec(argv[1], &n) != 0) return -1;
+    for (uint32_t i = 0; i < n; ++i) { u32_to_dec(i, b); sh_writeln(b); }
+    return 0;
+}
+
+typedef struct { uint32_t bytes, lines; } tally_st;
+static int tally_begin(void* st, int argc, char** argv){ (void)st; (void)argv; return argc > 1 ? -1 : 0; }
+static void tally_feed(void* st, const char* d, int n){
+    tally_st* t = (tally_st*)st;
+    t->bytes += (uint32_t)n;
+    for (int i = 0; i < n; ++i) t->lines += d[i] == '\n';
+}
+static void tally_end(void* st){
+    const tally_st* t = (const tally_st*)st; char b[16];
+    sh_write("lines="); u32_to_dec(t->lines, b); sh_write(b);
+    sh_write(" bytes="); u32_to_dec(t->bytes, b); sh_writeln(b);
+}
+static const shell_filter_t tally_filter = { tally_begin, tally_feed, tally_end };
+
+static const shell_cmd_t test_cmds[] = {
+    { "emit", cmd_emit, "emit <words...>", "one word per line", 0 },
+    { "spam", cmd_spam, "spam <n>", "print 0..n-1", 0 },
+    { "tally", 0, "tally", "count input lines and bytes", &tally_filter },
+};
+
+static void register_test_cmds(void){
+    for (unsigned i = 0; i < sizeof(test_cmds)/sizeof(test_cmds[0]); ++i) shell_register(&test_cmds[i]);
+}
+
+static int run(const char* line){ char b[SHELL_LINE_MAX]; strncpy(b, line, sizeof(b) - 1); b[sizeof(b)-1] = 0; return shell_exec(b); }
+
+static int file_is(const char* path, const char* want){
+    static char b[4096]; uint32_t n = 0;
+    if (vfs_read(path, b, sizeof(b), &n) != 0) return 0;
+    return n == strlen(want) && memcmp(b, want, n) == 0;
+}
+
+TEST(test_shell_registry){
+    register_test_cmds();
+    CHECK_EQ(shell_register(&test_cmds[0]), -2);
+    host_output_reset();
+    CHECK_EQ(run("EMIT  one 'two words'   \"three\""), 0);
+    CHECK_EQ(strcmp(host_output(), "one\ntwo words\nthree\n"), 0);
+    CHECK_EQ(run("   "), 0);
+    CHECK_EQ(run("nosuch arg"), -127);
+    host_output_reset();
+    shell_help();
+    CHECK(host_output_has("spam <n>") && host_output_has("count input lines"));
+}
+
+TEST(test_shell_path_normalize){
+    char out[SHELL_PATH_MAX];
+    struct { const char* in; const char* want; } cases[] = {
+        { "/", "/" }, { "a", "/a" }, { "/a/b/../c", "/a/c" }, { "/x/./y", "/x/y" },
+        { "//x//y//", "/x/y" }, { "..", "/" }, { "/../..", "/" }, { "a/b/../../c", "/c" },
+    };
+    for (unsigned i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i){
+        shell_path(out, cases[i].in);
+        if (strcmp(out, cases[i].want)) fprintf(stderr, "  shell_path(%s) = %s\n", cases[i].in, out);
+        CHECK_EQ(strcmp(out, cases[i].want), 0);
+    }
+    CHECK_EQ(vfs_mkdir("/home/u"), 0);
+    CHECK_EQ(shell_chdir("/home/u"), 0);
+    CHECK_EQ(strcmp(shell_cwd(), "/home/u"), 0);
+    shell_path(out, "../v/./w");
+    CHECK_EQ(strcmp(out, "/home/v/w"), 0);
+    CHECK(shell_chdir("/missing") < 0);
+    CHECK_EQ(strcmp(shell_cwd(), "/home/u"), 0);
+}
+
+TEST(test_shell_pipeline){
+    register_test_cmds();
+    host_output_reset();
+    CHECK_EQ(run("emit a bb ccc|tally"), 0);
+    CHECK(host_output_has("lines=3 bytes=9"));
+    host_output_reset();
+    CHECK_EQ(run("spam 100000 | tally"), 0);          // far more than one pipe ring
+    CHECK(host_output_has("lines=100000 bytes=588890"));
+    CHECK_EQ(run("emit x y > /t/o"), 0);
+    CHECK(file_is("/t/o", "x\ny\n"));
+    CHECK_EQ(run("emit z >>/t/o"), 0);
+    CHECK(file_is("/t/o", "x\ny\nz\n"));
+    CHECK_EQ(run("emit q > /t/o"), 0);
+    CHECK(file_is("/t/o", "q\n"));
+    host_output_reset();
+    CHECK_EQ(run("tally < /t/o"), 0);
+    CHECK(host_output_has("lines=1 bytes=2"));
+    CHECK_EQ(run("spam 3 | tally | tally > /t/n"), 0);
+    CHECK(file_is("/t/n", "lines=1 bytes=16\n"));
+    CHECK_EQ(run("emit a |"), -2);
+    CHECK_EQ(run("emit a | emit b"), -2);
+    CHECK_EQ(run("tally < /missing"), -2);
+    CHECK_EQ(run("emit a >"), -2);
+    CHECK(run("tally extra < /t/o") < 0);
+}
+
+TEST(test_shell_run_file){
+    register_test_cmds();
+    const char* rc = "# comment\n\nemit hi\nnosuch\nspam 2 | tally\n";
+    CHECK_EQ(vfs_write("/init/rc", rc, (uint32_t)strlen(rc)), 0);
+    host_output_reset();
+    CHECK_EQ(shell_run_file("/init/rc"), 1);
+    CHECK(host_output_has("foxos> emit hi\nhi\n"));
+    CHECK(host_output_has("lines=2 bytes=4"));
+    CHECK(!host_output_has("comment"));
+    CHECK_EQ(shell_run_file("/missing"), -1);
+}
+
+// ---- history ----
+
+TEST(test_history_ring){
+    CHECK_EQ(history_count(), 0);
+    CHECK(history_get(0) == 0);
+    history_add("");
+    history_add("ls");
+    history_add("ls");
+    CHECK_EQ(history_count(), 1);
+    history_add("cd /");
+    CHECK_EQ(strcmp(history_get(0), "cd /"), 0);
+    CHECK_EQ(strcmp(history_get(1), "ls"), 0);
+    CHECK(history_get(2) == 0 && history_get(-1) == 0);
+    char b[16];
+    for (int i = 0; i < HISTORY_MAX + 5; ++i) { snprintf(b, sizeof(b), "c%d", i); history_add(b); }
+    CHECK_EQ(history_count(), HISTORY_MAX);
+    snprintf(b, sizeof(b), "c%d", HISTORY_MAX + 4);
+    CHECK_EQ(strcmp(history_get(0), b), 0);
+    CHECK_EQ(strcmp(history_get(HISTORY_MAX - 1), "c5"), 0);
+    static char longline[HISTORY_LINE * 2];
+    memset(longline, 'x', sizeof(longline) - 1);
+    history_add(longline);
+    CHECK_EQ(strlen(history_get(0)), (size_t)HISTORY_LINE - 1);
+}
+
+// ---- render ----
+
+static int screen_has(const char* s){
+    int n = (int)strlen(s);
+    for (int y = 0; y < CONSOLE_ROWS; ++y)
+        for (int x = 0; x + n <= CONSOLE_COLS; ++x){
+            int k = 0;
+            while (k < n && (char)(host_cell(x + k, y) & 0xFF) == s[k]) k++;
+            if (k == n) return 1;
+        }
+    return 0;
+}
+
+TEST(test_render_document){
+    const char* doc =
+        "<style>p.warn { color: red } #hide { display: none }</style>"
+        "<h1>Title</h1><p class=warn>hello world</p><p id=hide>secret</p>"
+        "<div>a<span>b</span></div><script>console.log('js', 1+2)</script>";
+    CHECK_EQ(vfs_write("/doc.html", doc, (uint32_t)strlen(doc)), 0);
+    CHECK_EQ(render_file("/doc.html"), 0);
+    const render_stats_t* st = render_stats();
+    CHECK(!st->truncated && !st->cached);
+    CHECK(st->dom.elements >= 7);
+    CHECK_EQ(st->css.rules, 2u);
+    CHECK_EQ(st->script.scripts, 1u);
+    CHECK_EQ(st->script.errors, 0u);
+    CHECK(screen_has("Title") && screen_has("hello world") && screen_has("js 3"));
+    CHECK(!screen_has("secret"));
+    CHECK_EQ(render_file("/doc.html"), 0);
+    CHECK(render_stats()->cached);
+    render_close();
+    CHECK(render_file("/missing.html") < 0);
+}
+
+TEST(test_render_large_document){
+    static char doc[1 << 20]; int len = 0;
+    for (int i = 0; i < 5000 && len < (int)sizeof(doc) - 64; ++i)
+        len += snprintf(doc + len, sizeof(doc) - (size_t)len, "<p class=c%d>line %d <b>bold</b></p>\n", i, i);
+    // Tags the renderer matches by pointer, after thousands of distinct strings
+    len += snprintf(doc + len, sizeof(doc) - (size_t)len,
+        "<style>.c4999 { color: red }</style><h1>tail</h1><br><script>console.log('from'+'js')</script>");
+    CHECK_EQ(vfs_write("/big.html", doc, (uint32_t)len), 0);
+    CHECK_EQ(render_file("/big.html"), 0);
+    const render_stats_t* st = render_stats();
+    CHECK(!st->truncated && st->lines >= 5000);
+    CHECK(st->dom.strings > DOM_INTERN_SLOTS);
+    CHECK_EQ(st->css.rules, 1u);
+    CHECK_EQ(st->script.scripts, 1u);
+    CHECK(screen_has("line 0"));
+    CHECK(render_scroll(4990) > 0);
+    CHECK(screen_has("line 4999") && screen_has("# tail") && screen_has("fromjs"));
+    CHECK(!screen_has("console.log"));
+    render_close();
+}
+
+// More distinct text runs than the initial intern table takes at 3/4 load
+TEST(test_render_many_text_runs){
+    static char doc[1 << 17]; int len = 0;
+    for (int i = 0; i < DOM_INTERN_SLOTS; ++i)
+        len += snprintf(doc + len, sizeof(doc) - (size_t)len, "t%d<br>", i);
+    len += snprintf(doc + len, sizeof(doc) - (size_t)len, "<script>console.log('from'+'js')</script>x");
+    CHECK(len < (int)sizeof(doc) - 1);
+    CHECK_EQ(vfs_write("/runs.html", doc, (uint32_t)len), 0);
+    CHECK_EQ(render_file("/runs.html"), 0);
+    const render_stats_t* st = render_stats();
+    CHECK(st->dom.texts > DOM_INTERN_SLOTS * 3 / 4);
+    CHECK_EQ(st->script.scripts, 1u);
+    CHECK(render_scroll(DOM_INTERN_SLOTS) > 0);
+    CHECK(screen_has("fromjs") && !screen_has("console.log"));
+    render_close();
+}
+
+// ---- script ----
+
+static char script_out[4096]; static int script_outlen;
+static void script_capture(void* ctx, const char* s, int len){
+    (void)ctx;
+    if (script_outlen + len + 1 >= (int)sizeof(script_out)) return;
+    memcpy(script_out + script_outlen, s, (size_t)len);
+    script_outlen += len; script_out[script_outlen++] = '\n'; script_out[script_outlen] = 0;
+}
+static int script_run(const char* src){
+    script_outlen = 0; script_out[0] = 0;
+    return script_exec(src, (int)strlen(src));
+}
+
+TEST(test_script_nesting_limit){
+    static char src[8192]; int n;
+    script_begin(script_capture, 0);
+    // Within the limit compiles and runs
+    n = sprintf(src, "console.log(");
+    for (int i = 0; i < 40; ++i) src[n++] = '(';
+    n += sprintf(src + n, "6*7");
+    for (int i = 0; i < 40; ++i) src[n++] = ')';
+    sprintf(src + n, ")");
+    CHECK_EQ(script_run(src), 0);
+    CHECK(strstr(script_out, "42") != 0);
+    // Deep enough to overflow the kernel stack without the limit
+    n = sprintf(src, "var x = ");
+    for (int i = 0; i < 3000; ++i) src[n++] = '(';
+    n += sprintf(src + n, "1");
+    for (int i = 0; i < 3000; ++i) src[n++] = ')';
+    src[n] = 0;
+    CHECK(script_run(src) < 0);
+    CHECK(strstr(script_out, "nested too deeply") != 0);
+    n = 0;
+    for (int i = 0; i < 3000; ++i) src[n++] = '{';
+    src[n] = 0;
+    CHECK(script_run(src) < 0);
+    n = sprintf(src, "var y = ");
+    for (int i = 0; i < 3000; ++i) src[n++] = '-';
+    sprintf(src + n, "1;");
+    CHECK(script_run(src) < 0);
+}
+
+TEST(test_script_break_in_function){
+    script_begin(script_capture, 0);
+    // A function declared inside a loop does not see that loop
+    CHECK(script_run("while (1) { function f(){ break; } break; }") < 0);
+    CHECK(strstr(script_out, "break outside a loop") != 0);
+    CHECK(script_run("for (var i = 0; i < 2; i++) { function g(){ continue; } }") < 0);
+    CHECK(strstr(script_out, "continue outside a loop") != 0);
+    // Loops inside the body, and the enclosing loop after it, still work
+    CHECK_EQ(script_run("var n = 0; while (n < 3) { function h(k){ while (1) { if (k) break; k++; } return k; } n += h(0); if (n > 1) break; } console.log(n)"), 0);
+    CHECK(strstr(script_out, "2") != 0);
+}
+
+// ---- lz4 ----
+
+// Runs of literals, short and long matches (some overlapping, offset < 4)
+static void lz4_sample(uint8_t* b, uint32_t n, uint32_t seed){
+    uint32_t r = seed, i = 0;
+    while (i < n){
+        uint32_t k = host_rand(&r), len = 1 + k % 300;
+        if (len > n - i) len = n - i;
+        if (i < 16 || k % 3 == 0) { for (uint32_t j = 0; j < len; ++j) b[i + j] = (uint8_t)host_rand(&r); }
+        else { uint32_t off = 1 + (k >> 9) % (i < 70000 ? i : 70000); for (uint32_t j = 0; j < len; ++j) b[i + j] = b[i + j - off]; }
+        i += len;
+    }
+}
+
+TEST(test_lz4_roundtrip){
+    static uint8_t raw[200000], packed[LZ4_COMPRESS_BOUND(200000)], out[200000], work[LZ4_WORK_SIZE];
+    static const uint32_t sizes[] = { 0, 1, 12, 13, 100, 65536, 200000 };
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k){
+        uint32_t n = sizes[k];
+        lz4_sample(raw, n, k + 1);
+        int c = lz4_compress(raw, n, packed, sizeof(packed), work);
+        CHECK(c > 0);
+        CHECK_EQ(lz4_decompress(packed, (uint32_t)c, out, n), (int)n);
+        CHECK(memcmp(out, raw, n) == 0);
+        if (n) CHECK_EQ(lz4_decompress(packed, (uint32_t)c, out, n - 1), LZ4_ERR_OVERFLOW);
+    }
+    memset(raw, 'a', 100000);                   // one long match at offset 1
+    int c = lz4_compress(raw, 100000, packed, sizeof(packed), work);
+    CHECK(c > 0 && c < 600);
+    CHECK_EQ(lz4_decompress(packed, (uint32_t)c, out, 100000), 100000);
+    CHECK(memcmp(out, raw, 100000) == 0);
+    CHECK_EQ(lz4_compress(raw, 100000, packed, 16, work), LZ4_ERR_OVERFLOW);
+}
+
+TEST(test_lz4_corrupt){
+    static uint8_t raw[20000], packed[LZ4_COMPRESS_BOUND(20000)], out[20000], work[LZ4_WORK_SIZE];
+    lz4_sample(raw, sizeof(raw), 7);
+    int c = lz4_compress(raw, sizeof(raw), packed, sizeof(packed), work);
+    CHECK(c > 2);
+    CHECK_EQ(lz4_decompress(packed, 0, out, sizeof(out)), LZ4_ERR_CORRUPT);
+    CHECK(lz4_decompress(packed, (uint32_t)c - 1, out, sizeof(out)) < 0);
+    static const uint8_t bad_off[] = { 0x10, 'x', 0x05, 0x00, 0x00 };    // match before the output start
+    CHECK_EQ(lz4_decompress(bad_off, sizeof(bad_off), out, sizeof(out)), LZ4_ERR_CORRUPT);
+    // random damage must fail or stay inside the output, never crash (ASan)
+    uint32_t r = 99;
+    for (int k = 0; k < 200; ++k){
+        static uint8_t bad[LZ4_COMPRESS_BOUND(20000)];
+        memcpy(bad, packed, (size_t)c);
+        bad[host_rand(&r) % (uint32_t)c] ^= (uint8_t)(1 + host_rand(&r) % 255);
+        int n = lz4_decompress(bad, (uint32_t)c, out, sizeof(out));
+        CHECK(n <= (int)sizeof(out));
+    }
+}
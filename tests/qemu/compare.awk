@@ -0,0 +1,82 @@
+# Compare benchmark results from a timestamped serial capture against a
+# baseline. Called by run.sh as
+#   awk -f compare.awk -v mode=check|update -v out=<new baseline> <baseline> <serial log>
+#
+# Baseline lines: <name> <metric> <value> <tolerance %>; '#' starts a comment.
+# Results come from the kernel's `bench name=<name> key=value ...` lines and
+# the runner's `boot <metric>=<ms>` lines. Metrics ending in _per_sec are
+# better when higher, the rest (cycles_per_op, *_ms) when lower.
+# Exit status: 0 within tolerance, 1 regression or missing result, 5 the
+# baseline has no entries (nothing was checked).
+
+function higher_better(m) { return m ~ /_per_sec$/ }
+function default_tol(name, m) { return name == "boot" ? 50 : 15 }
+
+FILENAME == ARGV[1] {
+    if ($0 ~ /^[ \t]*(#|$)/) next
+    key = $1 SUBSEP $2
+    base[key] = $3; tol[key] = $4
+    order[++nbase] = key
+    next
+}
+
+{
+    # "<ms since qemu start> <serial line>"
+    sub(/\r$/, "")
+    if ($2 == "bench" && $3 ~ /^name=/) {
+        name = substr($3, 6)
+        if (!(name in seen)) { seen[name] = 1; names[++nres] = name }
+        for (i = 4; i <= NF; ++i) {
+            eq = index($i, "=")
+            if (eq) res[name, substr($i, 1, eq - 1)] = substr($i, eq + 1)
+        }
+    } else if ($2 == "boot") {
+        if (!("boot" in seen)) { seen["boot"] = 1; names[++nres] = "boot" }
+        for (i = 3; i <= NF; ++i) {
+            eq = index($i, "=")
+            if (eq) res["boot", substr($i, 1, eq - 1)] = substr($i, eq + 1)
+        }
+    }
+}
+
+END {
+    if (mode == "update") {
+        print "# FoxOS QEMU benchmark baseline: <name> <metric> <value> <tolerance %>" > out
+        print "# Written by tests/qemu/run.sh --update; edit tolerances by hand" > out
+        for (i = 1; i <= nres; ++i) {
+            name = names[i]
+            if (name == "boot") metrics = "prompt_ms"
+            else metrics = ((name, "kib_per_sec") in res && res[name, "kib_per_sec"] > 0) ? "cycles_per_op kib_per_sec" : "cycles_per_op"
+            n = split(metrics, ms, " ")
+            for (k = 1; k <= n; ++k) {
+                key = name SUBSEP ms[k]
+                if (!(key in res)) continue
+                t = (key in tol) ? tol[key] : default_tol(name, ms[k])
+                printf "%-16s %-14s %12s %4s\n", name, ms[k], res[key], t > out
+                written++
+            }
+        }
+        printf "baseline: %d entries written to %s\n", written, out
+        exit 0
+    }
+
+    if (!nbase) { print "baseline: no entries, nothing checked; record one with tests/qemu/run.sh --update" > "/dev/stderr"; exit 5 }
+    printf "%-16s %-14s %12s %12s %8s  %s\n", "name", "metric", "baseline", "current", "delta", "status"
+    bad = 0
+    for (i = 1; i <= nbase; ++i) {
+        key = order[i]; split(key, kp, SUBSEP)
+        if (!(key in res)) {
+            printf "%-16s %-14s %12s %12s %8s  %s\n", kp[1], kp[2], base[key], "-", "-", "MISSING"
+            bad++; continue
+        }
+        b = base[key] + 0; c = res[key] + 0
+        d = b ? (c - b) * 100 / b : 0
+        worse = higher_better(kp[2]) ? -d : d
+        st = "ok"
+        if (worse > tol[key]) { st = "REGRESSION"; bad++ }
+        else if (-worse > tol[key]) st = "improved"
+        printf "%-16s %-14s %12s %12s %+7.1f%%  %s\n", kp[1], kp[2], base[key], res[key], d, st
+    }
+    if (bad) { printf "%d metric(s) out of tolerance\n", bad; exit 1 }
+    print "all metrics within tolerance"
+}
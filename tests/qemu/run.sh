@@ -0,0 +1,124 @@
+#!/bin/bash
+set -euo pipefail
+
+# Build a headless image whose /init/rc is a benchmark script, boot it in
+# QEMU with COM1 on stdio and compare the `bench name=...` lines against a
+# stored baseline (compare.awk). Every serial line is stamped with the
+# milliseconds since QEMU started; the first `foxos> ` echo of the script
+# gives boot-to-prompt time, which is compared like a benchmark.
+#
+#   tests/qemu/run.sh                  build, boot, compare
+#   tests/qemu/run.sh --update         ... and rewrite the baseline from this run
+#   tests/qemu/run.sh --log FILE       compare an earlier serial.log (no build, no boot)
+# Options:
+#   --target hdd|floppy   image to build and boot (default: hdd, as build.sh)
+#   --rc FILE             script baked in as /init/rc (default: tests/qemu/bench.rc)
+#   --baseline FILE       default: tests/qemu/baseline-<target>.txt
+#   --timeout SEC         whole boot + script (default: 180)
+#   --no-build            boot the images already in build/
+#   --verbose             echo the serial output as it arrives
+# Exit status: 0 ok, 1 regression or missing result, 2 usage,
+#   3 build failed, 4 boot failed, timed out or the script did not finish,
+#   5 the baseline is empty or missing (record one with --update)
+
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+QDIR="$ROOT/tests/qemu"
+OUT="$ROOT/build/qemu"
+QEMU_BIN="${QEMU:-qemu-system-i386}"
+
+TARGET=hdd
+RC="$QDIR/bench.rc"
+BASELINE=""
+TIMEOUT=180
+BUILD=1
+UPDATE=0
+VERBOSE=0
+LOG=""
+
+usage() { sed -n '10,21p' "$0" | sed 's/^# \{0,1\}//' >&2; exit 2; }
+
+while [[ $# -gt 0 ]]; do
+  case "$1" in
+    --target)   TARGET="${2:?}"; shift 2 ;;
+    --rc)       RC="${2:?}"; shift 2 ;;
+    --baseline) BASELINE="${2:?}"; shift 2 ;;
+    --timeout)  TIMEOUT="${2:?}"; shift 2 ;;
+    --log)      LOG="${2:?}"; BUILD=0; shift 2 ;;
+    --no-build) BUILD=0; shift ;;
+    --update)   UPDATE=1; shift ;;
+    --verbose)  VERBOSE=1; shift ;;
+    *)          usage ;;
+  esac
+done
+[[ "$TARGET" == "hdd" || "$TARGET" == "floppy" ]] || usage
+BASELINE="${BASELINE:-$QDIR/baseline-$TARGET.txt}"
+mkdir -p "$OUT"
+
+if [[ -z "$LOG" ]]; then
+  LOG="$OUT/serial.log"
+
+  if (( BUILD )); then
+    echo "Building $TARGET image with $RC as /init/rc..."
+    if ! (cd "$ROOT" && BUILD_TARGET="$TARGET" HEADLESS=1 INIT_RC="$RC" ./build.sh) > "$OUT/build.log" 2>&1; then
+      tail -n 20 "$OUT/build.log" >&2
+      echo "run: build failed (full log: $OUT/build.log)" >&2
+      exit 3
+    fi
+  fi
+
+  command -v "$QEMU_BIN" > /dev/null || { echo "run: $QEMU_BIN not found (set QEMU=...)" >&2; exit 4; }
+  QEMU_ARGS=(-m 64 -display none -monitor none -serial stdio -no-reboot
+             -device isa-debug-exit,iobase=0xf4,iosize=0x04
+             -boot a -drive file="$ROOT/build/os.img",if=floppy,format=raw)
+  if [[ "$TARGET" == "hdd" ]]; then
+    QEMU_ARGS+=(-drive id=hdd,file="$ROOT/build/disk.img",if=none,format=raw -device ide-hd,drive=hdd,bus=ide.0)
+  fi
+
+  # "<ms since start> <line>" for every line on COM1
+  START=${EPOCHREALTIME/./}
+  stamp() {
+    local line now
+    while IFS= read -r line || [[ -n "$line" ]]; do
+      now=${EPOCHREALTIME/./}
+      line="${line%$'\r'}"
+      printf '%d %s\n' $(( (now - START) / 1000 )) "$line"
+      (( VERBOSE )) && printf '%s\n' "$line" >&2
+    done
+    return 0
+  }
+
+  echo "Booting in QEMU (timeout ${TIMEOUT}s)..."
+  set +e
+  timeout "$TIMEOUT" "$QEMU_BIN" "${QEMU_ARGS[@]}" < /dev/null 2> "$OUT/qemu.err" | stamp > "$LOG"
+  QSTATUS=${PIPESTATUS[0]}
+  set -e
+
+  # ACPI power-off exits 0; the isa-debug-exit fallback exits (0 << 1) | 1
+  if (( QSTATUS == 124 )); then
+    echo "run: timed out after ${TIMEOUT}s (serial: $LOG)" >&2; exit 4
+  elif (( QSTATUS != 0 && QSTATUS != 1 )); then
+    cat "$OUT/qemu.err" >&2
+    echo "run: qemu exited with $QSTATUS (serial: $LOG)" >&2; exit 4
+  fi
+  if ! grep -q '\[sys\] shutdown requested' "$LOG"; then
+    echo "run: the script did not reach shutdown (serial: $LOG)" >&2; exit 4
+  fi
+
+  FIRST_MS=$(awk 'NF > 1 { print $1; exit }' "$LOG")
+  PROMPT_MS=$(awk '$2 == "foxos>" { print $1; exit }' "$LOG")
+  if [[ -z "$PROMPT_MS" ]]; then
+    echo "run: no prompt on serial (serial: $LOG)" >&2; exit 4
+  fi
+  echo "${PROMPT_MS} boot first_serial_ms=${FIRST_MS} prompt_ms=${PROMPT_MS}" >> "$LOG"
+  echo "Boot: first serial output ${FIRST_MS} ms, prompt ${PROMPT_MS} ms after QEMU start"
+fi
+
+[[ -f "$LOG" ]] || { echo "run: $LOG not found" >&2; exit 2; }
+BASE_IN="$BASELINE"
+[[ -f "$BASE_IN" ]] || BASE_IN=/dev/null
+if (( UPDATE )); then
+  awk -f "$QDIR/compare.awk" -v mode=update -v out="$BASELINE.new" "$BASE_IN" "$LOG"
+  mv "$BASELINE.new" "$BASELINE"
+else
+  awk -f "$QDIR/compare.awk" -v mode=check "$BASE_IN" "$LOG"
+fi
@@ -0,0 +1,49 @@
+// Host tool for build.sh: compress a flat binary into an LZ4 image
+// (lz4_image_t header + block) for the boot stub, and check that it
+// decompresses back to the input before writing it.
+//   lz4pack <kernel.bin> <kernel.lz4>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lz4.h"
+
+static uint8_t* read_file(const char* path, uint32_t* size){
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END); long n = ftell(f); fseek(f, 0, SEEK_SET);
+    uint8_t* b = malloc(n > 0 ? (size_t)n : 1);
+    if (b && fread(b, 1, (size_t)n, f) != (size_t)n) { free(b); b = 0; }
+    fclose(f);
+    *size = (uint32_t)n;
+    return b;
+}
+
+int main(int argc, char** argv){
+    if (argc != 3) { fprintf(stderr, "usage: lz4pack <in> <out>\n"); return 2; }
+    uint32_t raw_size;
+    uint8_t* raw = read_file(argv[1], &raw_size);
+    if (!raw) { perror(argv[1]); return 1; }
+
+    uint32_t cap = LZ4_COMPRESS_BOUND(raw_size);
+    uint8_t* packed = malloc(cap);
+    uint8_t* check = malloc(raw_size + 1);
+    void* work = malloc(LZ4_WORK_SIZE);
+    if (!packed || !check || !work) { fprintf(stderr, "lz4pack: out of memory\n"); return 1; }
+    int n = lz4_compress(raw, raw_size, packed, cap, work);
+    if (n < 0) { fprintf(stderr, "lz4pack: compression failed (%d)\n", n); return 1; }
+    int m = lz4_decompress(packed, (uint32_t)n, check, raw_size + 1);
+    if (m != (int)raw_size || memcmp(check, raw, raw_size)) {
+        fprintf(stderr, "lz4pack: round trip mismatch (%d of %u bytes)\n", m, raw_size);
+        return 1;
+    }
+
+    lz4_image_t h = { LZ4_IMAGE_MAGIC, raw_size, (uint32_t)n, 0 };
+    FILE* f = fopen(argv[2], "wb");
+    if (!f || fwrite(&h, sizeof(h), 1, f) != 1 || fwrite(packed, 1, (size_t)n, f) != (size_t)n || fclose(f)) {
+        perror(argv[2]); return 1;
+    }
+    printf("lz4pack: %u -> %u bytes (%u%%)\n", raw_size, (uint32_t)(n + sizeof(h)),
+           raw_size ? (uint32_t)((n + sizeof(h)) * 100 / raw_size) : 0);
+    return 0;
+}